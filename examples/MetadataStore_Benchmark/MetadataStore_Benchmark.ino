@@ -0,0 +1,64 @@
+/*
+    Metadata Store Benchmark
+
+    This example measures how much the MetadataStore wears the flash memory.
+    It writes a mix of frequently and rarely changing values to a store in RAM that 
+    emulates a flash memory with 1KB sectors, then prints the write amplification,
+    the time per write and how evenly the erases are spread over the sectors.
+    For comparison it also prints how many erases rewriting a whole sector per update would take.
+
+    Usage:
+        - Select your board from the Tools menu
+        - Upload the code to your board
+        - Open the Serial Monitor and set the baud rate to 115200
+*/
+
+#include "Arduino_PowerManagement.h"
+
+constexpr uint32_t SECTOR_SIZE = 1024;
+constexpr uint32_t SECTOR_COUNT = 8;
+constexpr uint32_t UPDATES = 10000;
+constexpr uint16_t FREQUENT_KEYS = 4; // E.g. wake counters and coulomb counter snapshots
+constexpr uint16_t RARE_KEYS = 24; // E.g. learned gauge parameters
+
+uint8_t memory[SECTOR_SIZE * SECTOR_COUNT];
+RamBlockStorage storage(memory, sizeof(memory), SECTOR_SIZE);
+MetadataStore<FREQUENT_KEYS + RARE_KEYS> store(storage);
+
+void setup() {
+    Serial.begin(115200);
+    // Wait for Serial to be ready with a timeout of 5 seconds
+    for (auto start = millis(); !Serial && millis() - start < 5000;);
+
+    if (!store.begin()) {
+        Serial.println("Failed to initialize the store.");
+        while (true);
+    }
+
+    uint32_t updates = 0;
+    unsigned long startTime = micros();
+    for (uint32_t index = 0; index < UPDATES; ++index) {
+        // Most updates go to a few keys, every tenth update goes to one of the rarely changing keys
+        uint16_t key = index % 10 == 0 ? FREQUENT_KEYS + (index / 10) % RARE_KEYS : index % FREQUENT_KEYS;
+        uint32_t value = index / 3; // Some updates write the same value again
+        if (!store.put(key, value)) {
+            Serial.println("The store is full.");
+            break;
+        }
+        ++updates;
+    }
+    unsigned long duration = micros() - startTime;
+
+    MetadataStoreStats stats = store.stats();
+    Serial.println("Updates: " + String(updates));
+    Serial.println("Unchanged values skipped: " + String(stats.unchangedWrites));
+    Serial.println("Bytes programmed: " + String(stats.programmedBytes));
+    Serial.println("Write amplification: " + String(stats.writeAmplification()));
+    Serial.println("Sector erases: " + String(stats.erases) + " (" + String(stats.compactions) + " compactions)");
+    Serial.println("Erases per sector: " + String(stats.minimumEraseCount) + " - " + String(stats.maximumEraseCount));
+    Serial.println("Time per update: " + String(static_cast<float>(duration) / updates) + " us");
+    Serial.println("Erases when rewriting a sector per update: " + String(updates - stats.unchangedWrites));
+}
+
+void loop() {
+}
@@ -0,0 +1,56 @@
+/*
+    Power Profile Demo for Portenta C33
+
+    This example measures the current and power consumption of the Portenta C33 
+    in several rail configurations and prints a table with the results.
+    For each configuration the rails are switched, the fuel gauge readings are given 
+    time to settle and then sampled for a while to compute their mean and variance.
+
+    Usage:
+        - Connect a battery to the board and power it only from the battery, 
+          the fuel gauge can't measure the current while the board is powered through USB. 
+          As USB is unplugged, the results are printed to Serial1: connect a 3.3V 
+          USB-to-serial adapter to its TX, RX and GND pins (see the pinout of the board).
+        - Select the Portenta C33 board from the Tools menu
+        - Upload the code to your Portenta C33, then unplug USB and plug in the adapter
+        - Open the Serial Monitor on the port of the adapter and set the baud rate to 115200
+*/
+
+#include "Arduino_PowerManagement.h"
+
+Board board;
+Battery battery;
+Charger charger;
+PowerManagement powerManagement(board, battery);
+BoardPowerProfileTarget target(board, battery, charger);
+PowerProfiler profiler(target);
+
+// The charger is disabled so that only the consumption of the board is measured
+const PowerProfileConfiguration configurations[] = {
+    { PowerMode("All on").withRail(PowerRail::sw1, true).withRail(PowerRail::sw2, true, 3.3f).withRail(PowerRail::ldo1, true), false },
+    { PowerMode("Radio off").withRail(PowerRail::sw1, false).withRail(PowerRail::sw2, true, 3.3f).withRail(PowerRail::ldo1, true), false },
+    { PowerMode("3V3 at 1.8V").withRail(PowerRail::sw1, false).withRail(PowerRail::sw2, true, 1.8f).withRail(PowerRail::ldo1, true), false },
+    { PowerMode("All off").withRail(PowerRail::sw1, false).withRail(PowerRail::sw2, false).withRail(PowerRail::ldo1, false), false }
+};
+constexpr uint8_t CONFIGURATION_COUNT = sizeof(configurations) / sizeof(configurations[0]);
+
+PowerProfileResult results[CONFIGURATION_COUNT];
+
+void setup() {
+    // Serial is the USB port, which isn't connected while the board runs from the battery
+    Serial1.begin(115200);
+
+    if (!powerManagement.begin()) {
+        Serial1.println("Initialization failed.");
+        while (true);
+    }
+
+    Serial1.println("Profiling, this takes about " + String(CONFIGURATION_COUNT * 40) + " seconds...");
+    profiler.run(configurations, CONFIGURATION_COUNT, results);
+
+    // Restore the default rail configuration before printing
+    board.setPowerMode(configurations[0].mode);
+    PowerProfiler::printResults(results, CONFIGURATION_COUNT, Serial1);
+}
+
+void loop() {}
@@ -0,0 +1,92 @@
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+// Minimal subset of the Arduino API used by the library, backed by the host simulation (see HostSimulation.h).
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <math.h>
+
+typedef bool boolean;
+typedef uint8_t byte;
+typedef uint8_t pin_size_t;
+
+enum PinStatus { LOW = 0, HIGH = 1, CHANGE, FALLING, RISING };
+enum PinMode { INPUT = 0, OUTPUT, INPUT_PULLUP, INPUT_PULLDOWN };
+
+#define LEDR 0
+#define LEDG 1
+#define LEDB 2
+#define LED_BUILTIN LEDR
+#define NUM_DIGITAL_PINS 32
+
+#define bitRead(value, bit) (((value) >> (bit)) & 0x01)
+#define bitSet(value, bit) ((value) |= (1UL << (bit)))
+#define bitClear(value, bit) ((value) &= ~(1UL << (bit)))
+#define bitWrite(value, bit, bitvalue) ((bitvalue) ? bitSet(value, bit) : bitClear(value, bit))
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+// Templates instead of macros (as in ArduinoCore-API) so they don't clash with the standard library.
+template <class T, class L>
+auto min(const T &a, const L &b) -> decltype((b < a) ? b : a) {
+    return (b < a) ? b : a;
+}
+
+template <class T, class L>
+auto max(const T &a, const L &b) -> decltype((b < a) ? b : a) {
+    return (a < b) ? b : a;
+}
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long milliseconds);
+void delayMicroseconds(unsigned int microseconds);
+
+void pinMode(int pin, int mode);
+void digitalWrite(int pin, int value);
+int digitalRead(int pin);
+int digitalPinToInterrupt(int pin);
+void attachInterrupt(int interrupt, void (*callback)(), int mode);
+void detachInterrupt(int interrupt);
+void noInterrupts();
+void interrupts();
+
+class Print {
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t character) = 0;
+    virtual size_t write(const uint8_t *buffer, size_t size);
+    size_t write(const char *text);
+
+    size_t print(const char *text);
+    size_t print(char character);
+    size_t print(int value);
+    size_t print(unsigned int value);
+    size_t print(long value);
+    size_t print(unsigned long value);
+    size_t print(double value, int digits = 2);
+
+    size_t println();
+    size_t println(const char *text);
+    size_t println(char character);
+    size_t println(int value);
+    size_t println(unsigned int value);
+    size_t println(long value);
+    size_t println(unsigned long value);
+    size_t println(double value, int digits = 2);
+};
+
+/// @brief Writes to the standard output of the test process.
+class HostSerial : public Print {
+public:
+    void begin(unsigned long) {}
+    operator bool() { return true; }
+    using Print::write;
+    size_t write(uint8_t character) override;
+};
+
+extern HostSerial Serial;
+extern HostSerial Serial1;
+
+#endif
@@ -0,0 +1,132 @@
+#ifndef HOST_ARDUINO_PF1550_H
+#define HOST_ARDUINO_PF1550_H
+
+// Subset of the Arduino_PF1550 API used by the library. The PMIC is simulated as a plain register file.
+// The enumerators of the register fields are their values after masking, as the library compares them that way.
+
+#include "Arduino.h"
+#include "Wire.h"
+
+enum class Register : uint8_t {
+    PMIC_SW1_VOLT = 0x32,
+    PMIC_SW2_VOLT = 0x3A,
+    PMIC_LDO1_VOLT = 0x4E,
+    PMIC_LDO2_VOLT = 0x52,
+    PMIC_LDO3_VOLT = 0x56,
+    CHARGER_CHG_INT = 0x80,
+    CHARGER_CHG_INT_MASK = 0x82,
+    CHARGER_CHG_INT_OK = 0x84,
+    CHARGER_VBUS_SNS = 0x86,
+    CHARGER_CHG_SNS = 0x87,
+    CHARGER_BATT_SNS = 0x88,
+    CHARGER_CHG_OPER = 0x89,
+    CHARGER_CHG_EOC_CNFG = 0x8D,
+    CHARGER_CHG_CURR_CFG = 0x8E,
+    CHARGER_BATT_REG = 0x8F,
+    CHARGER_VBUS_INLIM_CNFG = 0x94
+};
+
+#define REG_CHG_CURR_CFG_CHG_CC_mask 0x1F
+#define REG_BATT_REG_CHCCV_mask 0x3F
+#define REG_CHG_EOC_CNFG_IEOC_mask 0x70
+#define REG_VBUS_INLIM_CNFG_VBUS_LIN_INLIM_mask 0xF8
+
+enum class Sw1Mode { Normal };
+enum class Sw2Mode { Normal };
+enum class Ldo1Mode { Normal };
+enum class Ldo2Mode { Normal };
+enum class Ldo3Mode { Normal };
+
+enum class Ldo2Voltage : uint8_t {
+    V_1_80, V_1_90, V_2_00, V_2_10, V_2_20, V_2_30, V_2_40, V_2_50,
+    V_2_60, V_2_70, V_2_80, V_2_90, V_3_00, V_3_10, V_3_20, V_3_30
+};
+
+enum class Sw1Voltage : uint8_t { V_1_10, V_1_20, V_1_35, V_1_50, V_1_80, V_2_50, V_3_00, V_3_30 };
+
+enum class Sw2Voltage : uint8_t { V_1_10, V_1_20, V_1_35, V_1_50, V_1_80, V_2_50, V_3_00, V_3_30 };
+
+enum class VFastCharge : uint8_t {
+    V_3_50, V_3_52, V_3_54, V_3_56, V_3_58, V_3_60, V_3_62, V_3_64, V_3_66, V_3_68, V_3_70, V_3_72,
+    V_3_74, V_3_76, V_3_78, V_3_80, V_3_82, V_3_84, V_3_86, V_3_88, V_3_90, V_3_92, V_3_94, V_3_96,
+    V_3_98, V_4_00, V_4_02, V_4_04, V_4_06, V_4_08, V_4_10, V_4_12, V_4_14, V_4_16, V_4_18, V_4_20,
+    V_4_22, V_4_24, V_4_26, V_4_28, V_4_30, V_4_32, V_4_34, V_4_36, V_4_38, V_4_40, V_4_42, V_4_44
+};
+
+enum class IFastCharge : uint8_t {
+    I_100_mA, I_150_mA, I_200_mA, I_250_mA, I_300_mA, I_350_mA, I_400_mA, I_450_mA, I_500_mA, I_550_mA,
+    I_600_mA, I_650_mA, I_700_mA, I_750_mA, I_800_mA, I_850_mA, I_900_mA, I_950_mA, I_1000_mA
+};
+
+enum class IEndOfCharge : uint8_t {
+    I_5_mA = 0x00, I_10_mA = 0x10, I_20_mA = 0x20, I_30_mA = 0x30, I_50_mA = 0x40
+};
+
+enum class IInputCurrentLimit : uint8_t {
+    I_10_mA = 0x00, I_15_mA = 0x08, I_20_mA = 0x10, I_25_mA = 0x18, I_30_mA = 0x20, I_35_mA = 0x28,
+    I_40_mA = 0x30, I_45_mA = 0x38, I_50_mA = 0x40, I_100_mA = 0x48, I_150_mA = 0x50, I_200_mA = 0x58,
+    I_300_mA = 0x60, I_400_mA = 0x68, I_500_mA = 0x70, I_600_mA = 0x78, I_700_mA = 0x80, I_800_mA = 0x88,
+    I_900_mA = 0x90, I_1000_mA = 0x98, I_1500_mA = 0xA0
+};
+
+class PF1550;
+
+class PF1550_Control {
+public:
+    explicit PF1550_Control(PF1550 &pmic) : pmic(pmic) {}
+
+    void turnSw1On(Sw1Mode) { sw1 = true; }
+    void turnSw1Off(Sw1Mode) { sw1 = false; }
+    void turnSw2On(Sw2Mode) { sw2 = true; }
+    void turnSw2Off(Sw2Mode) { sw2 = false; }
+    void turnLDO1On(Ldo1Mode) { ldo1 = true; }
+    void turnLDO1Off(Ldo1Mode) { ldo1 = false; }
+    void turnLDO2On(Ldo2Mode) { ldo2 = true; }
+    void turnLDO2Off(Ldo2Mode) { ldo2 = false; }
+    void turnLDO3On(Ldo3Mode) { ldo3 = true; }
+    void turnLDO3Off(Ldo3Mode) { ldo3 = false; }
+
+    void setFastChargeCurrent(IFastCharge current);
+    void setFastChargeVoltage(VFastCharge voltage);
+    void setEndOfChargeCurrent(IEndOfCharge current);
+    void setInputCurrentLimit(IInputCurrentLimit limit);
+
+    /// @brief Output state of the regulators, all on after reset.
+    bool sw1 = true, sw2 = true, ldo1 = true, ldo2 = true, ldo3 = true;
+
+private:
+    void writeField(Register reg, uint8_t mask, uint8_t value);
+    PF1550 &pmic;
+};
+
+class PF1550 {
+public:
+    PF1550() : control(*this) {}
+
+    int begin();
+    uint8_t readPMICreg(Register reg);
+    void writePMICreg(Register reg, uint8_t data);
+    PF1550_Control *getControl() { return &control; }
+
+    /// @brief Restores the reset state of the registers and regulators.
+    void reset();
+
+    /// @brief Raises interrupt sources in CHARGER_CHG_INT. Like on the PMIC, they are cleared by writing 1s back.
+    void raiseChargerInterrupt(uint8_t sources);
+
+    /// @brief Called after every register write, used to model the charger reacting to its configuration.
+    void (*onWrite)(Register reg, uint8_t data) = nullptr;
+
+    /// @brief The register file. Tests set status registers (e.g. CHARGER_CHG_SNS) directly.
+    uint8_t registers[256] = {};
+
+    /// @brief Result of begin(), non-zero simulates a PMIC that doesn't respond.
+    int beginResult = 0;
+
+private:
+    PF1550_Control control;
+};
+
+extern PF1550 PMIC;
+
+#endif
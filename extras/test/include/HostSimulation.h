@@ -0,0 +1,46 @@
+#ifndef HOST_SIMULATION_H
+#define HOST_SIMULATION_H
+
+#include "Arduino.h"
+#include "Wire.h"
+#include "Arduino_PF1550.h"
+
+namespace HostSimulation {
+
+/**
+ * @brief The MAX17262 fuel gauge as a file of 16-bit registers on the simulated I2C bus.
+ * Register reads and writes auto-increment the address like on the device.
+ */
+class FuelGauge : public I2CDevice {
+public:
+    static constexpr uint8_t address = 0x36;
+
+    void write(uint8_t reg, const uint8_t *data, size_t length) override;
+    void read(uint8_t reg, uint8_t *data, size_t length) override;
+
+    /// @brief Clears the registers, FStat.DNR is cleared so the data is ready.
+    void reset();
+
+    uint16_t registers[256] = {};
+};
+
+/// @brief Resets the clock, the pins, the PMIC and the fuel gauge, and connects the fuel gauge to the bus.
+void reset();
+
+/// @brief Lets the given time pass. delay() calls this too.
+void advanceMicros(unsigned long microseconds);
+
+/// @brief Lets the given time pass. delay() calls this too.
+void advanceMillis(unsigned long milliseconds);
+
+/// @brief Drives an input pin, running the attached interrupt handler on a matching edge.
+void setPinLevel(int pin, int level);
+
+/// @brief Called by delay() after the time has advanced, e.g. to let a simulated battery discharge.
+extern void (*onDelay)(unsigned long milliseconds);
+
+FuelGauge &fuelGauge();
+
+}
+
+#endif
@@ -0,0 +1 @@
+#include "Arduino_PF1550.h"
@@ -0,0 +1,49 @@
+#ifndef HOST_WIRE_H
+#define HOST_WIRE_H
+
+#include "Arduino.h"
+
+/// @brief A device on the simulated I2C bus, addressed with an 8-bit register pointer.
+class I2CDevice {
+public:
+    virtual ~I2CDevice() {}
+
+    /// @brief Receives the bytes of a write transaction following the register address.
+    virtual void write(uint8_t reg, const uint8_t *data, size_t length) = 0;
+
+    /// @brief Fills the buffer with the bytes of a read transaction starting at the register address.
+    virtual void read(uint8_t reg, uint8_t *data, size_t length) = 0;
+};
+
+class TwoWire {
+public:
+    static constexpr size_t BUFFER_LENGTH = 32;
+
+    void begin() {}
+    void end() {}
+    void setClock(uint32_t) {}
+
+    /// @brief Connects a simulated device to the bus, or disconnects the address when device is nullptr.
+    void attach(uint8_t address, I2CDevice *device);
+
+    void beginTransmission(uint8_t address);
+    size_t write(uint8_t data);
+    uint8_t endTransmission(bool stopBit = true);
+    uint8_t requestFrom(uint8_t address, size_t quantity, bool stopBit = true);
+    int available();
+    int read();
+
+private:
+    I2CDevice *devices[128] = {};
+    uint8_t transmitAddress = 0;
+    uint8_t transmitBuffer[BUFFER_LENGTH];
+    size_t transmitLength = 0;
+    uint8_t registerPointer[128] = {};
+    uint8_t receiveBuffer[BUFFER_LENGTH];
+    size_t receiveLength = 0;
+    size_t receiveIndex = 0;
+};
+
+extern TwoWire Wire;
+
+#endif
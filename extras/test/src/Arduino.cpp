@@ -0,0 +1,180 @@
+#include <stdio.h>
+#include "Arduino.h"
+#include "HostSimulation.h"
+
+namespace {
+    unsigned long long currentMicros = 0;
+    int pinLevels[NUM_DIGITAL_PINS] = {};
+    void (*interruptHandlers[NUM_DIGITAL_PINS])() = {};
+    int interruptModes[NUM_DIGITAL_PINS] = {};
+}
+
+HostSerial Serial;
+HostSerial Serial1;
+
+namespace HostSimulation {
+
+void (*onDelay)(unsigned long milliseconds) = nullptr;
+
+void advanceMicros(unsigned long microseconds) {
+    currentMicros += microseconds;
+}
+
+void advanceMillis(unsigned long milliseconds) {
+    currentMicros += 1000ULL * milliseconds;
+}
+
+void setPinLevel(int pin, int level) {
+    int previousLevel = pinLevels[pin];
+    pinLevels[pin] = level;
+    if (interruptHandlers[pin] == nullptr || previousLevel == level) {
+        return;
+    }
+
+    int mode = interruptModes[pin];
+    if (mode == CHANGE || (mode == FALLING && level == LOW) || (mode == RISING && level == HIGH)) {
+        interruptHandlers[pin]();
+    }
+}
+
+void reset() {
+    currentMicros = 0;
+    onDelay = nullptr;
+    for (int pin = 0; pin < NUM_DIGITAL_PINS; ++pin) {
+        pinLevels[pin] = HIGH;
+        interruptHandlers[pin] = nullptr;
+    }
+    PMIC.reset();
+    fuelGauge().reset();
+    Wire.attach(FuelGauge::address, &fuelGauge());
+}
+
+}
+
+unsigned long millis() {
+    return static_cast<unsigned long>(currentMicros / 1000);
+}
+
+unsigned long micros() {
+    return static_cast<unsigned long>(currentMicros);
+}
+
+void delay(unsigned long milliseconds) {
+    HostSimulation::advanceMillis(milliseconds);
+    if (HostSimulation::onDelay != nullptr) {
+        HostSimulation::onDelay(milliseconds);
+    }
+}
+
+void delayMicroseconds(unsigned int microseconds) {
+    HostSimulation::advanceMicros(microseconds);
+}
+
+void pinMode(int, int) {}
+
+void digitalWrite(int pin, int value) {
+    pinLevels[pin] = value;
+}
+
+int digitalRead(int pin) {
+    return pinLevels[pin];
+}
+
+int digitalPinToInterrupt(int pin) {
+    return pin;
+}
+
+void attachInterrupt(int interrupt, void (*callback)(), int mode) {
+    interruptHandlers[interrupt] = callback;
+    interruptModes[interrupt] = mode;
+}
+
+void detachInterrupt(int interrupt) {
+    interruptHandlers[interrupt] = nullptr;
+}
+
+void noInterrupts() {}
+
+void interrupts() {}
+
+size_t Print::write(const uint8_t *buffer, size_t size) {
+    size_t written = 0;
+    while (size-- > 0) {
+        written += write(*buffer++);
+    }
+    return written;
+}
+
+size_t Print::write(const char *text) {
+    return write(reinterpret_cast<const uint8_t *>(text), strlen(text));
+}
+
+size_t Print::print(const char *text) {
+    return write(text);
+}
+
+size_t Print::print(char character) {
+    return write(static_cast<uint8_t>(character));
+}
+
+size_t Print::print(int value) {
+    return print(static_cast<long>(value));
+}
+
+size_t Print::print(unsigned int value) {
+    return print(static_cast<unsigned long>(value));
+}
+
+size_t Print::print(long value) {
+    char buffer[24];
+    snprintf(buffer, sizeof(buffer), "%ld", value);
+    return write(buffer);
+}
+
+size_t Print::print(unsigned long value) {
+    char buffer[24];
+    snprintf(buffer, sizeof(buffer), "%lu", value);
+    return write(buffer);
+}
+
+size_t Print::print(double value, int digits) {
+    char buffer[48];
+    snprintf(buffer, sizeof(buffer), "%.*f", digits, value);
+    return write(buffer);
+}
+
+size_t Print::println() {
+    return write("\r\n");
+}
+
+size_t Print::println(const char *text) {
+    return print(text) + println();
+}
+
+size_t Print::println(char character) {
+    return print(character) + println();
+}
+
+size_t Print::println(int value) {
+    return print(value) + println();
+}
+
+size_t Print::println(unsigned int value) {
+    return print(value) + println();
+}
+
+size_t Print::println(long value) {
+    return print(value) + println();
+}
+
+size_t Print::println(unsigned long value) {
+    return print(value) + println();
+}
+
+size_t Print::println(double value, int digits) {
+    return print(value, digits) + println();
+}
+
+size_t HostSerial::write(uint8_t character) {
+    return fputc(character, stdout) == EOF ? 0 : 1;
+}
@@ -0,0 +1,30 @@
+#include "HostSimulation.h"
+
+namespace HostSimulation {
+
+FuelGauge &fuelGauge() {
+    static FuelGauge instance;
+    return instance;
+}
+
+void FuelGauge::write(uint8_t reg, const uint8_t *data, size_t length) {
+    for (size_t index = 0; index + 1 < length; index += 2) {
+        registers[static_cast<uint8_t>(reg++)] = data[index] | (data[index + 1] << 8);
+    }
+}
+
+void FuelGauge::read(uint8_t reg, uint8_t *data, size_t length) {
+    for (size_t index = 0; index < length; index += 2) {
+        uint16_t value = registers[static_cast<uint8_t>(reg++)];
+        data[index] = value & 0xFF;
+        if (index + 1 < length) {
+            data[index + 1] = value >> 8;
+        }
+    }
+}
+
+void FuelGauge::reset() {
+    memset(registers, 0, sizeof(registers));
+}
+
+}
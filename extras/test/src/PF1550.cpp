@@ -0,0 +1,55 @@
+#include "Arduino_PF1550.h"
+
+PF1550 PMIC;
+
+void PF1550_Control::writeField(Register reg, uint8_t mask, uint8_t value) {
+    uint8_t data = pmic.readPMICreg(reg);
+    pmic.writePMICreg(reg, (data & ~mask) | (value & mask));
+}
+
+void PF1550_Control::setFastChargeCurrent(IFastCharge current) {
+    writeField(Register::CHARGER_CHG_CURR_CFG, REG_CHG_CURR_CFG_CHG_CC_mask, static_cast<uint8_t>(current));
+}
+
+void PF1550_Control::setFastChargeVoltage(VFastCharge voltage) {
+    writeField(Register::CHARGER_BATT_REG, REG_BATT_REG_CHCCV_mask, static_cast<uint8_t>(voltage));
+}
+
+void PF1550_Control::setEndOfChargeCurrent(IEndOfCharge current) {
+    writeField(Register::CHARGER_CHG_EOC_CNFG, REG_CHG_EOC_CNFG_IEOC_mask, static_cast<uint8_t>(current));
+}
+
+void PF1550_Control::setInputCurrentLimit(IInputCurrentLimit limit) {
+    writeField(Register::CHARGER_VBUS_INLIM_CNFG, REG_VBUS_INLIM_CNFG_VBUS_LIN_INLIM_mask, static_cast<uint8_t>(limit));
+}
+
+int PF1550::begin() {
+    return beginResult;
+}
+
+uint8_t PF1550::readPMICreg(Register reg) {
+    return registers[static_cast<uint8_t>(reg)];
+}
+
+void PF1550::writePMICreg(Register reg, uint8_t data) {
+    if (reg == Register::CHARGER_CHG_INT) {
+        registers[static_cast<uint8_t>(reg)] &= ~data; // Write 1 to clear
+    } else {
+        registers[static_cast<uint8_t>(reg)] = data;
+    }
+
+    if (onWrite != nullptr) {
+        onWrite(reg, data);
+    }
+}
+
+void PF1550::reset() {
+    memset(registers, 0, sizeof(registers));
+    onWrite = nullptr;
+    beginResult = 0;
+    control.sw1 = control.sw2 = control.ldo1 = control.ldo2 = control.ldo3 = true;
+}
+
+void PF1550::raiseChargerInterrupt(uint8_t sources) {
+    registers[static_cast<uint8_t>(Register::CHARGER_CHG_INT)] |= sources;
+}
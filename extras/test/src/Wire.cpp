@@ -0,0 +1,59 @@
+#include "Wire.h"
+
+TwoWire Wire;
+
+void TwoWire::attach(uint8_t address, I2CDevice *device) {
+    devices[address] = device;
+}
+
+void TwoWire::beginTransmission(uint8_t address) {
+    transmitAddress = address;
+    transmitLength = 0;
+}
+
+size_t TwoWire::write(uint8_t data) {
+    if (transmitLength == BUFFER_LENGTH) {
+        return 0;
+    }
+    transmitBuffer[transmitLength++] = data;
+    return 1;
+}
+
+uint8_t TwoWire::endTransmission(bool) {
+    I2CDevice *device = devices[transmitAddress & 0x7F];
+    if (device == nullptr) {
+        return 2; // NACK on transmit of address
+    }
+
+    if (transmitLength > 0) {
+        registerPointer[transmitAddress & 0x7F] = transmitBuffer[0];
+    }
+    if (transmitLength > 1) {
+        device->write(transmitBuffer[0], transmitBuffer + 1, transmitLength - 1);
+    }
+    return 0;
+}
+
+uint8_t TwoWire::requestFrom(uint8_t address, size_t quantity, bool) {
+    receiveIndex = 0;
+    receiveLength = 0;
+    I2CDevice *device = devices[address & 0x7F];
+    if (device == nullptr) {
+        return 0;
+    }
+
+    receiveLength = quantity < BUFFER_LENGTH ? quantity : BUFFER_LENGTH;
+    device->read(registerPointer[address & 0x7F], receiveBuffer, receiveLength);
+    return receiveLength;
+}
+
+int TwoWire::available() {
+    return receiveLength - receiveIndex;
+}
+
+int TwoWire::read() {
+    if (receiveIndex == receiveLength) {
+        return -1;
+    }
+    return receiveBuffer[receiveIndex++];
+}
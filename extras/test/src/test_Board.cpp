@@ -0,0 +1,84 @@
+#include <catch2/catch.hpp>
+
+#include "HostSimulation.h"
+#include "Board.h"
+#include "Charger.h"
+#include "Battery.h"
+#include "BatteryConstants.h"
+
+TEST_CASE("Board switches the PMIC rails", "[Board]") {
+    HostSimulation::reset();
+    Board board;
+    REQUIRE(board.begin());
+
+    board.setExternalPowerEnabled(false);
+    REQUIRE_FALSE(PMIC.getControl()->sw2);
+    board.setExternalPowerEnabled(true);
+    REQUIRE(PMIC.getControl()->sw2);
+
+    REQUIRE(board.setReferenceVoltage(2.5f));
+    REQUIRE(PMIC.readPMICreg(Register::PMIC_LDO2_VOLT) == static_cast<uint8_t>(Ldo2Voltage::V_2_50));
+    REQUIRE_FALSE(board.setReferenceVoltage(4.0f));
+}
+
+TEST_CASE("Board reports the power source from the PMIC status", "[Board]") {
+    HostSimulation::reset();
+    Board board;
+
+    REQUIRE_FALSE(board.isUSBPowered());
+    PMIC.registers[static_cast<uint8_t>(Register::CHARGER_VBUS_SNS)] = 1 << CHARGER_VBUS_VALID_BIT;
+    REQUIRE(board.isUSBPowered());
+}
+
+TEST_CASE("Charger reads back the configured charge current", "[Charger]") {
+    HostSimulation::reset();
+    Charger charger;
+    REQUIRE(charger.begin());
+
+    REQUIRE(charger.setChargeCurrent(500));
+    REQUIRE(charger.getChargeCurrent() == 500);
+    REQUIRE_FALSE(charger.setChargeCurrent(123));
+}
+
+TEST_CASE("Battery reads the fuel gauge registers", "[Battery]") {
+    HostSimulation::reset();
+    Battery battery;
+
+    HostSimulation::fuelGauge().registers[VCELL_REG] = static_cast<uint16_t>(3700 / VOLTAGE_MULTIPLIER_MV);
+    REQUIRE(battery.voltage() == Approx(3.7f).margin(0.001f));
+
+    HostSimulation::fuelGauge().registers[STATUS_REG] = 1 << BATTERY_STATUS_BIT;
+    REQUIRE(battery.voltage() == -1);
+}
+
+TEST_CASE("Battery polls a prediction at a hypothetical current", "[Battery]") {
+    HostSimulation::reset();
+    Battery battery;
+    HostSimulation::fuelGauge().registers[AT_TTE_REG] = 640; // 1h at 5.625s per LSB
+
+    AtRatePrediction prediction;
+    REQUIRE_FALSE(battery.pollAtRatePrediction(prediction));
+    REQUIRE(battery.startAtRatePrediction(120));
+    REQUIRE(static_cast<int16_t>(HostSimulation::fuelGauge().registers[AT_RATE_REG]) == -768);
+    REQUIRE_FALSE(battery.pollAtRatePrediction(prediction));
+    REQUIRE_FALSE(prediction.valid);
+
+    HostSimulation::advanceMillis(2 * ceil(ACTIVE_TASK_PERIOD_MS));
+    REQUIRE(battery.pollAtRatePrediction(prediction));
+    REQUIRE(prediction.valid);
+    REQUIRE(prediction.timeToEmpty == 3600);
+    REQUIRE(HostSimulation::fuelGauge().registers[AT_RATE_REG] == 0);
+    REQUIRE_FALSE(battery.pollAtRatePrediction(prediction));
+}
+
+TEST_CASE("Battery limits the number of predictions evaluated at once", "[Battery]") {
+    HostSimulation::reset();
+    Battery battery;
+    uint16_t currents[MAX_AT_RATE_CURRENTS + 1] = {};
+    AtRatePrediction predictions[MAX_AT_RATE_CURRENTS + 1];
+
+    REQUIRE_FALSE(battery.predictAtRates(currents, predictions, MAX_AT_RATE_CURRENTS + 1));
+    unsigned long start = millis();
+    REQUIRE(battery.predictAtRates(currents, predictions, MAX_AT_RATE_CURRENTS));
+    REQUIRE(millis() - start == MAX_AT_RATE_CURRENTS * 2 * ceil(ACTIVE_TASK_PERIOD_MS));
+}
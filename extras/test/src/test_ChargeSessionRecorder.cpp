@@ -0,0 +1,59 @@
+#include <catch2/catch.hpp>
+
+#include "HostSimulation.h"
+#include "ChargeSessionRecorder.h"
+#include "BatteryConstants.h"
+
+TEST_CASE("ChargeSessionRecorder counts the time for the previous state", "[ChargeSessionRecorder]") {
+    HostSimulation::reset();
+    HostSimulation::fuelGauge().registers[REP_SOC_REG] = 40 * 256;
+    Charger charger;
+    Battery battery;
+    ChargeSessionRecorder<4> recorder(charger, battery);
+
+    recorder.update(100, ChargingState::preCharge);
+    recorder.update(160, ChargingState::fastChargeConstantCurrent);
+    recorder.update(1960, ChargingState::fastChargeConstantVoltage);
+    recorder.update(2560, ChargingState::done);
+    HostSimulation::fuelGauge().registers[REP_SOC_REG] = 100 * 256;
+    recorder.update(2620, ChargingState::chargerDisabled);
+
+    ChargeSession session;
+    REQUIRE(recorder.session(0, session));
+    REQUIRE(session.startTime == 100);
+    REQUIRE(session.duration() == 2520);
+    REQUIRE(session.residency(ChargingState::preCharge) == 60);
+    REQUIRE(session.residency(ChargingState::fastChargeConstantCurrent) == 1800);
+    REQUIRE(session.residency(ChargingState::fastChargeConstantVoltage) == 600);
+    REQUIRE(session.residency(ChargingState::done) == 60);
+    REQUIRE(session.timeToFull == 2460);
+    REQUIRE(session.startPercentage == 40);
+    REQUIRE(session.endPercentage == 100);
+}
+
+TEST_CASE("ChargeSessionRecorder waits for a battery before starting a session", "[ChargeSessionRecorder]") {
+    HostSimulation::reset();
+    HostSimulation::fuelGauge().registers[STATUS_REG] = 1 << BATTERY_STATUS_BIT;
+    Charger charger;
+    Battery battery;
+    ChargeSessionRecorder<4> recorder(charger, battery);
+
+    recorder.update(0, ChargingState::fastChargeConstantCurrent);
+    REQUIRE_FALSE(recorder.isCharging());
+
+    HostSimulation::fuelGauge().registers[STATUS_REG] = 0;
+    HostSimulation::fuelGauge().registers[REP_SOC_REG] = 30 * 256;
+    recorder.update(10, ChargingState::fastChargeConstantCurrent);
+    REQUIRE(recorder.isCharging());
+
+    ChargeSession session;
+    REQUIRE(recorder.currentSession(session));
+    REQUIRE(session.startTime == 10);
+    REQUIRE(session.startPercentage == 30);
+
+    // The battery was pulled, which ends the session
+    HostSimulation::fuelGauge().registers[STATUS_REG] = 1 << BATTERY_STATUS_BIT;
+    recorder.update(70, ChargingState::chargerDisabled);
+    REQUIRE(recorder.session(0, session));
+    REQUIRE(session.endPercentage == 0);
+}
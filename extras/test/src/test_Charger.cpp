@@ -0,0 +1,73 @@
+#include <catch2/catch.hpp>
+
+#include "HostSimulation.h"
+#include "Charger.h"
+
+namespace {
+    constexpr pin_size_t PMIC_INTERRUPT_PIN = 7;
+    int stateChanges = 0;
+
+    // Raises another source right after the first clear, like a source firing between reading and clearing the flags
+    void raiseVbusOnFirstClear(Register reg, uint8_t data) {
+        if (reg == Register::CHARGER_CHG_INT && data == CHARGER_INTERRUPT_CHARGER) {
+            PMIC.raiseChargerInterrupt(CHARGER_INTERRUPT_VBUS);
+        }
+    }
+
+    // INTB is released once all sources are cleared
+    void releasePinWhenCleared(Register reg, uint8_t data) {
+        if (reg == Register::CHARGER_CHG_INT && PMIC.readPMICreg(Register::CHARGER_CHG_INT) == 0) {
+            HostSimulation::setPinLevel(PMIC_INTERRUPT_PIN, HIGH);
+        }
+    }
+
+    void countStateChange(ChargingState, ChargingState, uint32_t) {
+        ++stateChanges;
+    }
+}
+
+TEST_CASE("Charger clears sources raised while servicing an interrupt", "[Charger]") {
+    HostSimulation::reset();
+    Charger charger;
+    REQUIRE(charger.enableInterrupts());
+
+    PMIC.onWrite = raiseVbusOnFirstClear;
+    PMIC.raiseChargerInterrupt(CHARGER_INTERRUPT_CHARGER);
+    charger.handleInterrupt();
+
+    REQUIRE(charger.update());
+    REQUIRE(PMIC.readPMICreg(Register::CHARGER_CHG_INT) == 0);
+    REQUIRE(charger.lastInterrupts() == (CHARGER_INTERRUPT_CHARGER | CHARGER_INTERRUPT_VBUS));
+    REQUIRE_FALSE(charger.update());
+}
+
+TEST_CASE("Charger services interrupts from the attached pin", "[Charger]") {
+    HostSimulation::reset();
+    stateChanges = 0;
+    Charger charger;
+    REQUIRE(charger.enableInterrupts());
+    charger.onStateChange(countStateChange);
+    charger.attachInterruptPin(PMIC_INTERRUPT_PIN);
+
+    PMIC.registers[static_cast<uint8_t>(Register::CHARGER_CHG_SNS)] = 3; // End of charge
+    PMIC.raiseChargerInterrupt(CHARGER_INTERRUPT_CHARGER);
+    HostSimulation::setPinLevel(PMIC_INTERRUPT_PIN, LOW);
+
+    SECTION("the pin is released once the flags are cleared") {
+        PMIC.onWrite = releasePinWhenCleared;
+        REQUIRE(charger.update());
+        REQUIRE(digitalRead(PMIC_INTERRUPT_PIN) == HIGH);
+        REQUIRE(charger.lastState() == ChargingState::endOfCharge);
+        REQUIRE(stateChanges == 1);
+        REQUIRE_FALSE(charger.update());
+    }
+
+    SECTION("an interrupt stays pending while the pin is held low") {
+        REQUIRE(charger.update());
+        REQUIRE(charger.update());
+        HostSimulation::setPinLevel(PMIC_INTERRUPT_PIN, HIGH);
+        REQUIRE(charger.update());
+        REQUIRE_FALSE(charger.update());
+        REQUIRE(stateChanges == 1);
+    }
+}
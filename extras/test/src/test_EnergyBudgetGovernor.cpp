@@ -0,0 +1,123 @@
+#include <catch2/catch.hpp>
+
+#include "EnergyBudgetGovernor.h"
+
+namespace {
+    constexpr uint32_t HOUR = 3600;
+    constexpr uint32_t DAY = 24 * HOUR;
+    constexpr float VOLTAGE = 3.7f;
+    constexpr float BASE_POWER = 0.5f; // mW, standby
+    constexpr float CAPACITY_RESOLUTION = 0.5f; // mAh, the LSB of RepCap
+
+    /**
+     * A battery that powers an application whose activity scales with the duty cycle,
+     * read like the fuel gauge reports it.
+     */
+    struct SimulatedDevice {
+        float capacity = 2000.0f; // mAh
+        float activityPower = 100.0f; // mW at full activity, above the base power
+
+        float power(float dutyCycle) const {
+            return BASE_POWER + dutyCycle * activityPower;
+        }
+
+        void run(float dutyCycle, uint32_t duration) {
+            capacity -= power(dutyCycle) / VOLTAGE * duration / HOUR;
+        }
+
+        float reportedCapacity() const {
+            return floorf(capacity / CAPACITY_RESOLUTION) * CAPACITY_RESOLUTION;
+        }
+    };
+
+    EnergyBudgetGovernor makeGovernor(uint32_t deadline) {
+        EnergyBudgetGovernor governor;
+        governor.setDeadline(deadline);
+        governor.setReserveCapacity(100.0f);
+        governor.setBasePower(BASE_POWER);
+        return governor;
+    }
+
+    // Runs the device with the duty cycle of the governor, updating it every 10 minutes
+    EnergyBudget simulate(EnergyBudgetGovernor &governor, SimulatedDevice &device, uint32_t start, uint32_t end, bool *replanned = nullptr) {
+        constexpr uint32_t UPDATE_INTERVAL = 600;
+        EnergyBudget budget = governor.budget();
+        for (uint32_t now = start; now < end; now += UPDATE_INTERVAL) {
+            budget = governor.update(now, device.reportedCapacity(), device.power(budget.dutyCycle), VOLTAGE);
+            if (replanned != nullptr && budget.replanned) {
+                *replanned = true;
+            }
+            device.run(budget.dutyCycle, UPDATE_INTERVAL);
+        }
+        return budget;
+    }
+}
+
+TEST_CASE("EnergyBudgetGovernor makes the battery last until the deadline", "[EnergyBudgetGovernor]") {
+    const uint32_t deadline = 7 * DAY;
+    EnergyBudgetGovernor governor = makeGovernor(deadline);
+    SimulatedDevice device;
+
+    // Spread 1900mAh over a week: (1900mAh * 3.7V / 168h - 0.5mW) / 100mW
+    const float plannedDutyCycle = (1900.0f * VOLTAGE / 168.0f - BASE_POWER) / device.activityPower;
+
+    EnergyBudget budget = simulate(governor, device, 0, DAY);
+    REQUIRE(budget.dutyCycle == Approx(plannedDutyCycle).epsilon(0.05));
+    REQUIRE(budget.fullActivityPower == Approx(BASE_POWER + device.activityPower).epsilon(0.05));
+
+    budget = simulate(governor, device, DAY, 6 * DAY);
+    REQUIRE(budget.onTrack);
+    REQUIRE(budget.dutyCycle == Approx(plannedDutyCycle).epsilon(0.05));
+
+    simulate(governor, device, 6 * DAY, deadline);
+    REQUIRE(device.capacity > 95.0f);
+    REQUIRE(device.capacity < 130.0f);
+}
+
+TEST_CASE("EnergyBudgetGovernor lowers the duty cycle when the load increases", "[EnergyBudgetGovernor]") {
+    const uint32_t deadline = 7 * DAY;
+    EnergyBudgetGovernor governor = makeGovernor(deadline);
+    SimulatedDevice device;
+
+    EnergyBudget before = simulate(governor, device, 0, 2 * DAY);
+
+    // E.g. a weaker radio link makes each transmission cost twice as much
+    device.activityPower *= 2.0f;
+    bool replanned = false;
+    EnergyBudget after = simulate(governor, device, 2 * DAY, 3 * DAY, &replanned);
+    REQUIRE(replanned);
+    REQUIRE(after.fullActivityPower == Approx(BASE_POWER + device.activityPower).epsilon(0.1));
+    REQUIRE(after.dutyCycle < 0.6f * before.dutyCycle);
+
+    simulate(governor, device, 3 * DAY, deadline);
+    REQUIRE(device.capacity > 95.0f);
+    REQUIRE(device.capacity < 130.0f);
+}
+
+TEST_CASE("EnergyBudgetGovernor replans after the battery was charged", "[EnergyBudgetGovernor]") {
+    const uint32_t deadline = 7 * DAY;
+    EnergyBudgetGovernor governor = makeGovernor(deadline);
+    SimulatedDevice device;
+
+    EnergyBudget before = simulate(governor, device, 0, 2 * DAY);
+
+    device.capacity += 500.0f; // E.g. a few hours in the sun
+    bool replanned = false;
+    EnergyBudget after = simulate(governor, device, 2 * DAY, 2 * DAY + HOUR, &replanned);
+    REQUIRE(replanned);
+    REQUIRE(after.dutyCycle > before.dutyCycle);
+
+    simulate(governor, device, 2 * DAY + HOUR, deadline);
+    REQUIRE(device.capacity > 95.0f);
+    REQUIRE(device.capacity < 130.0f);
+}
+
+TEST_CASE("EnergyBudgetGovernor keeps the minimum duty cycle when the budget is used up", "[EnergyBudgetGovernor]") {
+    EnergyBudgetGovernor governor = makeGovernor(30 * DAY);
+    SimulatedDevice device;
+    device.capacity = 150.0f;
+
+    EnergyBudget budget = simulate(governor, device, 0, DAY);
+    REQUIRE(budget.dutyCycle == Approx(DEFAULT_BUDGET_MINIMUM_DUTY_CYCLE));
+    REQUIRE_FALSE(budget.onTrack);
+}
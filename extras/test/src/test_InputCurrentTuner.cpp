@@ -0,0 +1,80 @@
+#include <catch2/catch.hpp>
+
+#include "HostSimulation.h"
+#include "InputCurrentTuner.h"
+
+namespace {
+    // Calls update() every 100ms, returns the time after the last call
+    uint32_t run(InputCurrentTuner &tuner, uint32_t start, uint32_t duration) {
+        uint32_t now = start;
+        for (; now - start < duration; now += 100) {
+            tuner.update(now);
+        }
+        return now;
+    }
+}
+
+TEST_CASE("InputCurrentTuner finds the highest limit a source sustains", "[InputCurrentTuner]") {
+    HostSimulation::reset();
+    SimulatedPowerSource source(1.0f); // 5V, valid down to 4.35V
+    InputCurrentTuner tuner(source);
+    REQUIRE(tuner.begin(0));
+
+    uint32_t now = run(tuner, 0, 60000);
+    REQUIRE(tuner.limit() == 600);
+    REQUIRE(tuner.ceiling() == 700);
+    REQUIRE(tuner.state() == InputCurrentTunerState::holding);
+    REQUIRE(source.isInputValid());
+
+    SECTION("the limit follows a source that gets weaker and recovers") {
+        source.setResistance(2.0f);
+        now = run(tuner, now, 1000);
+        REQUIRE(tuner.limit() == 300);
+        REQUIRE(tuner.state() == InputCurrentTunerState::holding);
+
+        source.setResistance(1.0f);
+        run(tuner, now, 15 * 60000);
+        REQUIRE(tuner.limit() == 600);
+    }
+
+    SECTION("the tuner waits at the minimum when the source is removed") {
+        uint32_t sags = tuner.sags();
+        source.setConnected(false);
+        now = run(tuner, now, 10000);
+        REQUIRE(tuner.state() == InputCurrentTunerState::noSource);
+        REQUIRE(tuner.limit() == 100);
+        REQUIRE(tuner.sags() > sags);
+
+        source.setConnected(true);
+        run(tuner, now, 60000);
+        REQUIRE(tuner.limit() == 600);
+    }
+}
+
+TEST_CASE("InputCurrentTuner goes up to the maximum with a strong source", "[InputCurrentTuner]") {
+    HostSimulation::reset();
+    SimulatedPowerSource source(0.1f);
+    InputCurrentTuner tuner(source);
+    REQUIRE(tuner.begin(0));
+
+    run(tuner, 0, 120000);
+    REQUIRE(tuner.limit() == 1500);
+    REQUIRE(tuner.ceiling() == 0);
+    REQUIRE(tuner.sags() == 0);
+}
+
+TEST_CASE("PMICInputCurrentControl reads the input state from VBUS_SNS", "[InputCurrentTuner]") {
+    HostSimulation::reset();
+    Charger charger;
+    PMICInputCurrentControl input(charger);
+    uint8_t &vbusSense = PMIC.registers[static_cast<uint8_t>(Register::CHARGER_VBUS_SNS)];
+
+    REQUIRE(input.setInputCurrentLimit(500));
+    REQUIRE(charger.getInputCurrentLimit() == 500);
+
+    REQUIRE_FALSE(input.isInputValid());
+    vbusSense = 1 << CHARGER_VBUS_VALID_BIT;
+    REQUIRE(input.isInputValid());
+    vbusSense |= 1 << CHARGER_VBUS_UVLO_BIT;
+    REQUIRE_FALSE(input.isInputValid());
+}
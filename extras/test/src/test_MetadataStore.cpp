@@ -0,0 +1,222 @@
+#include <catch2/catch.hpp>
+
+#include <map>
+#include <stdio.h>
+
+#include "MetadataStore.h"
+
+namespace {
+    const char *STORAGE_PATH = "metadata_store_test.bin";
+    constexpr uint32_t SECTOR_SIZE = 128; // Room for 6 records per sector
+    constexpr uint32_t SECTOR_COUNT = 4;
+
+    /**
+     * Loses the power after the given number of program and erase operations.
+     * The operation that is interrupted only programs half of its bytes, or leaves half of the sector
+     * programmed instead of erased, and every later one fails.
+     */
+    class PowerLossStorage : public BlockStorage {
+        public:
+            PowerLossStorage(BlockStorage &storage, uint32_t operations) : storage(storage), operationsLeft(operations) {
+            }
+
+            bool read(uint32_t address, void *data, uint32_t size) override {
+                return powered() && storage.read(address, data, size);
+            }
+
+            bool program(uint32_t address, const void *data, uint32_t size) override {
+                if (!consumeOperation()) {
+                    if (operationsLeft == 0 && !lost) {
+                        lost = true;
+                        storage.program(address, data, size / 2);
+                    }
+                    return false;
+                }
+                return storage.program(address, data, size);
+            }
+
+            bool erase(uint32_t address, uint32_t size) override {
+                if (!consumeOperation()) {
+                    if (operationsLeft == 0 && !lost) {
+                        lost = true;
+                        uint8_t zeros[SECTOR_SIZE / 2] = {};
+                        storage.erase(address, size);
+                        storage.program(address + size / 2, zeros, sizeof(zeros));
+                    }
+                    return false;
+                }
+                return storage.erase(address, size);
+            }
+
+            uint32_t eraseSize() override { return storage.eraseSize(); }
+            uint32_t programSize() override { return storage.programSize(); }
+            uint32_t size() override { return storage.size(); }
+
+            bool powered() { return !lost; }
+
+        private:
+            bool consumeOperation() {
+                if (operationsLeft == 0) {
+                    return false;
+                }
+                return --operationsLeft > 0;
+            }
+
+            BlockStorage &storage;
+            uint32_t operationsLeft;
+            bool lost = false;
+    };
+
+    uint32_t readKey(MetadataStoreBase &store, uint16_t key) {
+        uint32_t value = 0;
+        return store.get(key, value) ? value : UINT32_MAX;
+    }
+}
+
+TEST_CASE("MetadataStore keeps values in a file across restarts", "[MetadataStore]") {
+    remove(STORAGE_PATH);
+    {
+        FileBlockStorage storage(STORAGE_PATH, SECTOR_SIZE * SECTOR_COUNT, SECTOR_SIZE);
+        MetadataStore<8> store(storage);
+        REQUIRE(store.begin());
+        REQUIRE(store.put<uint32_t>(1, 100));
+        REQUIRE(store.put<uint32_t>(2, 200));
+        REQUIRE(store.put<uint32_t>(1, 101));
+        REQUIRE(store.remove(2));
+    }
+
+    FileBlockStorage storage(STORAGE_PATH, SECTOR_SIZE * SECTOR_COUNT, SECTOR_SIZE);
+    MetadataStore<8> store(storage);
+    REQUIRE(store.begin());
+    REQUIRE(readKey(store, 1) == 101);
+    REQUIRE(readKey(store, 2) == UINT32_MAX);
+    remove(STORAGE_PATH);
+}
+
+TEST_CASE("MetadataStore compacts the oldest sector when the log wraps around", "[MetadataStore]") {
+    remove(STORAGE_PATH);
+    FileBlockStorage storage(STORAGE_PATH, SECTOR_SIZE * SECTOR_COUNT, SECTOR_SIZE);
+    MetadataStore<8> store(storage);
+    REQUIRE(store.begin());
+
+    REQUIRE(store.put<uint32_t>(100, 42)); // Written once, has to survive every compaction
+    for (uint32_t value = 0; value < 200; ++value) {
+        REQUIRE(store.put<uint32_t>(value % 4, value));
+    }
+
+    MetadataStoreStats stats = store.stats();
+    REQUIRE(stats.compactions > 0);
+    REQUIRE(stats.maximumEraseCount - stats.minimumEraseCount <= 1);
+    REQUIRE(readKey(store, 100) == 42);
+    for (uint16_t key = 0; key < 4; ++key) {
+        REQUIRE(readKey(store, key) == 196u + key);
+    }
+
+    // The same after reading the log from the file again
+    MetadataStore<8> reopened(storage);
+    REQUIRE(reopened.begin());
+    REQUIRE(readKey(reopened, 100) == 42);
+    REQUIRE(readKey(reopened, 3) == 199);
+    remove(STORAGE_PATH);
+}
+
+TEST_CASE("MetadataStore reports a full memory without erasing", "[MetadataStore]") {
+    remove(STORAGE_PATH);
+    FileBlockStorage storage(STORAGE_PATH, SECTOR_SIZE * SECTOR_COUNT, SECTOR_SIZE);
+    MetadataStore<64> store(storage);
+    REQUIRE(store.begin());
+
+    uint16_t keys = 0;
+    while (store.put<uint32_t>(keys, keys)) {
+        ++keys;
+        REQUIRE(keys < 64);
+    }
+    REQUIRE(keys > 0);
+
+    uint32_t erases = store.stats().erases;
+    for (int attempt = 0; attempt < 10; ++attempt) {
+        REQUIRE_FALSE(store.put<uint32_t>(keys, keys));
+        REQUIRE_FALSE(store.put<uint32_t>(0, 1000));
+    }
+    REQUIRE(store.stats().erases == erases);
+
+    // A removal needs room for its record too, the values stay readable
+    REQUIRE_FALSE(store.remove(1));
+    REQUIRE(store.stats().erases == erases);
+    REQUIRE(readKey(store, 0) == 0);
+    REQUIRE(readKey(store, keys - 1) == keys - 1u);
+    remove(STORAGE_PATH);
+}
+
+TEST_CASE("MetadataStore rejects more keys than its index holds", "[MetadataStore]") {
+    remove(STORAGE_PATH);
+    FileBlockStorage storage(STORAGE_PATH, SECTOR_SIZE * SECTOR_COUNT, SECTOR_SIZE);
+    {
+        MetadataStore<4> store(storage);
+        REQUIRE(store.begin());
+        for (uint16_t key = 0; key < 4; ++key) {
+            REQUIRE(store.put<uint32_t>(key, key));
+        }
+        REQUIRE_FALSE(store.put<uint32_t>(4, 4));
+        REQUIRE(store.put<uint32_t>(3, 30));
+    }
+
+    MetadataStore<2> smallStore(storage);
+    REQUIRE_FALSE(smallStore.begin());
+    MetadataStore<4> store(storage);
+    REQUIRE(store.begin());
+    REQUIRE(readKey(store, 3) == 30);
+    remove(STORAGE_PATH);
+}
+
+TEST_CASE("MetadataStore survives a power loss at any point", "[MetadataStore]") {
+    constexpr uint16_t KEYS = 4;
+    constexpr uint32_t UPDATES = 60; // Wraps around the log several times
+
+    bool completed = false;
+    for (uint32_t operations = 1; !completed; ++operations) {
+        INFO("Power lost after " << operations << " operations");
+        remove(STORAGE_PATH);
+        FileBlockStorage file(STORAGE_PATH, SECTOR_SIZE * SECTOR_COUNT, SECTOR_SIZE);
+        PowerLossStorage storage(file, operations);
+        std::map<uint16_t, uint32_t> committed;
+        uint16_t interruptedKey = UINT16_MAX;
+        uint32_t interruptedValue = 0;
+
+        MetadataStore<8> store(storage);
+        if (store.begin()) {
+            for (uint32_t update = 0; update < UPDATES; ++update) {
+                uint16_t key = update % KEYS;
+                if (!store.put<uint32_t>(key, update)) {
+                    interruptedKey = key;
+                    interruptedValue = update;
+                    break;
+                }
+                committed[key] = update;
+            }
+        }
+        completed = storage.powered();
+
+        // After the restart every key holds its last written value, the interrupted one may hold either
+        MetadataStore<8> restarted(file);
+        REQUIRE(restarted.begin());
+        for (uint16_t key = 0; key < KEYS; ++key) {
+            uint32_t value = readKey(restarted, key);
+            uint32_t previous = committed.count(key) ? committed[key] : UINT32_MAX;
+            if (key == interruptedKey) {
+                REQUIRE((value == previous || value == interruptedValue));
+            } else {
+                REQUIRE(value == previous);
+            }
+        }
+
+        // And the store keeps working
+        for (uint32_t update = 0; update < 2 * KEYS; ++update) {
+            REQUIRE(restarted.put<uint32_t>(update % KEYS, 1000 + update));
+        }
+        for (uint16_t key = 0; key < KEYS; ++key) {
+            REQUIRE(readKey(restarted, key) == 1000u + KEYS + key);
+        }
+    }
+    remove(STORAGE_PATH);
+}
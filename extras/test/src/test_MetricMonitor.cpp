@@ -0,0 +1,76 @@
+#include <catch2/catch.hpp>
+
+#include "HostSimulation.h"
+#include "MetricMonitor.h"
+#include "BatteryConstants.h"
+
+namespace {
+    MetricMonitor *monitor = nullptr;
+    int16_t removedId = -1;
+    int firstCalls = 0;
+    int secondCalls = 0;
+
+    void removeNext(BatteryMetric, float) {
+        ++firstCalls;
+        monitor->remove(removedId);
+    }
+
+    void countSecond(BatteryMetric, float) {
+        ++secondCalls;
+    }
+
+    void countFirst(BatteryMetric, float) {
+        ++firstCalls;
+    }
+
+    BatterySample sampleWith(BatteryMetric metric, float value) {
+        BatterySample sample;
+        sample[metric] = value;
+        return sample;
+    }
+}
+
+TEST_CASE("MetricMonitor doesn't evaluate a subscription removed by an earlier callback", "[MetricMonitor]") {
+    MetricMonitor localMonitor;
+    monitor = &localMonitor;
+    firstCalls = 0;
+    secondCalls = 0;
+
+    REQUIRE(localMonitor.below(BatteryMetric::percentage, 20, 2, removeNext) >= 0);
+    removedId = localMonitor.below(BatteryMetric::percentage, 20, 2, countSecond);
+    REQUIRE(removedId >= 0);
+
+    REQUIRE(localMonitor.update(sampleWith(BatteryMetric::percentage, 15)) == 1);
+    REQUIRE(firstCalls == 1);
+    REQUIRE(secondCalls == 0);
+    REQUIRE(localMonitor.count() == 1);
+
+    // The freed entry is reused by another metric, it must not be evaluated on the percentage either
+    REQUIRE(localMonitor.above(BatteryMetric::temperature, 50, 2, countSecond) == removedId);
+    localMonitor.update(sampleWith(BatteryMetric::percentage, 30));
+    REQUIRE(localMonitor.update(sampleWith(BatteryMetric::percentage, 10)) == 1);
+    REQUIRE(secondCalls == 0);
+}
+
+TEST_CASE("MetricMonitor ignores the fuel gauge while no battery is connected", "[MetricMonitor]") {
+    HostSimulation::reset();
+    Battery battery;
+    MetricMonitor localMonitor;
+    firstCalls = 0;
+    secondCalls = 0;
+    localMonitor.below(BatteryMetric::percentage, 20, 2, countFirst);
+    localMonitor.above(BatteryMetric::percentage, 80, 2, countSecond);
+
+    HostSimulation::fuelGauge().registers[REP_SOC_REG] = 50 * 256;
+    REQUIRE(localMonitor.update(battery) == 0);
+
+    HostSimulation::fuelGauge().registers[STATUS_REG] = 1 << BATTERY_STATUS_BIT;
+    REQUIRE(localMonitor.update(battery) == 0);
+    REQUIRE(firstCalls == 0);
+    REQUIRE(secondCalls == 0);
+
+    HostSimulation::fuelGauge().registers[STATUS_REG] = 0;
+    HostSimulation::fuelGauge().registers[REP_SOC_REG] = 15 * 256;
+    REQUIRE(localMonitor.update(battery) == 1);
+    REQUIRE(firstCalls == 1);
+}
@@ -0,0 +1,126 @@
+#include <catch2/catch.hpp>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "HostSimulation.h"
+#include "PowerEventQueue.h"
+
+namespace {
+    std::vector<PowerEvent> received;
+
+    void record(const PowerEvent &event) {
+        received.push_back(event);
+    }
+}
+
+TEST_CASE("PowerEventQueue drops and counts events when full", "[PowerEventQueue]") {
+    HostSimulation::reset();
+    PowerEventQueue<4> queue;
+
+    for (uint32_t value = 0; value < 6; ++value) {
+        REQUIRE(queue.push(PowerEventType::custom, value) == (value < 4));
+    }
+    REQUIRE(queue.count() == 4);
+    REQUIRE(queue.dropped() == 2);
+
+    PowerEvent event;
+    for (uint32_t value = 0; value < 4; ++value) {
+        REQUIRE(queue.pop(event));
+        REQUIRE(event.value == value);
+    }
+    REQUIRE_FALSE(queue.pop(event));
+    REQUIRE(queue.isEmpty());
+}
+
+TEST_CASE("PowerEventDispatcher coalesces bursts of state of charge changes", "[PowerEventQueue]") {
+    HostSimulation::reset();
+    received.clear();
+    PowerEventQueue<16> queue;
+    PowerEventDispatcher dispatcher(queue);
+    REQUIRE(dispatcher.on(PowerEventType::stateOfChargeChanged, record));
+    REQUIRE(dispatcher.on(PowerEventType::custom, record));
+
+    queue.push(PowerEventType::stateOfChargeChanged, 50);
+    queue.push(PowerEventType::custom, 1);
+    queue.push(PowerEventType::stateOfChargeChanged, 49);
+    queue.push(PowerEventType::stateOfChargeChanged, 48);
+    queue.push(PowerEventType::custom, 2);
+
+    REQUIRE(dispatcher.dispatch() == 3);
+    REQUIRE(dispatcher.coalesced() == 2);
+    REQUIRE(received.size() == 3);
+    REQUIRE(received[0].value == 1);
+    REQUIRE(received[1].value == 2);
+    REQUIRE(received[2].type == PowerEventType::stateOfChargeChanged);
+    REQUIRE(received[2].value == 48);
+
+    SECTION("without coalescing every event is delivered in order") {
+        received.clear();
+        dispatcher.setCoalescing(PowerEventType::stateOfChargeChanged, false);
+        queue.push(PowerEventType::stateOfChargeChanged, 47);
+        queue.push(PowerEventType::stateOfChargeChanged, 46);
+        REQUIRE(dispatcher.dispatch() == 2);
+        REQUIRE(received.size() == 2);
+        REQUIRE(received[0].value == 47);
+        REQUIRE(received[1].value == 46);
+    }
+}
+
+TEST_CASE("PowerEventQueue delivers the events of a producer thread in order", "[PowerEventQueue]") {
+    constexpr uint32_t EVENTS = 100000;
+    HostSimulation::reset();
+    received.clear();
+    received.reserve(EVENTS);
+    PowerEventQueue<16> queue;
+    PowerEventDispatcher dispatcher(queue);
+    REQUIRE(dispatcher.on(PowerEventType::custom, record));
+    std::atomic<bool> producing{true};
+
+    SECTION("a producer that retries loses nothing") {
+        std::thread producer([&] {
+            for (uint32_t value = 0; value < EVENTS; ++value) {
+                while (!queue.push(PowerEventType::custom, value)) {
+                    std::this_thread::yield();
+                }
+            }
+            producing = false;
+        });
+        while (producing || !queue.isEmpty()) {
+            if (dispatcher.dispatch() == 0) {
+                std::this_thread::yield();
+            }
+        }
+        producer.join();
+
+        REQUIRE(received.size() == EVENTS);
+        for (uint32_t index = 0; index < EVENTS; ++index) {
+            REQUIRE(received[index].value == index);
+        }
+        REQUIRE(queue.dropped() > 0); // The retries were counted as drops
+    }
+
+    SECTION("a producer that doesn't wait only loses what it counted as dropped") {
+        std::thread producer([&] {
+            for (uint32_t value = 0; value < EVENTS; ++value) {
+                queue.push(PowerEventType::custom, value);
+                if (value % 64 == 0) {
+                    std::this_thread::yield();
+                }
+            }
+            producing = false;
+        });
+        while (producing || !queue.isEmpty()) {
+            if (dispatcher.dispatch() == 0) {
+                std::this_thread::yield();
+            }
+        }
+        producer.join();
+
+        REQUIRE(received.size() + queue.dropped() == EVENTS);
+        for (size_t index = 1; index < received.size(); ++index) {
+            REQUIRE(received[index].value > received[index - 1].value);
+        }
+    }
+}
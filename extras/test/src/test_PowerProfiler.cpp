@@ -0,0 +1,130 @@
+#include <catch2/catch.hpp>
+
+#include <vector>
+
+#include "HostSimulation.h"
+#include "PowerProfiler.h"
+
+namespace {
+    /**
+     * Returns a scripted series of readings, one per sample interval.
+     * Configurations named "broken" can't be applied.
+     */
+    class ScriptedTarget : public PowerProfileTarget {
+        public:
+            ScriptedTarget(const std::vector<float> &currents, float voltage) : currents(currents), voltage(voltage) {
+            }
+
+            bool applyConfiguration(const PowerProfileConfiguration &configuration) override {
+                ++applied;
+                return strcmp(configuration.mode.name, "broken") != 0;
+            }
+            bool isChargerEnabled() override { return chargerEnabled; }
+            bool setChargerEnabled(bool enabled) override { chargerEnabled = enabled; return true; }
+            float averageCurrent() override { return currents[min(sample, currents.size() - 1)]; }
+            float averagePower() override { return averageCurrent() * voltage; }
+            void wait(uint32_t duration) override {
+                time += duration;
+                if (sampling) {
+                    ++sample;
+                }
+                sampling = true; // The first wait is the settle time
+            }
+            uint32_t now() override { return time; }
+
+            std::vector<float> currents;
+            float voltage;
+            size_t sample = 0;
+            bool sampling = false;
+            bool chargerEnabled = true;
+            uint32_t time = 0;
+            int applied = 0;
+    };
+}
+
+TEST_CASE("PowerProfiler computes the mean and sample variance of the readings", "[PowerProfiler]") {
+    HostSimulation::reset();
+    // A large offset with small deviations, where summing the squares would lose the variance in float
+    std::vector<float> currents;
+    for (int index = 0; index < 60; ++index) {
+        currents.push_back(1000.0f + (index % 3) * 0.1f);
+    }
+    ScriptedTarget target(currents, 3.7f);
+    PowerProfiler profiler(target);
+    profiler.setSettleTime(1000);
+    profiler.setSampleInterval(500);
+    profiler.setSampleWindow(30000);
+
+    PowerProfileResult result = profiler.profile({ PowerMode("offset"), false });
+
+    double mean = 0.0;
+    for (float current : currents) {
+        mean += current;
+    }
+    mean /= currents.size();
+    double variance = 0.0;
+    for (float current : currents) {
+        variance += (current - mean) * (current - mean);
+    }
+    variance /= currents.size() - 1;
+
+    REQUIRE(result.valid);
+    REQUIRE(result.samples == 60);
+    REQUIRE(result.meanCurrent == Approx(mean).epsilon(1e-6));
+    REQUIRE(result.currentVariance == Approx(variance).epsilon(1e-3));
+    REQUIRE(result.meanPower == Approx(mean * 3.7).epsilon(1e-6));
+    REQUIRE(result.powerVariance == Approx(variance * 3.7 * 3.7).epsilon(1e-2));
+}
+
+TEST_CASE("PowerProfiler reports configurations that can't be applied", "[PowerProfiler]") {
+    HostSimulation::reset();
+    ScriptedTarget target({ 5.0f }, 3.7f);
+    PowerProfiler profiler(target);
+    PowerProfileConfiguration configurations[] = {
+        { PowerMode("broken"), false },
+        { PowerMode("constant"), false }
+    };
+    PowerProfileResult results[2];
+
+    profiler.run(configurations, 2, results);
+
+    REQUIRE_FALSE(results[0].valid);
+    REQUIRE(results[0].samples == 0);
+    REQUIRE(results[1].valid);
+    REQUIRE(results[1].meanCurrent == Approx(5.0f));
+    REQUIRE(results[1].currentVariance == Approx(0.0f).margin(1e-6));
+    REQUIRE(target.chargerEnabled);
+}
+
+TEST_CASE("PowerProfiler runs a series of configurations against the simulated board", "[PowerProfiler]") {
+    HostSimulation::reset();
+    SimulatedPowerProfileTarget target(10.0f, 3.7f);
+    target.setRailCurrent(PowerRail::sw1, 30.0f);
+    target.setRailCurrent(PowerRail::ldo1, 5.0f);
+    target.setChargerCurrent(2.0f);
+    PowerProfiler profiler(target);
+    profiler.setSettleTime(30000); // More than five time constants of the simulated filter
+
+    const PowerProfileConfiguration configurations[] = {
+        { PowerMode("All on").withRail(PowerRail::sw1, true).withRail(PowerRail::ldo1, true), false },
+        { PowerMode("Radio off").withRail(PowerRail::sw1, false), false },
+        { PowerMode("Radio off, charging").withRail(PowerRail::sw1, false), true }
+    };
+    PowerProfileResult results[3];
+
+    target.setChargerEnabled(false);
+    profiler.run(configurations, 3, results);
+
+    REQUIRE(results[0].valid);
+    REQUIRE(results[0].samples == DEFAULT_PROFILE_SAMPLE_WINDOW / DEFAULT_PROFILE_SAMPLE_INTERVAL);
+    REQUIRE(results[0].meanCurrent == Approx(45.0f).epsilon(0.01));
+    REQUIRE(results[0].meanPower == Approx(45.0f * 3.7f).epsilon(0.01));
+    REQUIRE(results[1].meanCurrent == Approx(15.0f).epsilon(0.01));
+    REQUIRE(results[1].meanCurrent > 15.0f); // The rest of the step from the previous configuration
+    REQUIRE(results[2].meanCurrent == Approx(17.0f).epsilon(0.01));
+
+    // The charger is set back, the rails stay in the last configuration
+    REQUIRE_FALSE(target.isChargerEnabled());
+    REQUIRE(target.instantCurrent() == Approx(15.0f));
+    REQUIRE(target.now() == 3 * (30000 + DEFAULT_PROFILE_SAMPLE_WINDOW));
+}
@@ -0,0 +1,108 @@
+#include <catch2/catch.hpp>
+
+#include <random>
+
+#include "HostSimulation.h"
+#include "RailCurrentEstimator.h"
+#include "BatteryConstants.h"
+
+namespace {
+    constexpr float BASELINE = 3.0f; // mA
+    constexpr float RAIL_CURRENTS[POWER_RAIL_COUNT] = {40.0f, 12.0f, 5.0f, 1.5f, 8.0f}; // SW1, SW2, LDO1-LDO3
+
+    PowerMode modeFor(uint8_t enabledRails) {
+        PowerMode mode;
+        for (uint8_t index = 0; index < POWER_RAIL_COUNT; ++index) {
+            mode = mode.withRail(static_cast<PowerRail>(index), bitRead(enabledRails, index));
+        }
+        return mode;
+    }
+
+    float currentFor(uint8_t enabledRails) {
+        float current = BASELINE;
+        for (uint8_t index = 0; index < POWER_RAIL_COUNT; ++index) {
+            if (bitRead(enabledRails, index)) {
+                current += RAIL_CURRENTS[index];
+            }
+        }
+        return current;
+    }
+
+    // Feeds the settle and averaging windows for one configuration, with the noise of the gauge
+    void sample(RailCurrentEstimator &estimator, const PowerMode &mode, float current, std::mt19937 &random) {
+        std::normal_distribution<float> noise(0.0f, 0.5f);
+        for (uint8_t count = 0; count < DEFAULT_RAIL_SETTLE_SAMPLES + DEFAULT_RAIL_AVERAGE_SAMPLES; ++count) {
+            estimator.update(mode, current + noise(random));
+        }
+    }
+}
+
+TEST_CASE("RailCurrentEstimator separates rails that are switched together", "[RailCurrentEstimator]") {
+    RailCurrentEstimator estimator;
+    std::mt19937 random(42);
+    std::uniform_int_distribution<int> configurations(0, (1 << POWER_RAIL_COUNT) - 1);
+
+    // Several rails change between most configurations, no rail is ever switched alone on purpose
+    for (int step = 0; step < 200; ++step) {
+        uint8_t rails = configurations(random);
+        sample(estimator, modeFor(rails), currentFor(rails), random);
+    }
+
+    REQUIRE(estimator.baselineCurrent() == Approx(BASELINE).margin(0.5f));
+    for (uint8_t index = 0; index < POWER_RAIL_COUNT; ++index) {
+        PowerRail rail = static_cast<PowerRail>(index);
+        REQUIRE(estimator.railCurrent(rail) == Approx(RAIL_CURRENTS[index]).margin(0.5f));
+        REQUIRE(estimator.observations(rail) > 50);
+    }
+
+    PowerMode radioOnly = PowerMode().withRail(PowerRail::sw1, true).withRail(PowerRail::sw2, false)
+        .withRail(PowerRail::ldo1, false).withRail(PowerRail::ldo2, false).withRail(PowerRail::ldo3, false);
+    REQUIRE(estimator.estimatedCurrent(radioOnly) == Approx(BASELINE + RAIL_CURRENTS[0]).margin(1.0f));
+}
+
+TEST_CASE("RailCurrentEstimator relearns a rail after its voltage changed", "[RailCurrentEstimator]") {
+    RailCurrentEstimator estimator;
+    std::mt19937 random(7);
+
+    PowerMode off = PowerMode().withRail(PowerRail::sw2, false, 3.3f);
+    PowerMode on = PowerMode().withRail(PowerRail::sw2, true, 3.3f);
+    for (int step = 0; step < 20; ++step) {
+        sample(estimator, off, BASELINE, random);
+        sample(estimator, on, BASELINE + 12.0f, random);
+    }
+    REQUIRE(estimator.railCurrent(PowerRail::sw2) == Approx(12.0f).margin(0.5f));
+
+    // The external devices draw less at a lower voltage
+    off = PowerMode().withRail(PowerRail::sw2, false, 1.8f);
+    on = PowerMode().withRail(PowerRail::sw2, true, 1.8f);
+    sample(estimator, off, BASELINE, random);
+    REQUIRE(estimator.observations(PowerRail::sw2) == 0);
+    for (int step = 0; step < 5; ++step) {
+        sample(estimator, on, BASELINE + 6.0f, random);
+        sample(estimator, off, BASELINE, random);
+    }
+    REQUIRE(estimator.railCurrent(PowerRail::sw2) == Approx(6.0f).margin(0.5f));
+}
+
+TEST_CASE("RailCurrentEstimator ignores samples without a battery", "[RailCurrentEstimator]") {
+    HostSimulation::reset();
+    Board board;
+    Battery battery;
+    RailCurrentEstimator estimator;
+    REQUIRE(board.setPowerMode(PowerMode().withRail(PowerRail::sw1, true)));
+
+    HostSimulation::fuelGauge().registers[STATUS_REG] = 1 << BATTERY_STATUS_BIT;
+    for (int count = 0; count < 100; ++count) {
+        estimator.update(board, battery);
+    }
+    REQUIRE(estimator.baselineCurrent() == 0.0f);
+    REQUIRE(estimator.railCurrent(PowerRail::sw1) == 0.0f);
+
+    // 64 LSB of 0.15625mA drawn from the battery
+    HostSimulation::fuelGauge().registers[STATUS_REG] = 0;
+    HostSimulation::fuelGauge().registers[CURRENT_REG] = static_cast<uint16_t>(-64);
+    for (int count = 0; count < 100; ++count) {
+        estimator.update(board, battery);
+    }
+    REQUIRE(estimator.estimatedCurrent(PowerMode()) == Approx(10.0f).margin(0.01f));
+}
@@ -0,0 +1,60 @@
+#include <catch2/catch.hpp>
+
+#include <cstring>
+
+#include "HostSimulation.h"
+#include "SleepTracker.h"
+#include "BatteryConstants.h"
+
+namespace {
+    // Stands in for the backup registers, which survive standby
+    class RamSleepStateStore : public SleepStateStore {
+        public:
+            bool write(const uint8_t *data, uint8_t length) override {
+                memcpy(bytes, data, length);
+                return true;
+            }
+
+            bool read(uint8_t *data, uint8_t length) override {
+                memcpy(data, bytes, length);
+                return true;
+            }
+
+            uint8_t bytes[SLEEP_RECORD_SIZE] = {};
+    };
+
+    void advanceGaugeTimer(float seconds) {
+        HostSimulation::FuelGauge &gauge = HostSimulation::fuelGauge();
+        uint32_t timer = (static_cast<uint32_t>(gauge.registers[TIMER_H_REG]) << 16) | gauge.registers[TIMER_REG];
+        timer += static_cast<uint32_t>(seconds / TIMER_MULTIPLIER_S);
+        gauge.registers[TIMER_H_REG] = timer >> 16;
+        gauge.registers[TIMER_REG] = timer & 0xFFFF;
+    }
+}
+
+TEST_CASE("SleepTracker infers the wakeup reason from the duration without wakeup flags", "[SleepTracker]") {
+    HostSimulation::reset();
+    Battery battery;
+    RamSleepStateStore store;
+    SleepTracker tracker(battery, store);
+    SleepReport report;
+
+    REQUIRE(tracker.saveRecord(600, true));
+    advanceGaugeTimer(600);
+    REQUIRE(tracker.wokeUpFromStandby(report));
+    REQUIRE(report.programmedDelay == 600);
+    REQUIRE(report.wakeupReason == WakeupReason::timeElapsed);
+
+    // The record is only reported once
+    REQUIRE_FALSE(tracker.wokeUpFromStandby(report));
+
+    REQUIRE(tracker.saveRecord(600, true));
+    advanceGaugeTimer(120);
+    REQUIRE(tracker.wokeUpFromStandby(report));
+    REQUIRE(report.wakeupReason == WakeupReason::pinActivity);
+
+    REQUIRE(tracker.saveRecord(600, false));
+    advanceGaugeTimer(120);
+    REQUIRE(tracker.wokeUpFromStandby(report));
+    REQUIRE(report.wakeupReason == WakeupReason::unknown);
+}
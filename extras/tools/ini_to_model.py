@@ -0,0 +1,122 @@
+#!/usr/bin/env python3
+"""
+Converts a ModelGauge m5 INI file of a characterised cell into a C++ header
+that defines a BatteryModel for Battery::useModel().
+
+Usage:
+    python3 ini_to_model.py MyCell.INI -n myCellModel -o MyCellModel.h
+
+The parser accepts the usual layouts of the model table, either one register per line
+("0x80 = 0x9B00") or several words after the address of the first one ("0x80: 0x9B00 0xA2E0 ...").
+"""
+
+import argparse
+import re
+import sys
+
+TABLE_START = 0x80
+TABLE_SIZE = 48
+
+# INI key (lower case) -> BatteryModel field
+PARAMETERS = {
+    "rcomp0": "rComp0",
+    "tempco": "tempCo",
+    "qrtable00": "qrTable[0]",
+    "qrtable10": "qrTable[1]",
+    "qrtable20": "qrTable[2]",
+    "qrtable30": "qrTable[3]",
+    "fullsocthr": "fullSocThreshold",
+}
+
+NUMBER = r"(0x[0-9a-fA-F]+|\d+)"
+
+
+def parse_number(text):
+    return int(text, 16) if text.lower().startswith("0x") else int(text)
+
+
+def parse_ini(lines):
+    table = {}
+    parameters = {}
+
+    for line in lines:
+        line = re.split(r"[;#]", line, 1)[0].strip()
+        if not line:
+            continue
+
+        # A named parameter, e.g. "RCOMP0 = 0x0070"
+        named = re.match(r"^([A-Za-z][A-Za-z0-9_ ]*?)\s*=\s*" + NUMBER + r"\s*$", line)
+        if named:
+            key = named.group(1).replace(" ", "").lower()
+            if key in PARAMETERS:
+                parameters[PARAMETERS[key]] = parse_number(named.group(2))
+            continue
+
+        # One or more table words after the address of the first one
+        words = re.match(r"^(0x[0-9a-fA-F]{2})\s*[:=]?\s*(.*)$", line)
+        if words:
+            address = int(words.group(1), 16)
+            values = re.findall(NUMBER, words.group(2))
+            for offset, value in enumerate(values):
+                register = address + offset
+                if TABLE_START <= register < TABLE_START + TABLE_SIZE:
+                    table[register] = parse_number(value)
+
+    return table, parameters
+
+
+def render(name, table, parameters):
+    rows = []
+    for row in range(0, TABLE_SIZE, 8):
+        values = ", ".join("0x%04X" % table[TABLE_START + row + index] for index in range(8))
+        rows.append("        %s, // 0x%02X" % (values, TABLE_START + row))
+
+    return """// Generated by extras/tools/ini_to_model.py, do not edit.
+#ifndef {guard}
+#define {guard}
+
+#include "Arduino_PowerManagement.h"
+
+constexpr BatteryModel {name} = {{
+    {{ // Model table
+{rows}
+    }},
+    0x{rComp0:04X}, // RComp0
+    0x{tempCo:04X}, // TempCo
+    {{ 0x{qrTable0:04X}, 0x{qrTable1:04X}, 0x{qrTable2:04X}, 0x{qrTable3:04X} }}, // QRTable00 - QRTable30
+    0x{fullSocThreshold:04X} // FullSOCThr
+}};
+
+#endif
+""".format(guard=re.sub(r"[^A-Z0-9]", "_", name.upper()) + "_H", name=name, rows="\n".join(rows),
+           rComp0=parameters["rComp0"], tempCo=parameters["tempCo"],
+           qrTable0=parameters["qrTable[0]"], qrTable1=parameters["qrTable[1]"],
+           qrTable2=parameters["qrTable[2]"], qrTable3=parameters["qrTable[3]"],
+           fullSocThreshold=parameters["fullSocThreshold"])
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Converts a ModelGauge m5 INI file into a BatteryModel header.")
+    parser.add_argument("ini", help="the INI file of the characterised cell")
+    parser.add_argument("-n", "--name", default="batteryModel", help="the name of the BatteryModel constant")
+    parser.add_argument("-o", "--output", help="the header to write, standard output if omitted")
+    arguments = parser.parse_args()
+
+    with open(arguments.ini, encoding="latin-1") as file:
+        table, parameters = parse_ini(file)
+
+    missing = ["0x%02X" % (TABLE_START + index) for index in range(TABLE_SIZE) if TABLE_START + index not in table]
+    missing += [field for field in PARAMETERS.values() if field not in parameters]
+    if missing:
+        sys.exit("Missing values in %s: %s" % (arguments.ini, ", ".join(missing)))
+
+    header = render(arguments.name, table, parameters)
+    if arguments.output:
+        with open(arguments.output, "w") as file:
+            file.write(header)
+    else:
+        sys.stdout.write(header)
+
+
+if __name__ == "__main__":
+    main()
@@ -2,7 +2,26 @@
 #define ARDUINO_POWER_MANAGEMENT_H
 
 #include "Battery.h"
+#include "BatteryHealthTracker.h"
+#include "BlockStorage.h"
 #include "Board.h"
+#include "ChargeSessionRecorder.h"
 #include "Charger.h"
+#include "EnergyBudgetGovernor.h"
+#include "EnergyProbe.h"
+#include "GaugePoller.h"
+#include "IdleGovernor.h"
+#include "InputCurrentTuner.h"
+#include "MetadataStore.h"
+#include "MetricMonitor.h"
+#include "PeakTracker.h"
+#include "PowerDomain.h"
+#include "PowerEventQueue.h"
+#include "PowerManagement.h"
+#include "PowerProfiler.h"
+#include "RailCurrentEstimator.h"
+#include "SleepTracker.h"
+#include "TelemetryRollup.h"
+#include "WakeScheduler.h"
 
 #endif
\ No newline at end of file
@@ -16,8 +16,7 @@ bool Battery::begin(bool enforceReload) {
     return false;
   }
 
-  // If hardware / software power-on-reset (POR) event has occurred, reconfigure the battery gauge, otherwise, skip the configuration
-  if (!enforceReload && getBit(this->wire, FUEL_GAUGE_ADDRESS, STATUS_REG, POR_BIT) != 1) {
+  if (!requiresConfiguration(enforceReload)) {
     return true;
   }
 
@@ -25,11 +24,21 @@ bool Battery::begin(bool enforceReload) {
     return false; // Timeout while waiting for the battery gauge to be ready
   }
 
+  return configureFuelGauge();
+}
+
+bool Battery::requiresConfiguration(bool enforceReload){
+  // If hardware / software power-on-reset (POR) event has occurred, reconfigure the battery gauge, otherwise, skip the configuration
+  return enforceReload || getBit(this->wire, FUEL_GAUGE_ADDRESS, STATUS_REG, POR_BIT) == 1;
+}
+
+bool Battery::configureFuelGauge(){
   uint16_t tempHibernateConfigRegister = readRegister16Bits(this->wire, FUEL_GAUGE_ADDRESS, HIB_CFG_REG);
   releaseFromHibernation();
   configureBatteryCharacteristics();
 
-  if(!refreshBatteryGaugeModel()){
+  bool modelLoaded = this->model != nullptr ? loadCustomModel() : refreshBatteryGaugeModel();
+  if(!modelLoaded){
     return false;
   }
   
@@ -52,7 +61,7 @@ bool Battery::awaitDataReady(uint16_t timeout){
       return false;
     }
 
-    delay(100); // Wait for the data to be ready. This takes 710ms from power-up
+    delay(DATA_READY_POLL_INTERVAL_MS); // Wait for the data to be ready
   } 
 }
 
@@ -76,9 +85,9 @@ void Battery::releaseFromHibernation(){
   writeRegister16Bits(this->wire, FUEL_GAUGE_ADDRESS, SOFT_WAKEUP_REG, 0x0);  // Soft wake-up must be manually cleared (0x0000) afterward to keep proper fuel gauge timing
 }
 
-bool Battery::refreshBatteryGaugeModel(){
-  uint16_t registerValue = 1 << MODEL_CFG_REFRESH_BIT;
-  
+uint16_t Battery::modelConfiguration(){
+  uint16_t registerValue = 0;
+
   // Set NTC resistor option for 100k resistor
   if (characteristics.ntcResistor == NTCResistor::Resistor100K) {
     registerValue |= 1 << R100_BIT;
@@ -90,6 +99,12 @@ bool Battery::refreshBatteryGaugeModel(){
     registerValue |= 1 << VCHG_BIT;
   }
 
+  return registerValue;
+}
+
+bool Battery::refreshBatteryGaugeModel(){
+  uint16_t registerValue = 1 << MODEL_CFG_REFRESH_BIT | modelConfiguration();
+
   writeRegister16Bits(this->wire, FUEL_GAUGE_ADDRESS, MODEL_CFG_REG, registerValue);
   unsigned long startTime = millis();
 
@@ -107,6 +122,64 @@ bool Battery::refreshBatteryGaugeModel(){
   }
 }
 
+void Battery::useModel(const BatteryModel &model){
+  this->model = &model;
+}
+
+bool Battery::loadCustomModel(){
+  // See section "Initialize Configuration" with a custom full INI in the MAX1726x software implementation guide
+  constexpr uint8_t attempts = 3;
+  uint16_t readBack[BATTERY_MODEL_TABLE_SIZE];
+  bool tableVerified = false;
+
+  for(uint8_t attempt = 0; attempt < attempts && !tableVerified; ++attempt){
+    writeRegister16Bits(this->wire, FUEL_GAUGE_ADDRESS, MODEL_ACCESS_1_REG, MODEL_UNLOCK_1);
+    writeRegister16Bits(this->wire, FUEL_GAUGE_ADDRESS, MODEL_ACCESS_2_REG, MODEL_UNLOCK_2);
+
+    writeRegisters16Bits(this->wire, FUEL_GAUGE_ADDRESS, MODEL_TABLE_START_REG, model->table, BATTERY_MODEL_TABLE_SIZE);
+    readRegisters16Bits(this->wire, FUEL_GAUGE_ADDRESS, MODEL_TABLE_START_REG, readBack, BATTERY_MODEL_TABLE_SIZE);
+    tableVerified = memcmp(readBack, model->table, sizeof(readBack)) == 0;
+
+    // Lock the model table again, it reads as zeros once it's locked
+    writeRegister16Bits(this->wire, FUEL_GAUGE_ADDRESS, MODEL_ACCESS_1_REG, 0);
+    writeRegister16Bits(this->wire, FUEL_GAUGE_ADDRESS, MODEL_ACCESS_2_REG, 0);
+    readRegisters16Bits(this->wire, FUEL_GAUGE_ADDRESS, MODEL_TABLE_START_REG, readBack, BATTERY_MODEL_TABLE_SIZE);
+    for(uint8_t index = 0; index < BATTERY_MODEL_TABLE_SIZE; ++index){
+      tableVerified &= readBack[index] == 0;
+    }
+  }
+
+  if(!tableVerified){
+    return false;
+  }
+
+  const uint8_t parameterRegisters[] = {R_COMP_0_REG, TEMP_CO_REG, QR_TABLE_00_REG, QR_TABLE_10_REG, QR_TABLE_20_REG, QR_TABLE_30_REG, FULL_SOC_THR_REG};
+  const uint16_t parameterValues[] = {model->rComp0, model->tempCo, model->qrTable[0], model->qrTable[1], model->qrTable[2], model->qrTable[3], model->fullSocThreshold};
+  for(uint8_t index = 0; index < sizeof(parameterRegisters); ++index){
+    writeRegister16Bits(this->wire, FUEL_GAUGE_ADDRESS, parameterRegisters[index], parameterValues[index]);
+    if(readRegister16Bits(this->wire, FUEL_GAUGE_ADDRESS, parameterRegisters[index]) != parameterValues[index]){
+      return false;
+    }
+  }
+
+  writeRegister16Bits(this->wire, FUEL_GAUGE_ADDRESS, MODEL_CFG_REG, modelConfiguration());
+  replaceRegisterBit(this->wire, FUEL_GAUGE_ADDRESS, CONFIG2_REG, LD_MDL_BIT, 1);
+  unsigned long startTime = millis();
+
+  while (true) {
+    // The fuel gauge clears the bit once the model is loaded
+    bool loadComplete = getBit(this->wire, FUEL_GAUGE_ADDRESS, CONFIG2_REG, LD_MDL_BIT) == 0;
+    if (loadComplete) {
+      return true;
+    }
+
+    if (millis() - startTime > 1000) {
+      return false;
+    }
+    delay(10);
+  }
+}
+
 bool Battery::isConnected(){
   uint16_t statusRegister = readRegister16Bits(this->wire, FUEL_GAUGE_ADDRESS, STATUS_REG);
   return bitRead(statusRegister, BATTERY_STATUS_BIT) == 0;
@@ -246,6 +319,14 @@ int16_t Battery::current(){
   return (int16_t)readRegister16Bits(this->wire, FUEL_GAUGE_ADDRESS, CURRENT_REG) * CURRENT_MULTIPLIER_MA;
 }
 
+float Battery::highResolutionCurrent(){
+  if(!isConnected()){
+    return -1;
+  }
+
+  return static_cast<int16_t>(readRegister16Bits(this->wire, FUEL_GAUGE_ADDRESS, CURRENT_REG)) * CURRENT_MULTIPLIER_MA;
+}
+
 int16_t Battery::averageCurrent(){
   if(!isConnected()){
     return -1;
@@ -364,3 +445,234 @@ int32_t Battery::timeToFull(){
 
   return readRegister16Bits(this->wire, FUEL_GAUGE_ADDRESS, TTF_REG) * TIME_MULTIPLIER_S;
 }
+
+uint16_t Battery::nominalFullCapacity(){
+  if(!isConnected()){
+    return -1;
+  }
+
+  return readRegister16Bits(this->wire, FUEL_GAUGE_ADDRESS, FULL_CAP_NOM_REG) * CAPACITY_MULTIPLIER_MAH;
+}
+
+float Battery::stateOfHealth(){
+  if(!isConnected()){
+    return -1;
+  }
+
+  // Both registers use the same resolution, so the raw values can be divided directly
+  uint16_t designCapacity = readRegister16Bits(this->wire, FUEL_GAUGE_ADDRESS, DESIGN_CAP_REG);
+  if(designCapacity == 0){
+    return -1;
+  }
+
+  uint16_t nominalCapacity = readRegister16Bits(this->wire, FUEL_GAUGE_ADDRESS, FULL_CAP_NOM_REG);
+  return nominalCapacity * 100.0f / designCapacity;
+}
+
+float Battery::age(){
+  if(!isConnected()){
+    return -1;
+  }
+
+  return readRegister16Bits(this->wire, FUEL_GAUGE_ADDRESS, AGE_REG) * PERCENTAGE_MULTIPLIER;
+}
+
+float Battery::cycles(){
+  if(!isConnected()){
+    return -1;
+  }
+
+  return readRegister16Bits(this->wire, FUEL_GAUGE_ADDRESS, CYCLES_REG) * CYCLES_MULTIPLIER;
+}
+
+CoulombCounterSnapshot Battery::coulombCounter(){
+  CoulombCounterSnapshot snapshot;
+  uint16_t timerHigh;
+  uint16_t timerLow;
+
+  // Read the upper timer word again to detect a roll-over of the lower word in between
+  do {
+    timerHigh = readRegister16Bits(this->wire, FUEL_GAUGE_ADDRESS, TIMER_H_REG);
+    timerLow = readRegister16Bits(this->wire, FUEL_GAUGE_ADDRESS, TIMER_REG);
+    snapshot.charge = readRegister16Bits(this->wire, FUEL_GAUGE_ADDRESS, QH_REG);
+  } while (timerHigh != readRegister16Bits(this->wire, FUEL_GAUGE_ADDRESS, TIMER_H_REG));
+
+  snapshot.timer = (static_cast<uint32_t>(timerHigh) << 16) | timerLow;
+  snapshot.averageVoltage = readRegister16Bits(this->wire, FUEL_GAUGE_ADDRESS, AVG_VCELL_REG);
+  return snapshot;
+}
+
+AtRatePrediction Battery::predictAtRate(uint16_t dischargeCurrent){
+  AtRatePrediction prediction;
+  predictAtRates(&dischargeCurrent, &prediction, 1);
+  return prediction;
+}
+
+bool Battery::predictAtRates(const uint16_t *dischargeCurrents, AtRatePrediction *predictions, uint8_t count){
+  if(count > MAX_AT_RATE_CURRENTS || !isConnected()){
+    return false;
+  }
+
+  // The outputs are updated on the next task period, which can end up to one period after the write
+  uint32_t updateDelay = 2 * taskPeriod();
+
+  for(uint8_t index = 0; index < count; ++index){
+    writeAtRate(dischargeCurrents[index]);
+    delay(updateDelay);
+    predictions[index] = readAtRatePrediction();
+  }
+
+  // AtRate 0 tells the fuel gauge to stop the what-if calculation
+  writeRegister16Bits(this->wire, FUEL_GAUGE_ADDRESS, AT_RATE_REG, 0);
+  atRatePending = false;
+  return true;
+}
+
+bool Battery::startAtRatePrediction(uint16_t dischargeCurrent){
+  if(!isConnected()){
+    return false;
+  }
+
+  writeAtRate(dischargeCurrent);
+  atRateStart = millis();
+  atRateDelay = 2 * taskPeriod();
+  atRatePending = true;
+  return true;
+}
+
+bool Battery::pollAtRatePrediction(AtRatePrediction &prediction){
+  if(!atRatePending || millis() - atRateStart < atRateDelay){
+    return false;
+  }
+
+  prediction = readAtRatePrediction();
+  writeRegister16Bits(this->wire, FUEL_GAUGE_ADDRESS, AT_RATE_REG, 0);
+  atRatePending = false;
+  return true;
+}
+
+void Battery::writeAtRate(uint16_t dischargeCurrent){
+  // AtRate is in two's complement with the same resolution as Current, discharge currents are negative
+  float rawCurrent = min(dischargeCurrent / CURRENT_MULTIPLIER_MA, 32768.0);
+  int16_t atRate = -static_cast<int32_t>(rawCurrent);
+  writeRegister16Bits(this->wire, FUEL_GAUGE_ADDRESS, AT_RATE_REG, static_cast<uint16_t>(atRate));
+}
+
+AtRatePrediction Battery::readAtRatePrediction(){
+  AtRatePrediction prediction;
+  prediction.timeToEmpty = readRegister16Bits(this->wire, FUEL_GAUGE_ADDRESS, AT_TTE_REG) * TIME_MULTIPLIER_S;
+  prediction.percentage = readRegister16Bits(this->wire, FUEL_GAUGE_ADDRESS, AT_AV_SOC_REG) * PERCENTAGE_MULTIPLIER;
+  prediction.capacity = readRegister16Bits(this->wire, FUEL_GAUGE_ADDRESS, AT_AV_CAP_REG) * CAPACITY_MULTIPLIER_MAH;
+  prediction.residualCapacity = readRegister16Bits(this->wire, FUEL_GAUGE_ADDRESS, AT_QRESIDUAL_REG) * CAPACITY_MULTIPLIER_MAH;
+  prediction.valid = true;
+  return prediction;
+}
+
+bool Battery::setHibernateConfiguration(const HibernateConfiguration &configuration){
+  if(configuration.threshold > 15 || configuration.enterTime > 7 || configuration.exitTime > 3 || configuration.scalar > 7){
+    return false;
+  }
+
+  if(!isConnected()){
+    return false;
+  }
+
+  // Keep the reserved bits as they are
+  uint16_t registerValue = readRegister16Bits(this->wire, FUEL_GAUGE_ADDRESS, HIB_CFG_REG);
+  registerValue &= ~((1 << EN_HIBERNATION_BIT) | (0x7 << HIB_ENTER_TIME_START_BIT) | (0xF << HIB_THRESHOLD_START_BIT) | (0x3 << HIB_EXIT_TIME_START_BIT) | (0x7 << HIB_SCALAR_START_BIT));
+  registerValue |= configuration.enabled << EN_HIBERNATION_BIT;
+  registerValue |= configuration.enterTime << HIB_ENTER_TIME_START_BIT;
+  registerValue |= configuration.threshold << HIB_THRESHOLD_START_BIT;
+  registerValue |= configuration.exitTime << HIB_EXIT_TIME_START_BIT;
+  registerValue |= configuration.scalar << HIB_SCALAR_START_BIT;
+  writeRegister16Bits(this->wire, FUEL_GAUGE_ADDRESS, HIB_CFG_REG, registerValue);
+
+  return readRegister16Bits(this->wire, FUEL_GAUGE_ADDRESS, HIB_CFG_REG) == registerValue;
+}
+
+HibernateConfiguration Battery::hibernateConfiguration(){
+  HibernateConfiguration configuration;
+  uint16_t registerValue = readRegister16Bits(this->wire, FUEL_GAUGE_ADDRESS, HIB_CFG_REG);
+
+  configuration.enabled = bitRead(registerValue, EN_HIBERNATION_BIT) == 1;
+  configuration.enterTime = extractBits(registerValue, HIB_ENTER_TIME_START_BIT, HIB_ENTER_TIME_END_BIT);
+  configuration.threshold = extractBits(registerValue, HIB_THRESHOLD_START_BIT, HIB_THRESHOLD_END_BIT);
+  configuration.exitTime = extractBits(registerValue, HIB_EXIT_TIME_START_BIT, HIB_EXIT_TIME_END_BIT);
+  configuration.scalar = extractBits(registerValue, HIB_SCALAR_START_BIT, HIB_SCALAR_END_BIT);
+  return configuration;
+}
+
+bool Battery::isHibernating(){
+  return getBit(this->wire, FUEL_GAUGE_ADDRESS, STATUS2_REG, HIB_BIT) == 1;
+}
+
+uint32_t Battery::taskPeriod(){
+  if(!isHibernating()){
+    return ceil(ACTIVE_TASK_PERIOD_MS);
+  }
+
+  uint16_t hibernateConfig = readRegister16Bits(this->wire, FUEL_GAUGE_ADDRESS, HIB_CFG_REG);
+  uint8_t hibernateScalar = extractBits(hibernateConfig, HIB_SCALAR_START_BIT, HIB_SCALAR_END_BIT);
+  return ceil(HIBERNATE_TASK_PERIOD_BASE_MS * (1 << hibernateScalar));
+}
+
+bool Battery::setFilterConfiguration(const FilterConfiguration &configuration){
+  if(configuration.current > 15 || configuration.voltage > 7 || configuration.mixing > 15 || configuration.temperature > 7){
+    return false;
+  }
+
+  if(!isConnected()){
+    return false;
+  }
+
+  // Keep the reserved bits as they are
+  uint16_t registerValue = readRegister16Bits(this->wire, FUEL_GAUGE_ADDRESS, FILTER_CFG_REG);
+  registerValue &= ~((0xF << FILTER_CURR_START_BIT) | (0x7 << FILTER_VOLT_START_BIT) | (0xF << FILTER_MIX_START_BIT) | (0x7 << FILTER_TEMP_START_BIT));
+  registerValue |= configuration.current << FILTER_CURR_START_BIT;
+  registerValue |= configuration.voltage << FILTER_VOLT_START_BIT;
+  registerValue |= configuration.mixing << FILTER_MIX_START_BIT;
+  registerValue |= configuration.temperature << FILTER_TEMP_START_BIT;
+  writeRegister16Bits(this->wire, FUEL_GAUGE_ADDRESS, FILTER_CFG_REG, registerValue);
+
+  return readRegister16Bits(this->wire, FUEL_GAUGE_ADDRESS, FILTER_CFG_REG) == registerValue;
+}
+
+FilterConfiguration Battery::filterConfiguration(){
+  FilterConfiguration configuration;
+  uint16_t registerValue = readRegister16Bits(this->wire, FUEL_GAUGE_ADDRESS, FILTER_CFG_REG);
+
+  configuration.current = extractBits(registerValue, FILTER_CURR_START_BIT, FILTER_CURR_END_BIT);
+  configuration.voltage = extractBits(registerValue, FILTER_VOLT_START_BIT, FILTER_VOLT_END_BIT);
+  configuration.mixing = extractBits(registerValue, FILTER_MIX_START_BIT, FILTER_MIX_END_BIT);
+  configuration.temperature = extractBits(registerValue, FILTER_TEMP_START_BIT, FILTER_TEMP_END_BIT);
+  return configuration;
+}
+
+bool Battery::setRelaxConfiguration(const RelaxConfiguration &configuration){
+  uint16_t load = configuration.loadCurrent / RELAX_LOAD_MULTIPLIER_MA;
+  uint16_t voltageChange = round(configuration.voltageChange / RELAX_VOLTAGE_MULTIPLIER_MV);
+  if(load > 0x7F || voltageChange > 0xF || configuration.period > 0xF){
+    return false;
+  }
+
+  if(!isConnected()){
+    return false;
+  }
+
+  uint16_t registerValue = load << RELAX_LOAD_START_BIT | voltageChange << RELAX_DV_START_BIT | configuration.period << RELAX_DT_START_BIT;
+  // Bit 8 is reserved, keep it as it is
+  registerValue |= readRegister16Bits(this->wire, FUEL_GAUGE_ADDRESS, RELAX_CFG_REG) & (1 << (RELAX_LOAD_START_BIT - 1));
+  writeRegister16Bits(this->wire, FUEL_GAUGE_ADDRESS, RELAX_CFG_REG, registerValue);
+
+  return readRegister16Bits(this->wire, FUEL_GAUGE_ADDRESS, RELAX_CFG_REG) == registerValue;
+}
+
+RelaxConfiguration Battery::relaxConfiguration(){
+  RelaxConfiguration configuration;
+  uint16_t registerValue = readRegister16Bits(this->wire, FUEL_GAUGE_ADDRESS, RELAX_CFG_REG);
+
+  configuration.loadCurrent = extractBits(registerValue, RELAX_LOAD_START_BIT, RELAX_LOAD_END_BIT) * RELAX_LOAD_MULTIPLIER_MA;
+  configuration.voltageChange = extractBits(registerValue, RELAX_DV_START_BIT, RELAX_DV_END_BIT) * RELAX_VOLTAGE_MULTIPLIER_MV;
+  configuration.period = extractBits(registerValue, RELAX_DT_START_BIT, RELAX_DT_END_BIT);
+  return configuration;
+}
@@ -3,6 +3,7 @@
 
 #include "Arduino.h"
 #include "Wire.h"
+#include "BoardTraits.h"
 
 constexpr int FUEL_GAUGE_ADDRESS = 0x36; // I2C address of the fuel gauge
 constexpr float DEFAULT_BATTERY_EMPTY_VOLTAGE = 3.3f; // V
@@ -40,6 +41,213 @@ struct BatteryCharacteristics {
     float recoveryVoltage = DEFAULT_RECOVERY_VOLTAGE;
 };
 
+constexpr uint8_t BATTERY_MODEL_TABLE_SIZE = 48; // Number of words in the model table (registers 0x80 to 0xAF)
+
+/**
+ * @brief A fully characterised ModelGauge m5 cell model.
+ * With a model that was characterised for your cell the state of charge is accurate from the first cycle on,
+ * while the default EZ model needs a few cycles to learn the cell. Cell characterisation is offered by Analog Devices,
+ * the resulting INI file can be converted into this struct with extras/tools/ini_to_model.py.
+ * All values are the raw register values from the INI file.
+*/
+struct BatteryModel {
+    /// @brief The model table including the OCV table, written to the registers 0x80 to 0xAF.
+    uint16_t table[BATTERY_MODEL_TABLE_SIZE] = {};
+
+    /// @brief The RComp0 register value.
+    uint16_t rComp0 = 0;
+
+    /// @brief The TempCo register value.
+    uint16_t tempCo = 0;
+
+    /// @brief The QRTable00, QRTable10, QRTable20 and QRTable30 register values.
+    uint16_t qrTable[4] = {};
+
+    /// @brief The FullSOCThr register value.
+    uint16_t fullSocThreshold = 0;
+};
+
+/**
+ * @brief A raw reading of the fuel gauge's coulomb counter and timer.
+ * Two snapshots taken at different times describe the charge that flowed in between,
+ * see EnergyProbe for a convenient way to use them.
+*/
+struct CoulombCounterSnapshot {
+    /// @brief The raw coulomb count (QH register). It decreases while discharging and wraps around.
+    uint16_t charge = 0;
+
+    /// @brief The time since the fuel gauge was reset (TimerH:Timer registers) in units of 175.8ms.
+    uint32_t timer = 0;
+
+    /// @brief The raw average cell voltage (AvgVCell register).
+    uint16_t averageVoltage = 0;
+};
+
+/**
+ * @brief When the fuel gauge enters and leaves its hibernate mode and how often it measures while hibernating.
+ * In hibernate mode the fuel gauge draws less current but updates its outputs less often.
+ * It enters hibernate mode when the current stays below a threshold and wakes up when it stays above it.
+ * The fields hold the raw values of the HibCfg register, see the presets for typical combinations.
+*/
+struct HibernateConfiguration {
+    /// @brief Whether the fuel gauge may enter hibernate mode at all.
+    bool enabled = true;
+
+    /// @brief The current threshold is FullCap / 0.8h / 2^threshold, e.g. 7 is about C/100 (Range: 0 - 15).
+    uint8_t threshold = 7;
+
+    /// @brief The current must stay below the threshold for 2.8s x 2^enterTime before hibernating (Range: 0 - 7).
+    uint8_t enterTime = 0;
+
+    /// @brief The current must stay above the threshold for (exitTime + 1) x 702ms x 2^scalar before waking up (Range: 0 - 3).
+    uint8_t exitTime = 1;
+
+    /// @brief The task period in hibernate mode is 351ms x 2^scalar, e.g. 4 is 5.6s (Range: 0 - 7).
+    uint8_t scalar = 4;
+
+    /**
+     * @brief Keeps the fuel gauge active all the time. All readings are at most 175ms old, at the cost of the highest quiescent current.
+     */
+    static constexpr HibernateConfiguration alwaysActive() {
+        HibernateConfiguration configuration;
+        configuration.enabled = false;
+        return configuration;
+    }
+
+    /**
+     * @brief The factory default: hibernates below about C/100 and updates every 5.6 seconds while hibernating.
+     */
+    static constexpr HibernateConfiguration balanced() {
+        return HibernateConfiguration();
+    }
+
+    /**
+     * @brief Hibernates quickly and updates every 22.5 seconds while hibernating. For boards that spend most of their time in standby.
+     */
+    static constexpr HibernateConfiguration lowPower() {
+        HibernateConfiguration configuration;
+        configuration.threshold = 6;
+        configuration.exitTime = 0;
+        configuration.scalar = 6;
+        return configuration;
+    }
+
+    /**
+     * @brief The task period while hibernating.
+     * @return The task period in milliseconds (ms).
+     */
+    constexpr uint32_t hibernateTaskPeriod() const {
+        return static_cast<uint32_t>(351.6f * (1 << scalar) + 0.5f);
+    }
+};
+
+/**
+ * @brief The averaging time constants of the fuel gauge (FilterCfg register).
+ * The averaged readings follow a load change like an exponential average: after one time constant
+ * they have covered 63% of the change, after three time constants 95%.
+ * Short time constants make averageCurrent() and averageVoltage() settle quickly, long ones reduce their noise.
+ * The fields hold the raw register values, see the presets for typical combinations.
+*/
+struct FilterConfiguration {
+    /// @brief The time constant of averageCurrent() and averagePower() is 45s x 2^(current - 7), e.g. 4 is 5.6s (Range: 0 - 15).
+    uint8_t current = 4;
+
+    /// @brief The time constant of averageVoltage() is 45s x 2^(voltage - 2), e.g. 2 is 45s (Range: 0 - 7).
+    uint8_t voltage = 2;
+
+    /// @brief The time constant of the mixing algorithm is 45s x 2^(mixing - 3), e.g. 13 is 12.8h (Range: 0 - 15).
+    /// Only change this if recommended for your battery model.
+    uint8_t mixing = 13;
+
+    /// @brief The time constant of the average temperatures is 45s x 2^temperature, e.g. 1 is 1.5min (Range: 0 - 7).
+    uint8_t temperature = 1;
+
+    /**
+     * @brief Short time constants (0.35s for the current, 11s for the voltage) for load switching tests.
+     */
+    static constexpr FilterConfiguration responsive() {
+        FilterConfiguration configuration;
+        configuration.current = 0;
+        configuration.voltage = 0;
+        return configuration;
+    }
+
+    /**
+     * @brief The factory default (5.6s for the current, 45s for the voltage).
+     */
+    static constexpr FilterConfiguration balanced() {
+        return FilterConfiguration();
+    }
+
+    /**
+     * @brief Long time constants (45s for the current, 3min for the voltage, 6min for the temperature) for long-term logging.
+     */
+    static constexpr FilterConfiguration lowNoise() {
+        FilterConfiguration configuration;
+        configuration.current = 7;
+        configuration.voltage = 4;
+        configuration.temperature = 3;
+        return configuration;
+    }
+
+    /**
+     * @brief The time constant of averageCurrent().
+     * @return The time constant in seconds (s).
+     */
+    constexpr float currentTimeConstant() const {
+        return 45.0f * (1 << current) / (1 << 7);
+    }
+
+    /**
+     * @brief The time constant of averageVoltage().
+     * @return The time constant in seconds (s).
+     */
+    constexpr float voltageTimeConstant() const {
+        return 45.0f * (1 << voltage) / (1 << 2);
+    }
+};
+
+/**
+ * @brief When the fuel gauge considers the battery relaxed (RelaxCfg register).
+ * The fuel gauge corrects its state of charge from the open circuit voltage when the battery is relaxed,
+ * i.e. the average current is below the load threshold and the voltage changes by less than
+ * the voltage threshold over two consecutive periods.
+*/
+struct RelaxConfiguration {
+    /// @brief averageCurrent() must stay below this value in milli amperes (mA) (Range: 0 - 635mA in steps of 5mA).
+    uint16_t loadCurrent = 80;
+
+    /// @brief The voltage must change by less than this value in millivolts (mV) (Range: 0 - 18.75mV in steps of 1.25mV).
+    float voltageChange = 3.75f;
+
+    /// @brief The raw dt value that sets the period over which the voltage change is compared (Range: 0 - 15).
+    uint8_t period = 9;
+};
+
+/**
+ * @brief The fuel gauge's prediction for a hypothetical discharge current, see Battery::predictAtRate().
+ * The prediction is compensated for the temperature and age of the battery, like the regular outputs.
+*/
+struct AtRatePrediction {
+    /// @brief False if the fuel gauge couldn't be read, the other values are invalid in that case.
+    bool valid = false;
+
+    /// @brief The estimated time until the battery is empty at the given current in seconds (AtTTE register).
+    int32_t timeToEmpty = -1;
+
+    /// @brief The available state of charge at the given current in percent (AtAvSOC register).
+    uint8_t percentage = 0;
+
+    /// @brief The available remaining capacity at the given current in milliampere-hours (AtAvCap register).
+    uint16_t capacity = 0;
+
+    /// @brief The capacity that can't be drawn at the given current before the battery is considered empty
+    /// in milliampere-hours (AtQResidual register).
+    uint16_t residualCapacity = 0;
+};
+
+constexpr uint8_t MAX_AT_RATE_CURRENTS = 8; // Maximum number of currents Battery::predictAtRates() evaluates in one call
+
 /**
  * @brief This class provides a detailed insight into the battery's health and usage.
 */
@@ -63,6 +271,14 @@ class Battery {
         */
         bool begin(bool enforceReload = false);
 
+        /**
+         * @brief Uses a characterised cell model instead of the EZ model.
+         * Call this before begin(). The model is loaded whenever the fuel gauge needs to be configured,
+         * which is after a power-on reset of the fuel gauge or when begin() is called with enforceReload set to true.
+         * @param model The cell model. It's not copied, so it must outlive the battery object, e.g. a constexpr global.
+        */
+        void useModel(const BatteryModel &model);
+
         /**
          * @brief Checks if a battery is connected to the system. 
          * @return True if a battery is connected, false otherwise
@@ -104,13 +320,21 @@ class Battery {
 
         /**
          * @brief Reads the current flowing from the battery at the moment.
-         * Negative values indicate that the battery is charging, 
-         * positive values indicate that the battery is discharging.
+         * Negative values indicate that the battery is discharging,
+         * positive values indicate that the battery is charging.
          * When no battery is connected, the value is -1.
          * @return The current flowing from the battery in milli amperes (mA).
         */
         int16_t current();
 
+        /**
+         * @brief Reads the current like current(), but keeps the full resolution of the fuel gauge of 0.156mA.
+         * Use this for devices that draw only a few milli amperes.
+         * The value is negative while the battery discharges and positive while it charges.
+         * @return The current flowing from the battery in milli amperes (mA).
+        */
+        float highResolutionCurrent();
+
         /**
          * @brief Reads an average of current readings of the battery.
          * @return The average current in milli amperes (mA).
@@ -215,7 +439,156 @@ class Battery {
          */
         int32_t timeToFull();
 
+        /**
+         * @brief Reads the full capacity of the battery at nominal temperature and load, as learned by the fuel gauge (FullCapNom register).
+         * Unlike fullCapacity() this value doesn't depend on the present temperature and discharge rate, so it follows the aging of the battery.
+         * @return The nominal full capacity in milliampere-hours (mAh).
+         */
+        uint16_t nominalFullCapacity();
+
+        /**
+         * @brief Reads the battery's state of health, the nominal full capacity relative to the design capacity.
+         * The fuel gauge learns the full capacity over complete charge cycles, so the value becomes meaningful after a few cycles.
+         * @return The state of health as a percentage, -1 if the battery isn't connected or no design capacity was configured.
+         */
+        float stateOfHealth();
+
+        /**
+         * @brief Reads the reported full capacity relative to the design capacity (Age register).
+         * It includes the effect of the present temperature and discharge rate, see stateOfHealth() for a steadier value.
+         * @return The age as a percentage.
+         */
+        float age();
+
+        /**
+         * @brief Reads the number of charge cycles the battery went through (Cycles register).
+         * Every 100% of charge and discharge, e.g. from 100% to 50% and back, count as one cycle.
+         * The register has a resolution of 1% of a cycle and rolls over after 655.35 cycles.
+         * @return The number of cycles, -1 if the battery isn't connected.
+         */
+        float cycles();
+
+        /**
+         * @brief Reads the coulomb counter (QH), the timer (TimerH:Timer) and the average voltage of the fuel gauge.
+         * The coulomb counter has a resolution of 0.5mAh.
+         * @return A snapshot of the raw register values.
+         */
+        CoulombCounterSnapshot coulombCounter();
+
+        /**
+         * @brief Asks the fuel gauge how long the battery would last at a hypothetical discharge current.
+         * The current is written to the AtRate register and the predictions are read after the fuel gauge
+         * has updated them. This blocks for two task periods, about 350ms in active mode.
+         * While the fuel gauge hibernates it's two hibernate task periods, up to 90 seconds with the
+         * largest HibernateConfiguration::scalar of 7, so call it while the board is active or check taskPeriod() first.
+         * AtRate is set back to 0 afterwards.
+         * @param dischargeCurrent The hypothetical discharge current in milli amperes (mA), up to 5120mA.
+         * @return The prediction for the given current.
+        */
+        AtRatePrediction predictAtRate(uint16_t dischargeCurrent);
+
+        /**
+         * @brief Evaluates several hypothetical discharge currents one after the other, see predictAtRate().
+         * This blocks for two task periods per current: about 2.8 seconds for MAX_AT_RATE_CURRENTS currents in active mode,
+         * but up to 12 minutes while the fuel gauge hibernates with the largest HibernateConfiguration::scalar.
+         * Use startAtRatePrediction() and pollAtRatePrediction() to keep the loop running in the meantime.
+         * @param dischargeCurrents The hypothetical discharge currents in milli amperes (mA).
+         * @param predictions Array of at least count elements that receives the predictions.
+         * @param count The number of currents to evaluate, at most MAX_AT_RATE_CURRENTS.
+         * @return True if all predictions are valid, false if count is too large or the battery isn't connected.
+        */
+        bool predictAtRates(const uint16_t *dischargeCurrents, AtRatePrediction *predictions, uint8_t count);
+
+        /**
+         * @brief Starts a prediction at a hypothetical discharge current without waiting for it, see predictAtRate().
+         * Call pollAtRatePrediction() until it returns true, which takes two task periods:
+         * about 350ms in active mode and up to 90 seconds while the fuel gauge hibernates.
+         * Starting another prediction discards the one that is running.
+         * @param dischargeCurrent The hypothetical discharge current in milli amperes (mA), up to 5120mA.
+         * @return True if the prediction was started, false if the battery isn't connected.
+        */
+        bool startAtRatePrediction(uint16_t dischargeCurrent);
+
+        /**
+         * @brief Reads the prediction started with startAtRatePrediction() once the fuel gauge has updated it.
+         * AtRate is set back to 0 when the prediction is read.
+         * @param prediction Receives the prediction, left unchanged while it isn't ready.
+         * @return True if the prediction was read, false if it isn't ready yet or none was started.
+        */
+        bool pollAtRatePrediction(AtRatePrediction &prediction);
+
+        /**
+         * @brief Configures when the fuel gauge hibernates, see HibernateConfiguration.
+         * Call this after begin(), as the configuration of the fuel gauge restores the previous settings.
+         * @param configuration The hibernate configuration, e.g. HibernateConfiguration::lowPower().
+         * @return True if the configuration was written, false if a value is out of range or the battery isn't connected.
+        */
+        bool setHibernateConfiguration(const HibernateConfiguration &configuration);
+
+        /**
+         * @brief Reads the current hibernate configuration of the fuel gauge.
+         * @return The hibernate configuration.
+        */
+        HibernateConfiguration hibernateConfiguration();
+
+        /**
+         * @brief Checks whether the fuel gauge is currently in hibernate mode.
+         * @return True if the fuel gauge is hibernating, false if it's active.
+        */
+        bool isHibernating();
+
+        /**
+         * @brief Returns how often the fuel gauge currently updates its readings.
+         * This is 175ms in active mode and depends on the hibernate configuration while hibernating.
+         * The readings can be up to one task period old.
+         * @return The task period in milliseconds (ms).
+        */
+        uint32_t taskPeriod();
+
+        /**
+         * @brief Configures the averaging time constants of the fuel gauge, see FilterConfiguration.
+         * @param configuration The filter configuration, e.g. FilterConfiguration::responsive().
+         * @return True if the configuration was written, false if a value is out of range or the battery isn't connected.
+        */
+        bool setFilterConfiguration(const FilterConfiguration &configuration);
+
+        /**
+         * @brief Reads the current averaging time constants of the fuel gauge.
+         * @return The filter configuration.
+        */
+        FilterConfiguration filterConfiguration();
+
+        /**
+         * @brief Configures when the fuel gauge considers the battery relaxed, see RelaxConfiguration.
+         * @param configuration The relax configuration.
+         * @return True if the configuration was written, false if a value is out of range or the battery isn't connected.
+        */
+        bool setRelaxConfiguration(const RelaxConfiguration &configuration);
+
+        /**
+         * @brief Reads the current relaxation settings of the fuel gauge.
+         * @return The relax configuration.
+        */
+        RelaxConfiguration relaxConfiguration();
+
     private:
+        friend class PowerManagement;
+        friend class GaugePoller;
+
+        /**
+         * Checks if the fuel gauge needs to be configured, which is the case after a power-on reset.
+         * @param enforceReload If set to true, the configuration is always required.
+         * @return True if configureFuelGauge() needs to be called, false otherwise.
+         */
+        bool requiresConfiguration(bool enforceReload);
+
+        /**
+         * Configures the fuel gauge with the battery characteristics and refreshes the model.
+         * The output registers must be ready (see awaitDataReady()) before calling this.
+         * @return True if the configuration was successful, false otherwise.
+         */
+        bool configureFuelGauge();
+
         /** 
          * @brief Refreshes the battery gauge model. This is required when
          * changing the battery's characteristics and is used by the EZ algorithm (battery characterization).
@@ -226,6 +599,17 @@ class Battery {
          */
         bool refreshBatteryGaugeModel();
 
+        /**
+         * Writes and verifies the custom model table and parameters and makes the fuel gauge load them.
+         * @return True if the model was loaded, false if a verification failed or loading timed out.
+         */
+        bool loadCustomModel();
+
+        /**
+         * Returns the ModelCfg register bits that depend on the battery characteristics (R100 and VChg).
+         */
+        uint16_t modelConfiguration();
+
         /**
          * @brief Reads the battery's temperature.
          * Note: This only works if the battery is equipped with a thermistor.
@@ -254,6 +638,16 @@ class Battery {
          */
         bool awaitDataReady(uint16_t timeout = 1000);
 
+        /**
+         * Writes a hypothetical discharge current to the AtRate register.
+         */
+        void writeAtRate(uint16_t dischargeCurrent);
+
+        /**
+         * Reads the outputs of the AtRate calculation.
+         */
+        AtRatePrediction readAtRatePrediction();
+
         /**
          * Configures the characteristics of the battery as part of the initialization process.
          */
@@ -267,16 +661,14 @@ class Battery {
         void setTemperatureMeasurementMode(bool externalTemperature);
 
         BatteryCharacteristics characteristics;
+        const BatteryModel *model = nullptr;
+
+        // The prediction started with startAtRatePrediction()
+        bool atRatePending = false;
+        uint32_t atRateStart = 0;
+        uint32_t atRateDelay = 0;
 
-        #if defined(ARDUINO_PORTENTA_C33)
-            TwoWire *wire = &Wire3;
-        #elif defined(ARDUINO_PORTENTA_H7_M7) || defined(ARDUINO_GENERIC_STM32H747_M4)
-            TwoWire *wire = &Wire1;
-        #elif defined(ARDUINO_NICLA_VISION)
-            TwoWire *wire = &Wire1;
-        #else
-            #error "The selected board is not supported by the Battery class."
-        #endif
+        TwoWire *wire = CurrentBoardTraits::fuelGaugeWire();
 };
 
 #endif
\ No newline at end of file
@@ -1,4 +1,5 @@
 #ifndef BATTERY_CONSTANTS_H
+#define BATTERY_CONSTANTS_H
 
 // SEE: https://www.analog.com/media/en/technical-documentation/data-sheets/MAX17262.pdf
 
@@ -18,6 +19,24 @@
 #define RECOVERY_VOLTAGE_MULTIPLIER_MV 40 // Resolution: 40mV per LSB
 #define MAXMIN_VOLT_MULTIPLIER_MV 20 // Resolution: 20mV per LSB
 #define POWER_MULTIPLIER_MW 1.6 // Resolution: 1.6mW per LSB
+#define TIMER_MULTIPLIER_S 0.1758 // Resolution: 175.8ms per LSB of the combined TimerH:Timer value
+#define CYCLES_MULTIPLIER 0.01 // Resolution: 1% of a full cycle per LSB
+
+// Task periods (See section "Hibernate Mode" in the datasheet)
+#define ACTIVE_TASK_PERIOD_MS 175.8 // The fuel gauge updates its outputs once per task period
+#define HIBERNATE_TASK_PERIOD_BASE_MS 351.6 // In hibernate mode the task period is this value multiplied by 2^HibScalar
+#define HIBERNATE_ENTER_TIME_BASE_S 2.812 // Minimum time below the threshold before hibernating, multiplied by 2^HibEnterTime
+#define HIBERNATE_EXIT_TIME_BASE_MS 702.0 // Time above the threshold before waking up, multiplied by (HibExitTime + 1) x 2^HibScalar
+#define HIBERNATE_THRESHOLD_HOURS 0.8 // The hibernate threshold current is FullCap divided by this value and by 2^HibThreshold
+
+// The outputs become ready 710ms after power-up. Polling FStat.DNR every 10ms instead of every 100ms ends the wait
+// at most 10ms after that, at the cost of about 60 more two-byte I2C reads (roughly 0.3ms each at 100kHz) during the wait
+#define DATA_READY_POLL_INTERVAL_MS 10
+
+// Filter and relaxation configuration (See sections "FilterCfg Register" and "RelaxCfg Register" in the datasheet)
+#define FILTER_TIME_CONSTANT_BASE_S 45.0 // The averaging time constants are this value multiplied by a power of two
+#define RELAX_LOAD_MULTIPLIER_MA 5 // Resolution: 50μV per LSB, 5mA with the 10mΩ internal sense resistor
+#define RELAX_VOLTAGE_MULTIPLIER_MV 1.25 // Resolution: 1.25mV per LSB
 
 // Voltage Registers
 #define VCELL_REG 0x09 // VCell reports the voltage measured between BATT and GND.
@@ -40,7 +59,7 @@
 #define FULL_CAP_REP_REG 0x10 // This register reports the full capacity that goes with RepCap, generally used for reporting to the GUI.
 #define DESIGN_CAP_REG 0x18 // The DesignCap register holds the expected capacity of the cell.
 #define AV_CAP_REG 0x1F
-#define FULL_CAP_NOM_REG 0x23
+#define FULL_CAP_NOM_REG 0x23 // The FullCapNom register holds the full capacity of the cell at nominal temperature and load, as learned by the fuel gauge.
 #define DQ_ACC_REG 0x45
 #define VFR_REM_CAP_REG 0x4A
 #define QH_REG 0x4D // The QH register displays the raw coulomb count generated by the device. This register is used internally as an input to the mixing algorithm
@@ -60,7 +79,7 @@
 
 // percentages
 #define REP_SOC_REG 0x06 // the reported state-of-charge percentage output for use by the application GUI.
-#define AGE_REG 0x07
+#define AGE_REG 0x07 // The Age register reports FullCapRep divided by DesignCap as a percentage.
 #define MIX_SOC_REG 0x0D
 #define AV_SOC_REG 0x0E
 #define DP_ACC_REG 0x46
@@ -82,6 +101,12 @@
 #define TEMP_CO_REG 0x39
 #define V_EMPTY_REG 0x3A
 #define QR_TABLE_30_REG 0x42
+#define CONFIG2_REG 0xBB // The Config2 register holds additional configuration and the bit that loads a custom model.
+#define MODEL_ACCESS_1_REG 0x62 // Writing MODEL_UNLOCK_1 and MODEL_UNLOCK_2 to these registers unlocks the model table, writing 0 locks it again.
+#define MODEL_ACCESS_2_REG 0x63
+#define MODEL_TABLE_START_REG 0x80 // The custom model table occupies the registers 0x80 to 0xAF while unlocked.
+#define MODEL_UNLOCK_1 0x0059
+#define MODEL_UNLOCK_2 0x00C4
 
 // Status Registers
 #define STATUS_REG 0x00
@@ -91,7 +116,7 @@
 #define SHDN_TIMER 0x3F
 #define SOFT_WAKEUP_REG 0x60 // The Command register accepts commands to perform functions to wake up the IC for configuration changes.
 #define MODEL_CFG_REG 0xDB
-#define CYCLES_REG 0x17
+#define CYCLES_REG 0x17 // The Cycles register counts the total charge and discharge as a number of full cycles.
 #define DEV_NAME_REG 0x21
 #define POWER_REG 0xB1 // Instant power calculation from immediate current and voltage
 #define AVG_POWER_REG 0xB3
@@ -106,6 +131,29 @@
 #define FQ_BIT 7 // FStat Register: Full Qualified. This bit is set when all charge termination conditions have been met. See the End-of-Charge Detection section for details.
 #define EN_HIBERNATION_BIT 15 // HibCfg Register: Enable Hibernate Mode. When set to 1, the IC will enter hibernate mode if conditions are met. When set to 0, the IC always remains in the active mode of operation.
 #define SHDN_BIT 7 // Config Register: Write this bit to logic 1 to force a shutdown of the device after timeout of the ShdnTimer register
+#define HIB_ENTER_TIME_START_BIT 12 // HibCfg Register: Time the current must stay below the threshold before entering hibernate mode, 2.812s x 2^HibEnterTime to 2.812s x 2^(HibEnterTime+1).
+#define HIB_ENTER_TIME_END_BIT 14
+#define HIB_THRESHOLD_START_BIT 8 // HibCfg Register: Current threshold for entering and exiting hibernate mode, FullCap / 0.8h / 2^HibThreshold.
+#define HIB_THRESHOLD_END_BIT 11
+#define HIB_EXIT_TIME_START_BIT 3 // HibCfg Register: Time the current must stay above the threshold before exiting hibernate mode, (HibExitTime + 1) x 702ms x 2^HibScalar.
+#define HIB_EXIT_TIME_END_BIT 4
+#define HIB_SCALAR_START_BIT 0 // HibCfg Register: Sets the task period while in hibernate mode to 351ms x 2^HibScalar.
+#define HIB_SCALAR_END_BIT 2
+#define FILTER_CURR_START_BIT 0 // FilterCfg Register: AvgCurrent time constant, 45s x 2^(CURR-7).
+#define FILTER_CURR_END_BIT 3
+#define FILTER_VOLT_START_BIT 4 // FilterCfg Register: AvgVCell time constant, 45s x 2^(VOLT-2).
+#define FILTER_VOLT_END_BIT 6
+#define FILTER_MIX_START_BIT 7 // FilterCfg Register: Mixing time constant, 45s x 2^(MIX-3).
+#define FILTER_MIX_END_BIT 10
+#define FILTER_TEMP_START_BIT 11 // FilterCfg Register: AvgTA time constant, 45s x 2^TEMP.
+#define FILTER_TEMP_END_BIT 13
+#define RELAX_LOAD_START_BIT 9 // RelaxCfg Register: AvgCurrent must stay below this threshold for the cell to be considered unloaded.
+#define RELAX_LOAD_END_BIT 15
+#define RELAX_DV_START_BIT 4 // RelaxCfg Register: Maximum change of VCell over the dt period for the cell to be considered relaxed.
+#define RELAX_DV_END_BIT 7
+#define RELAX_DT_START_BIT 0 // RelaxCfg Register: The period over which the change of VCell is compared against dV.
+#define RELAX_DT_END_BIT 3
+#define LD_MDL_BIT 5 // Config2 Register: Set to 1 to load the custom model from the model table. The IC clears this bit when the model is loaded.
 #define HIB_BIT 1 // Hibernate Status. This bit is set to a 1 when the device is in hibernate mode or 0 when the device is in active mode. Hib is set to 0 at power-up.
 #define R100_BIT 13 // The R100 bit needs to be set when using a 100k NTC resistor
 #define VCHG_BIT 10 // Set to 1 for charge voltage higher than 4.25V (4.3V–4.4V). Set VChg to 0 for 4.2V charge voltage.
@@ -0,0 +1,218 @@
+#include "BatteryHealthTracker.h"
+
+// Layout of a record, multi-byte values are little endian
+constexpr uint8_t RECORD_TIME_OFFSET = 0;
+constexpr uint8_t RECORD_CYCLES_OFFSET = 4;
+constexpr uint8_t RECORD_HEALTH_OFFSET = 6;
+constexpr uint8_t RECORD_RESISTANCE_OFFSET = 7;
+constexpr float RECORD_CYCLES_RESOLUTION = 0.1f;
+constexpr float RECORD_HEALTH_RESOLUTION = 0.5f; // %
+constexpr float RECORD_RESISTANCE_RESOLUTION = 2.0f; // mΩ
+
+/**
+ * Scales a value to an unsigned integer of the given maximum, rounding to the nearest step.
+ */
+static uint32_t quantize(float value, float resolution, uint32_t maximum) {
+    float steps = value / resolution + 0.5f;
+    if (steps <= 0.0f) {
+        return 0;
+    }
+    return steps >= maximum ? maximum : static_cast<uint32_t>(steps);
+}
+
+void HealthRecord::encode(uint8_t *data) const {
+    uint16_t cyclesValue = quantize(cycles, RECORD_CYCLES_RESOLUTION, UINT16_MAX);
+    for (uint8_t index = 0; index < 4; ++index) {
+        data[RECORD_TIME_OFFSET + index] = time >> (8 * index);
+    }
+    data[RECORD_CYCLES_OFFSET] = cyclesValue & 0xFF;
+    data[RECORD_CYCLES_OFFSET + 1] = cyclesValue >> 8;
+    data[RECORD_HEALTH_OFFSET] = quantize(stateOfHealth, RECORD_HEALTH_RESOLUTION, UINT8_MAX);
+    data[RECORD_RESISTANCE_OFFSET] = quantize(internalResistance, RECORD_RESISTANCE_RESOLUTION, UINT8_MAX);
+}
+
+HealthRecord HealthRecord::decode(const uint8_t *data) {
+    HealthRecord record;
+    for (uint8_t index = 0; index < 4; ++index) {
+        record.time |= static_cast<uint32_t>(data[RECORD_TIME_OFFSET + index]) << (8 * index);
+    }
+    uint16_t cyclesValue = data[RECORD_CYCLES_OFFSET] | (data[RECORD_CYCLES_OFFSET + 1] << 8);
+    record.cycles = cyclesValue * RECORD_CYCLES_RESOLUTION;
+    record.stateOfHealth = data[RECORD_HEALTH_OFFSET] * RECORD_HEALTH_RESOLUTION;
+    record.internalResistance = data[RECORD_RESISTANCE_OFFSET] * RECORD_RESISTANCE_RESOLUTION;
+    return record;
+}
+
+MemoryTrendStore::MemoryTrendStore(uint8_t *buffer, uint16_t size) : buffer(buffer), capacity(size / HEALTH_RECORD_SIZE) {
+}
+
+bool MemoryTrendStore::append(const uint8_t *data, uint8_t length) {
+    if (length != HEALTH_RECORD_SIZE || capacity == 0) {
+        return false;
+    }
+
+    uint16_t slot = (first + records) % capacity;
+    memcpy(buffer + slot * HEALTH_RECORD_SIZE, data, HEALTH_RECORD_SIZE);
+    if (records < capacity) {
+        ++records;
+    } else {
+        first = (first + 1) % capacity; // The oldest record was overwritten
+    }
+    return true;
+}
+
+uint16_t MemoryTrendStore::count() {
+    return records;
+}
+
+bool MemoryTrendStore::read(uint16_t index, uint8_t *data, uint8_t length) {
+    if (length != HEALTH_RECORD_SIZE || index >= records) {
+        return false;
+    }
+
+    uint16_t slot = (first + index) % capacity;
+    memcpy(data, buffer + slot * HEALTH_RECORD_SIZE, HEALTH_RECORD_SIZE);
+    return true;
+}
+
+BatteryHealthTracker::BatteryHealthTracker(Battery &battery, HealthTrendStore *store) : battery(&battery), store(store) {
+}
+
+void BatteryHealthTracker::setRecordInterval(float cycles) {
+    this->recordInterval = max(cycles, RECORD_CYCLES_RESOLUTION);
+}
+
+void BatteryHealthTracker::setRegressionMemory(float cycles) {
+    this->regressionMemory = max(cycles, 1.0f);
+}
+
+uint16_t BatteryHealthTracker::restore() {
+    if (store == nullptr) {
+        return 0;
+    }
+
+    uint16_t count = store->count();
+    uint8_t data[HEALTH_RECORD_SIZE];
+    uint16_t restored = 0;
+    for (uint16_t index = 0; index < count; ++index) {
+        if (!store->read(index, data, HEALTH_RECORD_SIZE)) {
+            continue;
+        }
+
+        HealthRecord record = HealthRecord::decode(data);
+        addTrendPoint(record.cycles, record.stateOfHealth);
+        result.cycles = record.cycles;
+        result.stateOfHealth = record.stateOfHealth;
+        if (record.internalResistance > 0.0f) {
+            result.internalResistance = record.internalResistance;
+        }
+        ++restored;
+    }
+    return restored;
+}
+
+bool BatteryHealthTracker::update(uint32_t now, float cycles, float stateOfHealth, float voltage, float current) {
+    // Continue counting when the Cycles register rolls over
+    if (previousRawCycles >= 0.0f && cycles < previousRawCycles - HEALTH_CYCLES_ROLLOVER / 2) {
+        cycleOffset += HEALTH_CYCLES_ROLLOVER;
+    }
+    previousRawCycles = cycles;
+
+    // The fuel gauge starts counting from 0 after it lost power, continue from the last trend point instead
+    if (hasTrend && cycles + cycleOffset < lastTrendCycles) {
+        cycleOffset = lastTrendCycles - cycles;
+    }
+
+    result.cycles = cycles + cycleOffset;
+    result.stateOfHealth = stateOfHealth;
+
+    // The voltage changes by the current step times the internal resistance. The sign of the current
+    // doesn't matter since the voltage always moves in the direction of the charging current.
+    float currentStep = current - previousCurrent;
+    if (hasPreviousSample && now - previousSampleTime <= DEFAULT_RESISTANCE_SAMPLE_GAP && fabsf(currentStep) >= DEFAULT_RESISTANCE_MINIMUM_CURRENT_STEP) {
+        float resistance = fabsf((voltage - previousVoltage) * 1000000.0f / currentStep); // V / mA is kΩ, scaled to mΩ
+        if (result.internalResistance == 0.0f) {
+            result.internalResistance = resistance;
+        } else {
+            result.internalResistance += RESISTANCE_LEARNING_RATE * (resistance - result.internalResistance);
+        }
+    }
+    hasPreviousSample = true;
+    previousSampleTime = now;
+    previousVoltage = voltage;
+    previousCurrent = current;
+
+    if (hasTrend && result.cycles - lastTrendCycles < recordInterval) {
+        return false;
+    }
+
+    addTrendPoint(result.cycles, stateOfHealth);
+    if (store == nullptr) {
+        return true;
+    }
+
+    HealthRecord record;
+    record.time = now;
+    record.cycles = result.cycles;
+    record.stateOfHealth = stateOfHealth;
+    record.internalResistance = result.internalResistance;
+    uint8_t data[HEALTH_RECORD_SIZE];
+    record.encode(data);
+    return store->append(data, HEALTH_RECORD_SIZE);
+}
+
+bool BatteryHealthTracker::update(uint32_t now) {
+    float stateOfHealth = battery->stateOfHealth();
+    if (stateOfHealth < 0.0f) {
+        return false;
+    }
+    return update(now, battery->cycles(), stateOfHealth, battery->voltage(), battery->current());
+}
+
+BatteryHealth BatteryHealthTracker::health() {
+    return result;
+}
+
+float BatteryHealthTracker::remainingCycles(float endOfLife) {
+    if (result.stateOfHealth <= endOfLife) {
+        return 0.0f;
+    }
+    if (!result.fadeRateValid || result.fadeRate <= 0.0f) {
+        return -1.0f;
+    }
+    return (result.stateOfHealth - endOfLife) * 100.0f / result.fadeRate;
+}
+
+void BatteryHealthTracker::reset() {
+    hasTrend = false;
+    hasPreviousSample = false;
+    previousRawCycles = -1.0f;
+    cycleOffset = 0.0f;
+    result = BatteryHealth();
+}
+
+void BatteryHealthTracker::addTrendPoint(float cycles, float stateOfHealth) {
+    if (!hasTrend) {
+        originCycles = cycles;
+        lastTrendCycles = cycles;
+        sumWeights = sumCycles = sumHealth = sumCyclesSquared = sumCyclesHealth = 0.0f;
+        hasTrend = true;
+    }
+
+    // Older points lose weight with the cycles that passed since the last point
+    float decay = expf(-max(cycles - lastTrendCycles, 0.0f) / regressionMemory);
+    float x = cycles - originCycles;
+    sumWeights = sumWeights * decay + 1.0f;
+    sumCycles = sumCycles * decay + x;
+    sumHealth = sumHealth * decay + stateOfHealth;
+    sumCyclesSquared = sumCyclesSquared * decay + x * x;
+    sumCyclesHealth = sumCyclesHealth * decay + x * stateOfHealth;
+    lastTrendCycles = cycles;
+
+    float denominator = sumWeights * sumCyclesSquared - sumCycles * sumCycles;
+    result.fadeRateValid = cycles - originCycles >= HEALTH_MINIMUM_TREND_SPAN && denominator > 0.0f;
+    if (result.fadeRateValid) {
+        float slope = (sumWeights * sumCyclesHealth - sumCycles * sumHealth) / denominator;
+        result.fadeRate = -slope * 100.0f; // Loss per 100 cycles
+    }
+}
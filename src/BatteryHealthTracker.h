@@ -0,0 +1,231 @@
+#ifndef BATTERY_HEALTH_TRACKER_H
+#define BATTERY_HEALTH_TRACKER_H
+
+#include "Arduino.h"
+#include "Battery.h"
+
+constexpr uint8_t HEALTH_RECORD_SIZE = 8; // Bytes of an encoded HealthRecord
+constexpr float DEFAULT_HEALTH_RECORD_INTERVAL = 1.0f; // Cycles between two trend points
+constexpr float DEFAULT_HEALTH_REGRESSION_MEMORY = 200.0f; // Cycles after which a trend point has lost 63% of its weight
+constexpr float HEALTH_MINIMUM_TREND_SPAN = 5.0f; // Cycles the trend points must span before the fade rate is reported
+constexpr float HEALTH_CYCLES_ROLLOVER = 655.36f; // The Cycles register rolls over after this many cycles
+constexpr uint32_t DEFAULT_RESISTANCE_SAMPLE_GAP = 10; // s, maximum time between two samples used for the resistance estimate
+constexpr float DEFAULT_RESISTANCE_MINIMUM_CURRENT_STEP = 50.0f; // mA, smallest current change used for the resistance estimate
+constexpr float RESISTANCE_LEARNING_RATE = 0.2f; // Weight of a new resistance observation
+
+/**
+ * @brief A trend point of the battery health, stored as a compact record of HEALTH_RECORD_SIZE bytes.
+ */
+struct HealthRecord {
+    /// @brief The time the point was recorded in seconds, in the timebase passed to BatteryHealthTracker::update().
+    uint32_t time = 0;
+
+    /// @brief The number of charge cycles, stored with a resolution of 0.1 cycles (up to 6553 cycles).
+    float cycles = 0.0f;
+
+    /// @brief The state of health in percent, stored with a resolution of 0.5% (up to 127.5%).
+    float stateOfHealth = 0.0f;
+
+    /// @brief The internal resistance in milliohms (mΩ), stored with a resolution of 2mΩ (up to 510mΩ). 0 if unknown.
+    float internalResistance = 0.0f;
+
+    /**
+     * @brief Writes the record in its compact form, multi-byte values are little endian.
+     * @param data Buffer of HEALTH_RECORD_SIZE bytes.
+     */
+    void encode(uint8_t *data) const;
+
+    /**
+     * @brief Reads a record from its compact form.
+     * @param data Buffer of HEALTH_RECORD_SIZE bytes.
+     * @return The decoded record.
+     */
+    static HealthRecord decode(const uint8_t *data);
+};
+
+/**
+ * @brief Keeps the trend points of a BatteryHealthTracker, e.g. in flash or on an SD card.
+ * Implement this to send the points wherever they are collected.
+ */
+class HealthTrendStore {
+    public:
+        virtual ~HealthTrendStore() = default;
+
+        /**
+         * @brief Appends a record.
+         * @param data The encoded record.
+         * @param length The number of bytes, HEALTH_RECORD_SIZE.
+         * @return True if the record was stored, false otherwise.
+         */
+        virtual bool append(const uint8_t *data, uint8_t length) = 0;
+
+        /**
+         * @brief Returns the number of records that can be read back.
+         * @return The number of records.
+         */
+        virtual uint16_t count() = 0;
+
+        /**
+         * @brief Reads a record back, 0 is the oldest.
+         * @param index The index of the record.
+         * @param data The buffer that receives the record.
+         * @param length The number of bytes, HEALTH_RECORD_SIZE.
+         * @return True if the record was read, false otherwise.
+         */
+        virtual bool read(uint16_t index, uint8_t *data, uint8_t length) = 0;
+};
+
+/**
+ * @brief Keeps the most recent trend points in a RAM buffer, overwriting the oldest when it's full.
+ */
+class MemoryTrendStore : public HealthTrendStore {
+    public:
+        /**
+         * @brief Constructs a new MemoryTrendStore object.
+         * @param buffer The buffer that holds the records.
+         * @param size The size of the buffer in bytes, a multiple of HEALTH_RECORD_SIZE.
+         */
+        MemoryTrendStore(uint8_t *buffer, uint16_t size);
+
+        bool append(const uint8_t *data, uint8_t length) override;
+        uint16_t count() override;
+        bool read(uint16_t index, uint8_t *data, uint8_t length) override;
+
+    private:
+        uint8_t *buffer;
+        uint16_t capacity; // In records
+        uint16_t first = 0;
+        uint16_t records = 0;
+};
+
+/**
+ * @brief The battery health as estimated by the BatteryHealthTracker.
+ */
+struct BatteryHealth {
+    /// @brief The state of health in percent, see Battery::stateOfHealth().
+    float stateOfHealth = 0.0f;
+
+    /// @brief The number of charge cycles, continued across roll-overs of the Cycles register.
+    float cycles = 0.0f;
+
+    /// @brief The loss of state of health in percentage points per 100 cycles. Only valid if fadeRateValid is true.
+    float fadeRate = 0.0f;
+
+    /// @brief True once the trend points span enough cycles to estimate the fade rate.
+    bool fadeRateValid = false;
+
+    /// @brief The estimated internal resistance of the battery in milliohms (mΩ), 0 until a load step was observed.
+    float internalResistance = 0.0f;
+};
+
+/**
+ * @brief Tracks the state of health of the battery and how fast it fades.
+ *
+ * The tracker is updated periodically with the readings of the fuel gauge. Whenever the battery went through
+ * another record interval of charge cycles it stores a trend point and adds it to an exponentially weighted
+ * linear regression of the state of health over the cycles. The regression is kept as five running sums,
+ * so every update takes constant time and memory regardless of the battery's age. Older points lose weight
+ * with the cycles, so the fade rate follows the battery as it ages.
+ *
+ * The internal resistance is estimated from the voltage change across a load step: when two consecutive
+ * updates are close in time and the current changed enough, ΔV/ΔI is blended into the estimate.
+ * Updating right before and after switching a large load, e.g. a radio, gives the best estimates.
+ *
+ * After a reset, restore() rebuilds the regression from the stored trend points. The tracker doesn't access any
+ * hardware except in update(uint32_t), so it can be driven with simulated values.
+ */
+class BatteryHealthTracker {
+    public:
+        /**
+         * @brief Constructs a new BatteryHealthTracker object.
+         * @param battery The battery whose fuel gauge is read.
+         * @param store The store that keeps the trend points, or nullptr to keep only the regression.
+         */
+        BatteryHealthTracker(Battery &battery, HealthTrendStore *store = nullptr);
+
+        /**
+         * @brief Sets how many cycles pass between two trend points.
+         * @param cycles The interval in cycles, at least 0.1.
+         */
+        void setRecordInterval(float cycles);
+
+        /**
+         * @brief Sets how quickly old trend points lose their weight in the fade rate.
+         * @param cycles The number of cycles after which a point has lost 63% of its weight.
+         */
+        void setRegressionMemory(float cycles);
+
+        /**
+         * @brief Rebuilds the regression from the points in the store. Call this once after a reset before the first update.
+         * @return The number of points that were read.
+         */
+        uint16_t restore();
+
+        /**
+         * @brief Updates the estimates with new readings.
+         * @param now The current time in seconds.
+         * @param cycles The Cycles register value, see Battery::cycles().
+         * @param stateOfHealth The state of health in percent, see Battery::stateOfHealth().
+         * @param voltage The battery voltage in volts (V).
+         * @param current The battery current in milli amperes (mA).
+         * @return True if a trend point was recorded, false otherwise.
+         */
+        bool update(uint32_t now, float cycles, float stateOfHealth, float voltage, float current);
+
+        /**
+         * @brief Updates the estimates with the readings of the fuel gauge.
+         * @param now The current time in seconds, e.g. the Unix time from the RTC.
+         * @return True if a trend point was recorded, false if not or the battery isn't connected.
+         */
+        bool update(uint32_t now);
+
+        /**
+         * @brief Returns the current estimates.
+         * @return The battery health.
+         */
+        BatteryHealth health();
+
+        /**
+         * @brief Estimates how many cycles are left until the state of health drops to the given value.
+         * @param endOfLife The state of health in percent at which the battery should be replaced, e.g. 80.
+         * @return The remaining cycles, 0 if the value was already reached or -1 if the fade rate isn't known yet or the battery doesn't fade.
+         */
+        float remainingCycles(float endOfLife);
+
+        /**
+         * @brief Discards the regression and the resistance estimate. The store is left alone.
+         */
+        void reset();
+
+    private:
+        /**
+         * Adds a point to the regression, decaying the older points by the cycles since the last point.
+         */
+        void addTrendPoint(float cycles, float stateOfHealth);
+
+        Battery *battery;
+        HealthTrendStore *store;
+        float recordInterval = DEFAULT_HEALTH_RECORD_INTERVAL;
+        float regressionMemory = DEFAULT_HEALTH_REGRESSION_MEMORY;
+
+        BatteryHealth result;
+        float cycleOffset = 0.0f; // Cycles lost to roll-overs of the Cycles register
+        float previousRawCycles = -1.0f;
+
+        // Running sums of the weighted regression, cycles are relative to the first point to keep the sums small
+        bool hasTrend = false;
+        float originCycles = 0.0f;
+        float lastTrendCycles = 0.0f;
+        float sumWeights = 0.0f;
+        float sumCycles = 0.0f;
+        float sumHealth = 0.0f;
+        float sumCyclesSquared = 0.0f;
+        float sumCyclesHealth = 0.0f;
+
+        bool hasPreviousSample = false;
+        uint32_t previousSampleTime = 0;
+        float previousVoltage = 0.0f;
+        float previousCurrent = 0.0f;
+};
+
+#endif
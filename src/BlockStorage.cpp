@@ -0,0 +1,164 @@
+#include "BlockStorage.h"
+
+RamBlockStorage::RamBlockStorage(uint8_t *buffer, uint32_t size, uint32_t sectorSize) : buffer(buffer), bufferSize(size), sectorSize(sectorSize) {
+    memset(buffer, 0xFF, size);
+}
+
+bool RamBlockStorage::read(uint32_t address, void *data, uint32_t size) {
+    if (address + size > bufferSize) {
+        return false;
+    }
+    memcpy(data, buffer + address, size);
+    return true;
+}
+
+bool RamBlockStorage::program(uint32_t address, const void *data, uint32_t size) {
+    if (address + size > bufferSize) {
+        return false;
+    }
+
+    // Like flash, programming can only clear bits
+    const uint8_t *bytes = static_cast<const uint8_t *>(data);
+    for (uint32_t index = 0; index < size; ++index) {
+        buffer[address + index] &= bytes[index];
+    }
+    return true;
+}
+
+bool RamBlockStorage::erase(uint32_t address, uint32_t size) {
+    if (address % sectorSize != 0 || size % sectorSize != 0 || address + size > bufferSize) {
+        return false;
+    }
+    memset(buffer + address, 0xFF, size);
+    return true;
+}
+
+uint32_t RamBlockStorage::eraseSize() {
+    return sectorSize;
+}
+
+uint32_t RamBlockStorage::programSize() {
+    return 1;
+}
+
+uint32_t RamBlockStorage::size() {
+    return bufferSize;
+}
+
+#if defined(ARDUINO_PORTENTA_H7) || defined(ARDUINO_NICLA_VISION)
+MbedBlockStorage::MbedBlockStorage(mbed::BlockDevice &device, uint32_t offset, uint32_t size) : device(&device), offset(offset), regionSize(size) {
+}
+
+bool MbedBlockStorage::read(uint32_t address, void *data, uint32_t size) {
+    if (address + size > regionSize) {
+        return false;
+    }
+    return device->read(data, offset + address, size) == 0;
+}
+
+bool MbedBlockStorage::program(uint32_t address, const void *data, uint32_t size) {
+    if (address + size > regionSize) {
+        return false;
+    }
+    return device->program(data, offset + address, size) == 0;
+}
+
+bool MbedBlockStorage::erase(uint32_t address, uint32_t size) {
+    if (address + size > regionSize) {
+        return false;
+    }
+    return device->erase(offset + address, size) == 0;
+}
+
+uint32_t MbedBlockStorage::eraseSize() {
+    return device->get_erase_size();
+}
+
+uint32_t MbedBlockStorage::programSize() {
+    return device->get_program_size();
+}
+
+uint32_t MbedBlockStorage::size() {
+    return regionSize;
+}
+#endif
+
+#if defined(ARDUINO_POWER_MANAGEMENT_HOST_SIM)
+FileBlockStorage::FileBlockStorage(const char *path, uint32_t size, uint32_t sectorSize) : fileSize(size), sectorSize(sectorSize) {
+    file = fopen(path, "r+b");
+    if (file != nullptr) {
+        return;
+    }
+
+    // A new file starts out erased
+    file = fopen(path, "w+b");
+    if (file != nullptr && !erase(0, size)) {
+        fclose(file);
+        file = nullptr;
+    }
+}
+
+FileBlockStorage::~FileBlockStorage() {
+    if (file != nullptr) {
+        fclose(file);
+    }
+}
+
+bool FileBlockStorage::read(uint32_t address, void *data, uint32_t size) {
+    if (file == nullptr || address + size > fileSize || fseek(file, address, SEEK_SET) != 0) {
+        return false;
+    }
+    return fread(data, 1, size, file) == size;
+}
+
+bool FileBlockStorage::program(uint32_t address, const void *data, uint32_t size) {
+    const uint8_t *bytes = static_cast<const uint8_t *>(data);
+    uint8_t chunk[64];
+
+    // Like flash, programming can only clear bits
+    for (uint32_t done = 0; done < size; done += sizeof(chunk)) {
+        uint32_t length = min(size - done, static_cast<uint32_t>(sizeof(chunk)));
+        if (!read(address + done, chunk, length)) {
+            return false;
+        }
+        for (uint32_t index = 0; index < length; ++index) {
+            chunk[index] &= bytes[done + index];
+        }
+        if (fseek(file, address + done, SEEK_SET) != 0 || fwrite(chunk, 1, length, file) != length) {
+            return false;
+        }
+    }
+    return fflush(file) == 0;
+}
+
+bool FileBlockStorage::erase(uint32_t address, uint32_t size) {
+    if (file == nullptr || address % sectorSize != 0 || size % sectorSize != 0 || address + size > fileSize) {
+        return false;
+    }
+
+    uint8_t chunk[64];
+    memset(chunk, 0xFF, sizeof(chunk));
+    if (fseek(file, address, SEEK_SET) != 0) {
+        return false;
+    }
+    for (uint32_t done = 0; done < size; done += sizeof(chunk)) {
+        uint32_t length = min(size - done, static_cast<uint32_t>(sizeof(chunk)));
+        if (fwrite(chunk, 1, length, file) != length) {
+            return false;
+        }
+    }
+    return fflush(file) == 0;
+}
+
+uint32_t FileBlockStorage::eraseSize() {
+    return sectorSize;
+}
+
+uint32_t FileBlockStorage::programSize() {
+    return 1;
+}
+
+uint32_t FileBlockStorage::size() {
+    return fileSize;
+}
+#endif
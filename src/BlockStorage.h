@@ -0,0 +1,154 @@
+#ifndef BLOCK_STORAGE_H
+#define BLOCK_STORAGE_H
+
+#include "Arduino.h"
+
+#if defined(ARDUINO_PORTENTA_H7) || defined(ARDUINO_NICLA_VISION)
+#include "BlockDevice.h"
+#endif
+
+#if defined(ARDUINO_POWER_MANAGEMENT_HOST_SIM)
+#include <stdio.h>
+#endif
+
+/**
+ * @brief Non-volatile memory with flash semantics, as used by the MetadataStore.
+ * The memory is divided into sectors of eraseSize() bytes. Erasing sets all bytes of a sector to 0xFF,
+ * programming can only clear bits, so a byte must be erased before it can be programmed again.
+ * Implement this to use other memories, e.g. the data flash of the Portenta C33.
+ */
+class BlockStorage {
+    public:
+        virtual ~BlockStorage() = default;
+
+        /**
+         * @brief Reads bytes from the memory.
+         * @param address The address of the first byte.
+         * @param data The buffer that receives the bytes.
+         * @param size The number of bytes, a multiple of programSize().
+         * @return True if the bytes were read, false otherwise.
+         */
+        virtual bool read(uint32_t address, void *data, uint32_t size) = 0;
+
+        /**
+         * @brief Programs erased bytes.
+         * @param address The address of the first byte, a multiple of programSize().
+         * @param data The bytes to program.
+         * @param size The number of bytes, a multiple of programSize().
+         * @return True if the bytes were programmed, false otherwise.
+         */
+        virtual bool program(uint32_t address, const void *data, uint32_t size) = 0;
+
+        /**
+         * @brief Erases whole sectors.
+         * @param address The address of the first sector, a multiple of eraseSize().
+         * @param size The number of bytes, a multiple of eraseSize().
+         * @return True if the sectors were erased, false otherwise.
+         */
+        virtual bool erase(uint32_t address, uint32_t size) = 0;
+
+        /**
+         * @brief Returns the size of a sector, the smallest unit that can be erased.
+         * @return The sector size in bytes.
+         */
+        virtual uint32_t eraseSize() = 0;
+
+        /**
+         * @brief Returns the smallest unit that can be programmed.
+         * @return The program size in bytes.
+         */
+        virtual uint32_t programSize() = 0;
+
+        /**
+         * @brief Returns the size of the memory.
+         * @return The size in bytes.
+         */
+        virtual uint32_t size() = 0;
+};
+
+/**
+ * @brief Emulates flash memory in a RAM buffer. Its content is lost in standby and on reset,
+ * so it's meant for trying out and benchmarking the MetadataStore.
+ */
+class RamBlockStorage : public BlockStorage {
+    public:
+        /**
+         * @brief Constructs a new RamBlockStorage object. The buffer starts out erased.
+         * @param buffer The buffer that holds the memory.
+         * @param size The size of the buffer in bytes, a multiple of sectorSize.
+         * @param sectorSize The emulated sector size in bytes.
+         */
+        RamBlockStorage(uint8_t *buffer, uint32_t size, uint32_t sectorSize);
+
+        bool read(uint32_t address, void *data, uint32_t size) override;
+        bool program(uint32_t address, const void *data, uint32_t size) override;
+        bool erase(uint32_t address, uint32_t size) override;
+        uint32_t eraseSize() override;
+        uint32_t programSize() override;
+        uint32_t size() override;
+
+    private:
+        uint8_t *buffer;
+        uint32_t bufferSize;
+        uint32_t sectorSize;
+};
+
+#if defined(ARDUINO_PORTENTA_H7) || defined(ARDUINO_NICLA_VISION)
+/**
+ * @brief Uses a region of an Mbed OS block device, e.g. the QSPI flash of the Portenta H7.
+ * Make sure the region doesn't overlap with a file system or the WiFi firmware.
+ */
+class MbedBlockStorage : public BlockStorage {
+    public:
+        /**
+         * @brief Constructs a new MbedBlockStorage object.
+         * @param device The block device, it must be initialized before the store is used.
+         * @param offset The start of the region in bytes, a multiple of the erase size.
+         * @param size The size of the region in bytes, a multiple of the erase size.
+         */
+        MbedBlockStorage(mbed::BlockDevice &device, uint32_t offset, uint32_t size);
+
+        bool read(uint32_t address, void *data, uint32_t size) override;
+        bool program(uint32_t address, const void *data, uint32_t size) override;
+        bool erase(uint32_t address, uint32_t size) override;
+        uint32_t eraseSize() override;
+        uint32_t programSize() override;
+        uint32_t size() override;
+
+    private:
+        mbed::BlockDevice *device;
+        uint32_t offset;
+        uint32_t regionSize;
+};
+#endif
+
+#if defined(ARDUINO_POWER_MANAGEMENT_HOST_SIM)
+/**
+ * @brief Emulates flash memory in a file, so the content survives a restart of a host simulation.
+ */
+class FileBlockStorage : public BlockStorage {
+    public:
+        /**
+         * @brief Constructs a new FileBlockStorage object.
+         * @param path The file to use. It's created erased if it doesn't exist.
+         * @param size The size of the memory in bytes, a multiple of sectorSize.
+         * @param sectorSize The emulated sector size in bytes.
+         */
+        FileBlockStorage(const char *path, uint32_t size, uint32_t sectorSize);
+        ~FileBlockStorage();
+
+        bool read(uint32_t address, void *data, uint32_t size) override;
+        bool program(uint32_t address, const void *data, uint32_t size) override;
+        bool erase(uint32_t address, uint32_t size) override;
+        uint32_t eraseSize() override;
+        uint32_t programSize() override;
+        uint32_t size() override;
+
+    private:
+        FILE *file = nullptr;
+        uint32_t fileSize;
+        uint32_t sectorSize;
+};
+#endif
+
+#endif
@@ -1,5 +1,6 @@
 #include "Board.h"
 #include "MAX1726Driver.h"
+#include "Charger.h"
 #include <map>
 
 #if defined(ARDUINO_PORTENTA_H7)
@@ -63,6 +64,11 @@ Board::~Board() {
 }
 
 bool Board::begin() {
+    prepareCores();
+    return PMIC.begin() == 0;
+}
+
+void Board::prepareCores() {
     #if defined(ARDUINO_PORTENTA_H7_M7)
         if (CM7_CPUID == HAL_GetCurrentCPUID()){
             if (LowPowerReturnCode::success != LowPower.checkOptionBytes()){
@@ -71,12 +77,11 @@ bool Board::begin() {
             bootM4();
         }
     #endif 
-    return PMIC.begin() == 0;
 }
 
 bool Board::isUSBPowered() {
     uint16_t registerValue = PMIC.readPMICreg(Register::CHARGER_VBUS_SNS);
-    return bitRead(registerValue, 5) == 1; // — VBUS is valid -> USB powered
+    return bitRead(registerValue, CHARGER_VBUS_VALID_BIT) == 1; // — VBUS is valid -> USB powered
 }
 
 bool Board::isBatteryPowered() {
@@ -86,10 +91,7 @@ bool Board::isBatteryPowered() {
 }
 
 void Board::setExternalPowerEnabled(bool on) {
-        if(on)
-            PMIC.getControl()->turnSw2On(Sw2Mode::Normal);
-        else
-            PMIC.getControl()->turnSw2Off(Sw2Mode::Normal);
+    setRailEnabled(PowerRail::sw2, on);
 }
 
 bool Board::setExternalVoltage(float voltage) {
@@ -100,8 +102,7 @@ bool Board::setExternalVoltage(float voltage) {
             return false;
         }
 
-        PMIC.writePMICreg(Register::PMIC_SW2_VOLT, targetVoltage);
-        if(PMIC.readPMICreg(Register::PMIC_SW2_VOLT) == targetVoltage){
+        if(writeRailVoltage(PowerRail::sw2, targetVoltage)){
             this -> setExternalPowerEnabled(true);
             return true;
         }
@@ -110,21 +111,46 @@ bool Board::setExternalVoltage(float voltage) {
 }
 
 void Board::setCameraPowerEnabled(bool on) {
-    #if defined(ARDUINO_NICLA_VISION)
-        if(on){
-            PMIC.getControl()->turnLDO1On(Ldo1Mode::Normal);
-            PMIC.getControl()->turnLDO2On(Ldo2Mode::Normal);
-            PMIC.getControl()->turnLDO3On(Ldo3Mode::Normal);
-        } else {
-            PMIC.getControl()->turnLDO1Off(Ldo1Mode::Normal);
-            PMIC.getControl()->turnLDO2Off(Ldo2Mode::Normal);
-            PMIC.getControl()->turnLDO3Off(Ldo3Mode::Normal);
-        }
-    #endif
+    if (CurrentBoardTraits::hasCameraRails) {
+        setRailEnabled(PowerRail::ldo1, on);
+        setRailEnabled(PowerRail::ldo2, on);
+        setRailEnabled(PowerRail::ldo3, on);
+    }
+}
+
+void Board::setRailEnabled(PowerRail rail, bool on) {
+    switch (rail) {
+        case PowerRail::sw1:
+            if(on) PMIC.getControl()->turnSw1On(Sw1Mode::Normal);
+            else PMIC.getControl()->turnSw1Off(Sw1Mode::Normal);
+            break;
+        case PowerRail::sw2:
+            if(on) PMIC.getControl()->turnSw2On(Sw2Mode::Normal);
+            else PMIC.getControl()->turnSw2Off(Sw2Mode::Normal);
+            break;
+        case PowerRail::ldo1:
+            if(on) PMIC.getControl()->turnLDO1On(Ldo1Mode::Normal);
+            else PMIC.getControl()->turnLDO1Off(Ldo1Mode::Normal);
+            break;
+        case PowerRail::ldo2:
+            if(on) PMIC.getControl()->turnLDO2On(Ldo2Mode::Normal);
+            else PMIC.getControl()->turnLDO2Off(Ldo2Mode::Normal);
+            break;
+        case PowerRail::ldo3:
+            if(on) PMIC.getControl()->turnLDO3On(Ldo3Mode::Normal);
+            else PMIC.getControl()->turnLDO3Off(Ldo3Mode::Normal);
+            break;
+    }
+
+    uint8_t index = static_cast<uint8_t>(rail);
+    bitSet(knownRails, index);
+    if(on) bitSet(enabledRails, index);
+    else bitClear(enabledRails, index);
 }
 
 #if defined(ARDUINO_PORTENTA_C33) 
 void Board::enableWakeupFromPin(uint8_t pin, PinStatus direction){
+    standbyType |= StandbyType::untilPinActivity;
     lowPower->enableWakeupFromPin(pin, direction);
 }
 #endif
@@ -142,6 +168,10 @@ void Board::enableSleepWhenIdle(){
 
 #if defined(ARDUINO_PORTENTA_C33)
 bool Board::enableWakeupFromRTC(uint32_t hours, uint32_t minutes, uint32_t seconds, void (* const callbackFunction)(), RTClock * rtc){
+    standbyType |= StandbyType::untilTimeElapsed;
+    wakeupDelayHours = hours;
+    wakeupDelayMinutes = minutes;
+    wakeupDelaySeconds = seconds;
     return lowPower->setWakeUpAlarm(hours, minutes, seconds, callbackFunction, rtc);
 }
 
@@ -184,30 +214,21 @@ void Board::standByUntilWakeupEvent(){
 }
 
 void Board::setAllPeripheralsPower(bool on){
-    #if defined(ARDUINO_PORTENTA_C33)
-    // The power architecture on the C33 puts peripherals on sepparate power lanes which are independent, so we can turn off the peripherals separately. 
-    // Turning these rails will not interfere with your sketch. 
-        this -> setCommunicationPeripheralsPower(on);
-        this -> setExternalPowerEnabled(on);
-        this -> setAnalogDigitalConverterPower(on);
-    #else if defined(ARDUINO_PORTENTA_H7)
-    // On the H7 several chips need different voltages, so we cannot turn the lanes that are dependent on each other separately.
-    // This should only be used when going into standby mode, as turning off the USB-C PHY, Ethernet or Video bridge might cause undefined behaviour. 
-    if(on){
-        PMIC.getControl() -> turnLDO2On(Ldo2Mode::Normal);
-        PMIC.getControl() -> turnLDO1On(Ldo1Mode::Normal);
-        PMIC.getControl() -> turnLDO3On(Ldo3Mode::Normal);
-        PMIC.getControl() -> turnSw1On(Sw1Mode::Normal);
-    } else {
-        #if defined(ARDUINO_PORTENTA_H7)
-        // Ethernet must be turned off before we enter Standby Mode, because
-        // otherwise, the Ethernet transmit termination resistors will overheat
-        // from the voltage that gets applied over them. It would be 125 mW in each
-        // of them, while they are rated at 50 mW. If we fail to turn off Ethernet,
-        // we must not proceed.
-
-        if (false == lowPowerPortentaH7.turnOffEthernet())
-        {
+    if (CurrentBoardTraits::hasSharedPeripheralRails) {
+        // On the H7 several chips need different voltages, so we cannot turn the lanes that are dependent on each other separately.
+        // This should only be used when going into standby mode, as turning off the USB-C PHY, Ethernet or Video bridge might cause undefined behaviour. 
+        if(on){
+            this -> setRailEnabled(PowerRail::ldo2, true);
+            this -> setRailEnabled(PowerRail::ldo1, true);
+            this -> setRailEnabled(PowerRail::ldo3, true);
+            this -> setRailEnabled(PowerRail::sw1, true);
+        } else {
+            // Ethernet must be turned off before we enter Standby Mode, because
+            // otherwise, the Ethernet transmit termination resistors will overheat
+            // from the voltage that gets applied over them. It would be 125 mW in each
+            // of them, while they are rated at 50 mW. If we fail to turn off Ethernet,
+            // we must not proceed.
+            if (false == turnOffEthernet())
             {
                 while(1)
                 {
@@ -217,37 +238,42 @@ void Board::setAllPeripheralsPower(bool on){
                     delay(500);
                 }
             }
+            this -> setRailEnabled(PowerRail::ldo1, false);
+            this -> setRailEnabled(PowerRail::ldo2, false);
+            this -> setRailEnabled(PowerRail::ldo3, false);
+            this -> setRailEnabled(PowerRail::sw1, false);
         }
-        #endif
-        PMIC.getControl() -> turnLDO1Off(Ldo1Mode::Normal);
-        PMIC.getControl() -> turnLDO2Off(Ldo2Mode::Normal);
-        PMIC.getControl() -> turnLDO3Off(Ldo3Mode::Normal);
-        PMIC.getControl() -> turnSw1Off(Sw1Mode::Normal);
+    } else {
+        // The power architecture on the C33 puts peripherals on sepparate power lanes which are independent, so we can turn off the peripherals separately. 
+        // Turning these rails will not interfere with your sketch. 
+        this -> setCommunicationPeripheralsPower(on);
+        this -> setExternalPowerEnabled(on);
+        this -> setAnalogDigitalConverterPower(on);
+        this -> setCameraPowerEnabled(on);
     }
-    #endif
 }
-//
+
 void Board::setAnalogDigitalConverterPower(bool on){
-    #if defined(ARDUINO_PORTENTA_C33)
-        if(on){
-            PMIC.getControl()->turnLDO1On(Ldo1Mode::Normal);
-        } else {
-            PMIC.getControl()->turnLDO1Off(Ldo1Mode::Normal);
-        }
-    #endif
     // On the H7 the ADC is powered by the main MCU power lane, so we cannot turn it off independently. 
+    if (CurrentBoardTraits::hasAnalogDigitalConverterRail) {
+        setRailEnabled(PowerRail::ldo1, on);
+    }
 }
 
 void Board::setCommunicationPeripheralsPower(bool on){
-    #if defined(ARDUINO_PORTENTA_C33)
-        if(on){
-            PMIC.getControl()->turnSw1On(Sw1Mode::Normal);
-        } else {
-            PMIC.getControl()->turnSw1Off(Sw1Mode::Normal);
-        }
-    #endif
     // On the H7 the communication peripherals are powered by the main MCU power lane, 
     // so we cannot turn them off independently. 
+    if (CurrentBoardTraits::hasCommunicationRail) {
+        setRailEnabled(PowerRail::sw1, on);
+    }
+}
+
+bool Board::turnOffEthernet(){
+    #if defined(ARDUINO_PORTENTA_H7)
+        return lowPowerPortentaH7.turnOffEthernet();
+    #else
+        return true; // No Ethernet PHY on the PMIC rails of this board
+    #endif
 }
 
 
@@ -257,13 +283,136 @@ bool Board::setReferenceVoltage(float voltage) {
     // If voltageRegisterValue is not empty, write it to the PMIC register 
     // and return the result of the comparison directly.
     if (voltageRegisterValue != UNKNOWN_VALUE) {
-        PMIC.writePMICreg(Register::PMIC_LDO2_VOLT, voltageRegisterValue);
-        return (PMIC.readPMICreg(Register::PMIC_LDO2_VOLT) == voltageRegisterValue);
+        return writeRailVoltage(PowerRail::ldo2, voltageRegisterValue);
     }
 
     return false;
 }
 
+// Rails are turned on in this order and turned off in the reverse order
+constexpr PowerRail railPowerUpOrder[POWER_RAIL_COUNT] = {
+    PowerRail::ldo2, PowerRail::ldo1, PowerRail::ldo3, PowerRail::sw1, PowerRail::sw2
+};
+
+bool Board::setPowerMode(const PowerMode &mode, PowerModeTransition *transition) {
+    unsigned long startTime = micros();
+    PowerModeTransition result;
+    uint8_t targetVoltages[POWER_RAIL_COUNT];
+
+    // Resolve all voltages first so that an invalid mode doesn't leave the rails half configured
+    for (uint8_t index = 0; index < POWER_RAIL_COUNT; ++index) {
+        targetVoltages[index] = UNKNOWN_VALUE;
+        if (mode.rails[index].voltage == 0.0f) {
+            continue;
+        }
+
+        int context;
+        switch (static_cast<PowerRail>(index)) {
+            case PowerRail::sw1: context = CONTEXT_SW1; break;
+            case PowerRail::sw2: context = CONTEXT_SW2; break;
+            case PowerRail::ldo2: context = CONTEXT_LDO2; break;
+            default: return false; // The voltage of LDO1 and LDO3 can't be changed
+        }
+
+        targetVoltages[index] = getRailVoltageEnum(mode.rails[index].voltage, context);
+        if (targetVoltages[index] == UNKNOWN_VALUE) {
+            return false;
+        }
+    }
+
+    auto isKnownOn = [this](uint8_t index) { return bitRead(knownRails, index) && bitRead(enabledRails, index); };
+    auto isKnownOff = [this](uint8_t index) { return bitRead(knownRails, index) && !bitRead(enabledRails, index); };
+    auto voltageChanges = [&](uint8_t index) {
+        return targetVoltages[index] != UNKNOWN_VALUE && railVoltages[index] != targetVoltages[index];
+    };
+
+    // 1. Turn off the rails that go off, as well as the rails that go on with a different voltage
+    for (int8_t order = POWER_RAIL_COUNT - 1; order >= 0; --order) {
+        uint8_t index = static_cast<uint8_t>(railPowerUpOrder[order]);
+        RailState state = mode.rails[index].state;
+        bool turnOff = state == RailState::off || (state == RailState::on && voltageChanges(index));
+        if (turnOff && !isKnownOff(index)) {
+            setRailEnabled(railPowerUpOrder[order], false);
+            ++result.railWrites;
+        }
+    }
+
+    // 2. Change the voltages
+    uint8_t failedVoltages = 0;
+    for (uint8_t index = 0; index < POWER_RAIL_COUNT; ++index) {
+        if (voltageChanges(index)) {
+            if (!writeRailVoltage(static_cast<PowerRail>(index), targetVoltages[index])) {
+                bitSet(failedVoltages, index);
+            }
+            ++result.voltageWrites;
+        }
+    }
+
+    // 3. Turn on the rails in power-up order, except those whose voltage couldn't be set
+    for (uint8_t order = 0; order < POWER_RAIL_COUNT; ++order) {
+        uint8_t index = static_cast<uint8_t>(railPowerUpOrder[order]);
+        if (mode.rails[index].state == RailState::on && !isKnownOn(index) && !bitRead(failedVoltages, index)) {
+            setRailEnabled(railPowerUpOrder[order], true);
+            ++result.railWrites;
+        }
+    }
+
+    result.duration = micros() - startTime;
+    if (transition != nullptr) {
+        *transition = result;
+    }
+    return failedVoltages == 0;
+}
+
+void Board::invalidateRailStates() {
+    knownRails = 0;
+    enabledRails = 0;
+    for (uint8_t index = 0; index < POWER_RAIL_COUNT; ++index) {
+        railVoltages[index] = UNKNOWN_VALUE;
+    }
+}
+
+PowerMode Board::knownPowerMode() {
+    PowerMode mode;
+    for (uint8_t index = 0; index < POWER_RAIL_COUNT; ++index) {
+        if (bitRead(knownRails, index)) {
+            mode.rails[index].state = bitRead(enabledRails, index) ? RailState::on : RailState::off;
+        }
+    }
+
+    mode.rails[static_cast<uint8_t>(PowerRail::sw1)].voltage = getRailVoltage(railVoltages[static_cast<uint8_t>(PowerRail::sw1)], CONTEXT_SW1);
+    mode.rails[static_cast<uint8_t>(PowerRail::sw2)].voltage = getRailVoltage(railVoltages[static_cast<uint8_t>(PowerRail::sw2)], CONTEXT_SW2);
+    mode.rails[static_cast<uint8_t>(PowerRail::ldo2)].voltage = getRailVoltage(railVoltages[static_cast<uint8_t>(PowerRail::ldo2)], CONTEXT_LDO2);
+    return mode;
+}
+
+bool Board::writeRailVoltage(PowerRail rail, uint8_t voltageRegisterValue) {
+    Register voltageRegister;
+    switch (rail) {
+        case PowerRail::sw1:
+            voltageRegister = Register::PMIC_SW1_VOLT;
+            break;
+        case PowerRail::sw2:
+            voltageRegister = Register::PMIC_SW2_VOLT;
+            break;
+        case PowerRail::ldo2:
+            voltageRegister = Register::PMIC_LDO2_VOLT;
+            break;
+        default:
+            return false;
+    }
+
+    PMIC.writePMICreg(voltageRegister, voltageRegisterValue);
+    uint8_t index = static_cast<uint8_t>(rail);
+    if (PMIC.readPMICreg(voltageRegister) != voltageRegisterValue) {
+        // The register may hold anything now, so the next transition has to write it again
+        railVoltages[index] = UNKNOWN_VALUE;
+        return false;
+    }
+    railVoltages[index] = voltageRegisterValue;
+    return true;
+}
+
  uint8_t Board::getRailVoltageEnum(float voltage, int context) {
     switch (context) {
         case CONTEXT_LDO2:
@@ -292,15 +441,29 @@ bool Board::setReferenceVoltage(float voltage) {
     return UNKNOWN_VALUE;
 }
 
+float Board::getRailVoltage(uint8_t voltageRegisterValue, int context) {
+    auto findVoltage = [voltageRegisterValue](const auto &voltageMap) {
+        for (const auto &entry : voltageMap) {
+            if (static_cast<uint8_t>(entry.second) == voltageRegisterValue) {
+                return entry.first;
+            }
+        }
+        return 0.0f;
+    };
+
+    switch (context) {
+        case CONTEXT_LDO2:
+            return findVoltage(ldo2VoltageMap);
+        case CONTEXT_SW1:
+            return findVoltage(sw1VoltageMap);
+        case CONTEXT_SW2:
+            return findVoltage(sw2VoltageMap);
+        default:
+            return 0.0f;
+    }
+}
+
 void Board::shutDownFuelGauge() {
-    #if defined(ARDUINO_PORTENTA_C33)
-        MAX1726Driver fuelGauge(&Wire3);
-    #elif defined(ARDUINO_PORTENTA_H7_M7) || defined(ARDUINO_GENERIC_STM32H747_M4)
-        MAX1726Driver fuelGauge(&Wire1);
-    #elif defined(ARDUINO_NICLA_VISION)
-        MAX1726Driver fuelGauge(&Wire1);
-    #else
-        #error "The selected board is not supported by the Battery class."
-    #endif
+    MAX1726Driver fuelGauge(CurrentBoardTraits::fuelGaugeWire());
     fuelGauge.setOperationMode(FuelGaugeOperationMode::shutdown);
 }
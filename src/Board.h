@@ -4,10 +4,7 @@
 #include <Arduino.h>
 #include <Arduino_PF1550.h>
 #include "WireUtils.h"
-
-#if defined(ARDUINO_PORTENTA_H7_M7) || defined(ARDUINO_GENERIC_STM32H747_M4)
-#define ARDUINO_PORTENTA_H7
-#endif
+#include "BoardTraits.h"
 
 #if defined(ARDUINO_PORTENTA_C33) 
     #include "Arduino_LowPowerPortentaC33.h"
@@ -38,6 +35,85 @@ inline constexpr StandbyType operator|=(StandbyType& x, StandbyType y){
     return x = x | y;
 }
 
+/**
+ * @brief The switchable power rails of the PF1550 PMIC.
+ * What each rail powers depends on the board, e.g. SW2 is the external 3V3 rail on all boards, 
+ * SW1 powers the communication peripherals on the Portenta C33 and LDO1-LDO3 power the camera on the Nicla Vision.
+ */
+enum class PowerRail : uint8_t {
+    sw1 = 0,
+    sw2 = 1,
+    ldo1 = 2,
+    ldo2 = 3,
+    ldo3 = 4
+};
+
+constexpr uint8_t POWER_RAIL_COUNT = 5;
+
+/**
+ * @brief The desired state of a power rail within a power mode.
+ */
+enum class RailState : uint8_t {
+    unchanged = 0,
+    on = 1,
+    off = 2
+};
+
+/**
+ * @brief The desired state and voltage of a single power rail within a power mode.
+ */
+struct RailSetting {
+    /// @brief Whether the rail should be on, off or left as it is.
+    RailState state = RailState::unchanged;
+
+    /// @brief The voltage in volts (V) the rail should be set to, 0 leaves the voltage unchanged.
+    /// Only SW1, SW2 and LDO2 support changing the voltage. See setExternalVoltage() and setReferenceVoltage() for the supported values.
+    float voltage = 0.0f;
+};
+
+/**
+ * @brief A named set of desired power rail states and voltages.
+ * Power modes are declared once and applied with Board::setPowerMode(), e.g.
+ * constexpr PowerMode sensing = PowerMode("Sensing").withRail(PowerRail::sw1, false).withRail(PowerRail::sw2, true, 3.3f);
+ */
+struct PowerMode {
+    /// @brief The name of the power mode, used for reporting.
+    const char *name = nullptr;
+
+    /// @brief The settings for each rail, indexed by PowerRail.
+    RailSetting rails[POWER_RAIL_COUNT] = {};
+
+    constexpr PowerMode(const char *name = nullptr) : name(name) {}
+
+    /**
+     * @brief Returns a copy of this power mode with the given rail setting.
+     * @param rail The power rail to configure.
+     * @param on True if the rail should be on, false if it should be off.
+     * @param voltage The voltage of the rail in volts (V), 0 leaves the voltage unchanged.
+     * @return The modified power mode.
+     */
+    constexpr PowerMode withRail(PowerRail rail, bool on, float voltage = 0.0f) const {
+        PowerMode mode = *this;
+        mode.rails[static_cast<uint8_t>(rail)].state = on ? RailState::on : RailState::off;
+        mode.rails[static_cast<uint8_t>(rail)].voltage = voltage;
+        return mode;
+    }
+};
+
+/**
+ * @brief Reports what it took to switch to a power mode.
+ */
+struct PowerModeTransition {
+    /// @brief The number of rails that were switched on or off.
+    uint8_t railWrites = 0;
+
+    /// @brief The number of voltage registers that were written.
+    uint8_t voltageWrites = 0;
+
+    /// @brief The time the transition took in microseconds (µs).
+    uint32_t duration = 0;
+};
+
 /**
  * @brief Represents a board with power management capabilities.
  * 
@@ -102,6 +178,14 @@ class Board {
         */
         void setCameraPowerEnabled(bool enabled); 
 
+        /**
+         * @brief Enables/disables a single power rail of the PMIC.
+         * This is a plain switch, if several drivers share a rail use the PowerDomain class instead.
+         * @param rail The power rail to switch.
+         * @param on True to enable the power rail, false to disable it.
+        */
+        void setRailEnabled(PowerRail rail, bool on);
+
 
         #if defined(ARDUINO_PORTENTA_H7)
 
@@ -191,6 +275,7 @@ class Board {
 
         /**
          * @brief Toggle the peripherals' power on Portenta C33 (ADC, RGB LED, Secure Element, Wifi and Bluetooth).
+         * On the Portenta H7 this toggles LDO1-LDO3 and SW1, on the Nicla Vision the camera rails and the external power rail.
          * @param on True to turn on the power, false to turn it off.
         */
         void setAllPeripheralsPower(bool on);
@@ -217,6 +302,34 @@ class Board {
         */
         bool setReferenceVoltage(float voltage);
 
+        /**
+         * @brief Switches the power rails to the states and voltages of a power mode.
+         * Only the rails and voltages that differ from the last known state are written to the PMIC.
+         * Rails are turned off first, then voltages are changed while the affected rails are off
+         * and finally rails are turned on in power-up order (LDO2, LDO1, LDO3, SW1, SW2).
+         * A voltage change on a rail whose state is unchanged is written without toggling the rail.
+         * On the Portenta H7 use setAllPeripheralsPower(false) before going to standby, as it also turns off Ethernet safely.
+         * @param mode The power mode to apply.
+         * @param transition Optional pointer that receives the number of writes and the duration of the transition.
+         * @return True if the power mode was applied, false if it contains an unsupported voltage (nothing is written in that case)
+         * or a voltage couldn't be verified after writing it (the affected rail is left off in that case).
+        */
+        bool setPowerMode(const PowerMode &mode, PowerModeTransition *transition = nullptr);
+
+        /**
+         * @brief Forgets the known state of all power rails so the next call to setPowerMode() writes every rail it configures.
+         * Call this if the PMIC was configured outside of this class.
+        */
+        void invalidateRailStates();
+
+        /**
+         * @brief Returns the last known state of the power rails as a power mode.
+         * Only rails switched by this class have a known state. Rails whose state is unknown are RailState::unchanged
+         * and voltages that are unknown or can't be changed are 0.
+         * @return The known rail states and voltages.
+        */
+        PowerMode knownPowerMode();
+
         /**
          * @brief Shuts down the fuel gauge to reduce power consumption.
          * The IC returns to active mode on any edge of any communication line.
@@ -226,19 +339,51 @@ class Board {
         void shutDownFuelGauge();
 
     private:
+        friend class PowerManagement;
+        friend class SleepTracker;
+
+        /**
+        * Performs the board specific setup that doesn't involve the PMIC.
+        * On the Portenta H7 this prepares the option bytes for standby and boots the M4 core.
+        */
+        void prepareCores();
+
         /**
         * Convert a numeric voltage value to the corresponding enum value for the PMIC library.
         */
         static uint8_t getRailVoltageEnum(float voltage, int context);
 
+        /**
+        * Convert a voltage register value back to the voltage in volts, 0 if the value is unknown.
+        */
+        static float getRailVoltage(uint8_t voltageRegisterValue, int context);
+
+        /**
+        * Writes the voltage register of a power rail and reads it back.
+        * The known voltage is only updated if the read-back matches, otherwise it becomes unknown.
+        * @return True if the voltage was verified, false otherwise.
+        */
+        bool writeRailVoltage(PowerRail rail, uint8_t voltageRegisterValue);
+
+        /**
+        * Turns off the Ethernet PHY before its rails are turned off. Only the Portenta H7 has one.
+        * @return True if Ethernet was turned off or there is none, false otherwise.
+        */
+        static bool turnOffEthernet();
+
+        // Last known state of the power rails, used to skip redundant PMIC writes
+        uint8_t knownRails = 0; // Bit mask of the rails whose on/off state is known
+        uint8_t enabledRails = 0; // Bit mask of the rails that are known to be on
+        uint8_t railVoltages[POWER_RAIL_COUNT] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF}; // 0xFF if unknown
+
         #if defined(ARDUINO_PORTENTA_C33)
             LowPower * lowPower;
         #endif         
         
         StandbyType standbyType = StandbyType::none;
-        uint32_t wakeupDelayHours;
-        uint32_t wakeupDelayMinutes;
-        uint32_t wakeupDelaySeconds;
+        uint32_t wakeupDelayHours = 0;
+        uint32_t wakeupDelayMinutes = 0;
+        uint32_t wakeupDelaySeconds = 0;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,20 @@
+#include "BoardTraits.h"
+
+// The Wire instances only exist on their respective cores, so only the accessor of the selected board is defined.
+#if defined(ARDUINO_POWER_MANAGEMENT_HOST_SIM)
+TwoWire *BoardTraits<HostSim>::fuelGaugeWire() {
+    return &Wire;
+}
+#elif defined(ARDUINO_PORTENTA_C33)
+TwoWire *BoardTraits<PortentaC33>::fuelGaugeWire() {
+    return &Wire3;
+}
+#elif defined(ARDUINO_PORTENTA_H7)
+TwoWire *BoardTraits<PortentaH7>::fuelGaugeWire() {
+    return &Wire1;
+}
+#elif defined(ARDUINO_NICLA_VISION)
+TwoWire *BoardTraits<NiclaVision>::fuelGaugeWire() {
+    return &Wire1;
+}
+#endif
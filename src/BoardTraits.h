@@ -0,0 +1,147 @@
+#ifndef BOARD_TRAITS_H
+#define BOARD_TRAITS_H
+
+#include "Arduino.h"
+#include "Wire.h"
+
+#if defined(ARDUINO_PORTENTA_H7_M7) || defined(ARDUINO_GENERIC_STM32H747_M4)
+#define ARDUINO_PORTENTA_H7
+#endif
+
+/// @brief Tag type for the Arduino Portenta C33.
+struct PortentaC33 {};
+
+/// @brief Tag type for the Arduino Portenta H7 (M7 and M4 core).
+struct PortentaH7 {};
+
+/// @brief Tag type for the Arduino Nicla Vision.
+struct NiclaVision {};
+
+/// @brief Tag type for host builds (e.g. Linux) against a simulated PMIC and fuel gauge.
+/// Selected by defining ARDUINO_POWER_MANAGEMENT_HOST_SIM, as the build in extras/test does. All capabilities are enabled so every code path can be exercised.
+struct HostSim {};
+
+/**
+ * @brief Compile-time description of the power management capabilities of a board.
+ * Each supported board has a specialisation. Code that depends on a capability checks it with a
+ * plain `if` on the constant, so the compiler drops the unsupported path.
+ * @tparam BoardType One of the board tag types.
+ */
+template <typename BoardType>
+struct BoardTraits;
+
+template <>
+struct BoardTraits<PortentaC33> {
+    static constexpr const char *name = "Portenta C33";
+
+    /// @brief SW1 powers the WiFi/Bluetooth module and the secure element and can be switched independently.
+    static constexpr bool hasCommunicationRail = true;
+
+    /// @brief LDO1 powers the analog digital converter and can be switched independently.
+    static constexpr bool hasAnalogDigitalConverterRail = true;
+
+    /// @brief LDO1-LDO3 power a built-in camera.
+    static constexpr bool hasCameraRails = false;
+
+    /// @brief LDO1-LDO3 and SW1 are switched together by Board::setAllPeripheralsPower(), e.g. because they power
+    /// interdependent chips (USB-C PHY, Ethernet, video bridge on the Portenta H7).
+    static constexpr bool hasSharedPeripheralRails = false;
+
+    /// @brief The fast charge current can be configured.
+    static constexpr bool supportsChargeCurrent = true;
+
+    /// @brief The end-of-charge current can be configured.
+    static constexpr bool supportsEndOfChargeCurrent = true;
+
+    /// @brief The board can sleep and resume without a reset (Board::sleepUntilWakeupEvent()).
+    static constexpr bool supportsSleep = true;
+
+    /// @brief The board can go to standby (Board::standByUntilWakeupEvent()).
+    static constexpr bool supportsStandby = true;
+
+    /// @brief Typical current in mA when running without power optimisations.
+    static constexpr float activeCurrent = 41.37f;
+
+    /// @brief Typical current in mA in sleep mode with the peripherals off.
+    static constexpr float sleepCurrent = 7.02f;
+
+    /// @brief Typical current in mA in standby mode with the peripherals off.
+    static constexpr float standbyCurrent = 0.059f;
+
+    /// @brief The index of the I2C bus the fuel gauge is connected to.
+    static constexpr uint8_t fuelGaugeBus = 3;
+
+    /// @brief Returns the I2C bus the fuel gauge is connected to.
+    static TwoWire *fuelGaugeWire();
+};
+
+template <>
+struct BoardTraits<PortentaH7> {
+    static constexpr const char *name = "Portenta H7";
+    static constexpr bool hasCommunicationRail = false;
+    static constexpr bool hasAnalogDigitalConverterRail = false;
+    static constexpr bool hasCameraRails = false;
+    static constexpr bool hasSharedPeripheralRails = true;
+    static constexpr bool supportsChargeCurrent = true;
+    static constexpr bool supportsEndOfChargeCurrent = true;
+    static constexpr bool supportsSleep = false; // Sleep is handled automatically by mbed when idle
+    static constexpr bool supportsStandby = true;
+    static constexpr float activeCurrent = 123.86f;
+    static constexpr float sleepCurrent = 0.0f;
+    static constexpr float standbyCurrent = 0.379f;
+    static constexpr uint8_t fuelGaugeBus = 1;
+    static TwoWire *fuelGaugeWire();
+};
+
+template <>
+struct BoardTraits<NiclaVision> {
+    static constexpr const char *name = "Nicla Vision";
+    static constexpr bool hasCommunicationRail = false;
+    static constexpr bool hasAnalogDigitalConverterRail = false;
+    static constexpr bool hasCameraRails = true;
+    static constexpr bool hasSharedPeripheralRails = true;
+    static constexpr bool supportsChargeCurrent = false;
+    static constexpr bool supportsEndOfChargeCurrent = false;
+    static constexpr bool supportsSleep = false;
+    static constexpr bool supportsStandby = false;
+    static constexpr float activeCurrent = 0.0f; // Not characterised
+    static constexpr float sleepCurrent = 0.0f;
+    static constexpr float standbyCurrent = 0.0f;
+    static constexpr uint8_t fuelGaugeBus = 1;
+    static TwoWire *fuelGaugeWire();
+};
+
+template <>
+struct BoardTraits<HostSim> {
+    static constexpr const char *name = "Host simulation";
+    static constexpr bool hasCommunicationRail = true;
+    static constexpr bool hasAnalogDigitalConverterRail = true;
+    static constexpr bool hasCameraRails = true;
+    static constexpr bool hasSharedPeripheralRails = false;
+    static constexpr bool supportsChargeCurrent = true;
+    static constexpr bool supportsEndOfChargeCurrent = true;
+    static constexpr bool supportsSleep = true;
+    static constexpr bool supportsStandby = true;
+    static constexpr float activeCurrent = 40.0f;
+    static constexpr float sleepCurrent = 7.0f;
+    static constexpr float standbyCurrent = 0.06f;
+    static constexpr uint8_t fuelGaugeBus = 0;
+    static TwoWire *fuelGaugeWire();
+};
+
+#if defined(ARDUINO_POWER_MANAGEMENT_HOST_SIM)
+    using CurrentBoard = HostSim;
+#elif defined(ARDUINO_PORTENTA_C33)
+    using CurrentBoard = PortentaC33;
+#elif defined(ARDUINO_PORTENTA_H7)
+    using CurrentBoard = PortentaH7;
+#elif defined(ARDUINO_NICLA_VISION)
+    using CurrentBoard = NiclaVision;
+#else
+    #error "The selected board is not supported by the Arduino_PowerManagement library."
+#endif
+
+/// @brief The traits of the board the sketch is compiled for.
+using CurrentBoardTraits = BoardTraits<CurrentBoard>;
+
+#endif
@@ -0,0 +1,195 @@
+#include "ChargeSessionRecorder.h"
+#include "EnergyProbe.h"
+
+/**
+ * Maps a charging state to its slot in ChargeSession::residencies, -1 if it doesn't belong to a session.
+ */
+static int8_t residencyIndex(ChargingState state) {
+    switch (state) {
+        case ChargingState::preCharge:
+            return 0;
+        case ChargingState::fastChargeConstantCurrent:
+            return 1;
+        case ChargingState::fastChargeConstantVoltage:
+            return 2;
+        case ChargingState::endOfCharge:
+            return 3;
+        case ChargingState::done:
+            return 4;
+        case ChargingState::timerFaultError:
+            return 5;
+        case ChargingState::thermistorSuspendError:
+            return 6;
+        case ChargingState::batteryOvervoltageError:
+            return 7;
+        default:
+            return -1;
+    }
+}
+
+/**
+ * Checks if a state starts a session, as opposed to the states a session only passes through.
+ */
+static bool startsSession(ChargingState state) {
+    return state == ChargingState::preCharge
+        || state == ChargingState::fastChargeConstantCurrent
+        || state == ChargingState::fastChargeConstantVoltage;
+}
+
+/**
+ * Checks if a state is one of the charger faults.
+ */
+static bool isFault(ChargingState state) {
+    return state == ChargingState::timerFaultError
+        || state == ChargingState::thermistorSuspendError
+        || state == ChargingState::batteryOvervoltageError;
+}
+
+uint32_t ChargeSession::residency(ChargingState state) const {
+    int8_t index = residencyIndex(state);
+    return index >= 0 ? residencies[index] : 0;
+}
+
+bool ChargeSession::hadFault(ChargingState state) const {
+    return isFault(state) && bitRead(faults, static_cast<uint8_t>(state));
+}
+
+ChargeSessionRecorderBase::ChargeSessionRecorderBase(Charger &charger, Battery &battery, ChargeSession *sessions, uint16_t capacity)
+    : charger(&charger), battery(&battery), sessions(sessions), capacity(capacity) {
+}
+
+void ChargeSessionRecorderBase::update(uint32_t now) {
+    update(now, charger->getState());
+}
+
+void ChargeSessionRecorderBase::update(uint32_t now, ChargingState state) {
+    if (!charging) {
+        lastState = state;
+        lastTime = now;
+        if (startsSession(state)) {
+            startSession(now);
+        }
+        return;
+    }
+
+    // The previous state lasted until now
+    int8_t index = residencyIndex(lastState);
+    if (index >= 0) {
+        running.residencies[index] += now - lastTime;
+    }
+    running.endTime = now;
+
+    if (state != lastState && isFault(state)) {
+        bitSet(running.faults, static_cast<uint8_t>(state));
+        if (running.faultCount < UINT8_MAX) {
+            ++running.faultCount;
+        }
+    }
+    if (running.timeToFull == 0 && (state == ChargingState::endOfCharge || state == ChargingState::done)) {
+        running.timeToFull = max(now - running.startTime, static_cast<uint32_t>(1));
+    }
+
+    lastState = state;
+    lastTime = now;
+    if (residencyIndex(state) < 0) {
+        endSession(now);
+    }
+}
+
+bool ChargeSessionRecorderBase::isCharging() {
+    return charging;
+}
+
+bool ChargeSessionRecorderBase::currentSession(ChargeSession &session) {
+    if (!charging) {
+        return false;
+    }
+    session = running;
+    return true;
+}
+
+uint16_t ChargeSessionRecorderBase::count() {
+    return sessionCount;
+}
+
+bool ChargeSessionRecorderBase::session(uint16_t age, ChargeSession &session) {
+    if (age >= sessionCount) {
+        return false;
+    }
+    session = sessions[(next + capacity - 1 - age) % capacity];
+    return true;
+}
+
+void ChargeSessionRecorderBase::onSessionEnd(void (*callback)(const ChargeSession &session)) {
+    sessionEndCallback = callback;
+}
+
+void ChargeSessionRecorderBase::exportCsv(Print &output) {
+    output.println("start (s), duration (s), time to full (s), start SoC (%), end SoC (%), charge (mAh), faults, "
+                   "pre-charge (s), constant current (s), constant voltage (s), end of charge (s), done (s), "
+                   "timer fault (s), thermistor suspend (s), overvoltage (s)");
+
+    for (uint16_t age = sessionCount; age > 0; --age) {
+        ChargeSession entry;
+        session(age - 1, entry);
+        output.print(entry.startTime);
+        output.print(", ");
+        output.print(entry.duration());
+        output.print(", ");
+        output.print(entry.timeToFull);
+        output.print(", ");
+        output.print(entry.startPercentage);
+        output.print(", ");
+        output.print(entry.endPercentage);
+        output.print(", ");
+        output.print(entry.chargeDelivered, 1);
+        output.print(", ");
+        output.print(entry.faultCount);
+        for (uint8_t index = 0; index < CHARGE_RESIDENCY_STATES; ++index) {
+            output.print(", ");
+            output.print(entry.residencies[index]);
+        }
+        output.println();
+    }
+}
+
+void ChargeSessionRecorderBase::reset() {
+    next = 0;
+    sessionCount = 0;
+    charging = false;
+    lastState = ChargingState::none;
+}
+
+void ChargeSessionRecorderBase::startSession(uint32_t now) {
+    // percentage() returns -1 without a battery, the session starts once one is detected
+    uint8_t percentage = battery->percentage();
+    if (percentage == static_cast<uint8_t>(-1)) {
+        return;
+    }
+
+    running = ChargeSession();
+    running.startTime = now;
+    running.endTime = now;
+    running.startPercentage = percentage;
+    startCharge = battery->coulombCounter();
+    charging = true;
+}
+
+void ChargeSessionRecorderBase::endSession(uint32_t now) {
+    running.endTime = now;
+    uint8_t percentage = battery->percentage();
+    running.endPercentage = percentage != static_cast<uint8_t>(-1) ? percentage : 0;
+    // The measurement counts discharging as positive
+    running.chargeDelivered = -EnergyProbe::between(startCharge, battery->coulombCounter()).charge;
+    charging = false;
+
+    sessions[next] = running;
+    next = (next + 1) % capacity;
+    if (sessionCount < capacity) {
+        ++sessionCount;
+    }
+
+    if (sessionEndCallback != nullptr) {
+        sessionEndCallback(running);
+    }
+}
@@ -0,0 +1,203 @@
+#ifndef CHARGE_SESSION_RECORDER_H
+#define CHARGE_SESSION_RECORDER_H
+
+#include "Arduino.h"
+#include "Battery.h"
+#include "Charger.h"
+
+constexpr uint8_t CHARGE_RESIDENCY_STATES = 8; // The charging states that belong to a session, see ChargeSession::residency()
+
+/**
+ * @brief The record of one charge session, from the start of charging until the power source
+ * was removed or the charger was disabled.
+ */
+struct ChargeSession {
+    /// @brief The start of the session in seconds.
+    uint32_t startTime = 0;
+
+    /// @brief The end of the session in seconds, or the time of the last update while it's still running.
+    uint32_t endTime = 0;
+
+    /// @brief The seconds from the start until the charger reached endOfCharge or done, 0 if it didn't.
+    uint32_t timeToFull = 0;
+
+    /// @brief The state of charge at the start in percent.
+    uint8_t startPercentage = 0;
+
+    /// @brief The state of charge at the end in percent, 0 if the battery was disconnected when the session ended.
+    uint8_t endPercentage = 0;
+
+    /// @brief The charge that went into the battery in milliampere-hours (mAh), from the coulomb counter of the fuel gauge.
+    float chargeDelivered = 0.0f;
+
+    /// @brief The number of times the charger entered timerFaultError, thermistorSuspendError or batteryOvervoltageError.
+    uint8_t faultCount = 0;
+
+    /// @brief Bit mask of the fault states that occurred, indexed by the value of ChargingState.
+    uint16_t faults = 0;
+
+    /// @brief The seconds spent in each charging state, see residency().
+    uint32_t residencies[CHARGE_RESIDENCY_STATES] = {};
+
+    /**
+     * @brief Returns the time spent in a charging state during the session.
+     * @param state The charging state.
+     * @return The time in seconds, 0 for states that don't belong to a session, e.g. chargerDisabled.
+     */
+    uint32_t residency(ChargingState state) const;
+
+    /**
+     * @brief Checks if a fault state occurred during the session.
+     * @param state The fault state, e.g. ChargingState::thermistorSuspendError.
+     * @return True if the state occurred, false otherwise.
+     */
+    bool hadFault(ChargingState state) const;
+
+    /**
+     * @brief Returns the length of the session.
+     * @return The duration in seconds.
+     */
+    uint32_t duration() const {
+        return endTime - startTime;
+    }
+};
+
+/**
+ * @brief Records each charge session with its duration, state of charge, delivered charge,
+ * the time spent in each charging state and its faults.
+ *
+ * A session starts when the charger enters pre-charge or fast charge and ends when it leaves
+ * the charging states, e.g. because the power source was removed or the charger was disabled.
+ * The top-off in endOfCharge and done belongs to the session, timeToFull tells when it started.
+ * Finished sessions are kept in a ring of fixed size, the oldest one is overwritten when it's full.
+ *
+ * The size of the ring is set by ChargeSessionRecorder, this class holds the logic that is shared by all sizes.
+ */
+class ChargeSessionRecorderBase {
+    public:
+        /**
+         * @brief Reads the charging state and records it.
+         * Call this regularly, the residencies are measured in steps of the update interval.
+         * @param now The current time in seconds, e.g. the Unix time from the RTC. It must not go backwards.
+         */
+        void update(uint32_t now);
+
+        /**
+         * @brief Records a charging state without reading it from the PMIC, e.g. from the callback
+         * set with Charger::onStateChange() or with Charger::lastState().
+         * The time since the last update is counted for the previous state, the given state is counted from now on.
+         * @param now The current time in seconds.
+         * @param state The charging state as of now.
+         */
+        void update(uint32_t now, ChargingState state);
+
+        /**
+         * @brief Checks if a session is running.
+         * @return True while charging, false otherwise.
+         */
+        bool isCharging();
+
+        /**
+         * @brief Returns the session that is running, as of the last update.
+         * Its end percentage and delivered charge are only set when it ends.
+         * @param session Receives the session.
+         * @return True if a session is running, false otherwise.
+         */
+        bool currentSession(ChargeSession &session);
+
+        /**
+         * @brief Returns the number of finished sessions that are kept.
+         * @return The number of sessions.
+         */
+        uint16_t count();
+
+        /**
+         * @brief Reads a finished session.
+         * @param age 0 for the most recent session, count() - 1 for the oldest one.
+         * @param session Receives the session.
+         * @return True if the session exists, false otherwise.
+         */
+        bool session(uint16_t age, ChargeSession &session);
+
+        /**
+         * @brief Sets a function that is called whenever a session ends, e.g. to store it persistently.
+         * @param callback The function, or nullptr to remove it.
+         */
+        void onSessionEnd(void (*callback)(const ChargeSession &session));
+
+        /**
+         * @brief Writes the finished sessions as CSV, the oldest first, e.g. to the serial port or a file.
+         * Durations are in seconds.
+         * @param output The output.
+         */
+        void exportCsv(Print &output);
+
+        /**
+         * @brief Discards all sessions, including the one that is running.
+         */
+        void reset();
+
+    protected:
+        /**
+         * Sets the charger and battery to read and the storage of the ring.
+         */
+        ChargeSessionRecorderBase(Charger &charger, Battery &battery, ChargeSession *sessions, uint16_t capacity);
+
+    private:
+        /**
+         * Starts a session and takes the snapshots of the battery, unless no battery is connected.
+         */
+        void startSession(uint32_t now);
+
+        /**
+         * Finishes the running session and pushes it to the ring.
+         */
+        void endSession(uint32_t now);
+
+        Charger *charger;
+        Battery *battery;
+        ChargeSession *sessions;
+        uint16_t capacity;
+        uint16_t next = 0;
+        uint16_t sessionCount = 0;
+
+        bool charging = false;
+        ChargeSession running;
+        CoulombCounterSnapshot startCharge;
+        ChargingState lastState = ChargingState::none;
+        uint32_t lastTime = 0;
+        void (*sessionEndCallback)(const ChargeSession &session) = nullptr;
+};
+
+/**
+ * @brief A ChargeSessionRecorder that keeps the given number of finished sessions.
+ *
+ *     ChargeSessionRecorder<16> recorder(charger, battery);
+ *
+ *     void loop() {
+ *         recorder.update(rtcTime);
+ *         ...
+ *         recorder.exportCsv(Serial);
+ *     }
+ */
+template <uint16_t Capacity = 8>
+class ChargeSessionRecorder : public ChargeSessionRecorderBase {
+    public:
+        /**
+         * @brief Constructs a new ChargeSessionRecorder object.
+         * @param charger The charger whose state is recorded.
+         * @param battery The battery whose state of charge and coulomb counter are recorded.
+         */
+        ChargeSessionRecorder(Charger &charger, Battery &battery) : ChargeSessionRecorderBase(charger, battery, slots, Capacity) {
+        }
+
+        // The ring points into this object
+        ChargeSessionRecorder(const ChargeSessionRecorder &) = delete;
+        ChargeSessionRecorder &operator=(const ChargeSessionRecorder &) = delete;
+
+    private:
+        static_assert(Capacity > 0, "The recorder needs room for at least one session");
+        ChargeSession slots[Capacity];
+};
+
+#endif
@@ -1,4 +1,5 @@
 #include "Charger.h"
+#include "BoardTraits.h"
 #include <map>
 
 std::map<uint16_t, ChargeCurrent> chargeCurrentMap = {
@@ -114,9 +115,9 @@ bool Charger::begin(){
 }
 
 bool Charger::setChargeCurrent(uint16_t current) {
-    #if defined(ARDUINO_NICLA_VISION)
+    if (!CurrentBoardTraits::supportsChargeCurrent) {
         return false; // Not supported on Nicla Vision
-    #endif
+    }
 
     if (chargeCurrentMap.find(current) != chargeCurrentMap.end()) {
         ChargeCurrent convertedCurrent = chargeCurrentMap[current];
@@ -162,9 +163,10 @@ bool Charger::setChargeVoltage(float voltage) {
 }
 
 bool Charger::setEndOfChargeCurrent(uint16_t current) {
-    #if defined(ARDUINO_NICLA_VISION)
+    if (!CurrentBoardTraits::supportsEndOfChargeCurrent) {
         return false; // Not supported on Nicla Vision
-    #endif
+    }
+
     if(endOfChargeCurrentMap.find(current) != endOfChargeCurrentMap.end()) {
         EndOfChargeCurrent convertedCurrent = endOfChargeCurrentMap[current];
         PMIC.getControl() -> setEndOfChargeCurrent(convertedCurrent);
@@ -194,6 +196,16 @@ bool Charger::setInputCurrentLimit(uint16_t current) {
     return false;
 }
 
+uint16_t Charger::higherInputCurrentLimit(uint16_t current) {
+    auto higher = inputCurrentLimitMap.upper_bound(current);
+    return higher != inputCurrentLimitMap.end() ? higher->first : 0;
+}
+
+uint16_t Charger::lowerInputCurrentLimit(uint16_t current) {
+    auto lower = inputCurrentLimitMap.lower_bound(current);
+    return lower != inputCurrentLimitMap.begin() ? (--lower)->first : 0;
+}
+
 uint16_t Charger::getInputCurrentLimit() {
     uint8_t currentValue = PMIC.readPMICreg(Register::CHARGER_VBUS_INLIM_CNFG);
     currentValue = (currentValue & REG_VBUS_INLIM_CNFG_VBUS_LIN_INLIM_mask);
@@ -247,3 +259,88 @@ ChargingState Charger::getState(){
             return ChargingState::none;
     }
 }
+
+// Sources that keep firing faster than they can be cleared are left to the next call of update()
+constexpr uint8_t MAX_INTERRUPT_CLEAR_ATTEMPTS = 4;
+
+bool Charger::enableInterrupts(uint8_t sources){
+    // Discard events from before, the state is read below
+    PMIC.writePMICreg(Register::CHARGER_CHG_INT, PMIC.readPMICreg(Register::CHARGER_CHG_INT));
+    interruptPending = false;
+    trackedState = getState();
+
+    // A set mask bit disables the interrupt source
+    uint8_t mask = ~sources;
+    PMIC.writePMICreg(Register::CHARGER_CHG_INT_MASK, mask);
+    return PMIC.readPMICreg(Register::CHARGER_CHG_INT_MASK) == mask;
+}
+
+void Charger::disableInterrupts(){
+    PMIC.writePMICreg(Register::CHARGER_CHG_INT_MASK, 0xFF);
+    interruptPending = false;
+}
+
+// The charger whose handleInterrupt() is called from the interrupt of the pin set with attachInterruptPin()
+static Charger *interruptPinCharger = nullptr;
+
+static void onInterruptPinFalling(){
+    if(interruptPinCharger != nullptr){
+        interruptPinCharger->handleInterrupt();
+    }
+}
+
+void Charger::attachInterruptPin(pin_size_t pin){
+    interruptPin = pin;
+    interruptPinCharger = this;
+    pinMode(pin, INPUT_PULLUP); // INTB is an open-drain output
+    attachInterrupt(digitalPinToInterrupt(pin), onInterruptPinFalling, FALLING);
+}
+
+void Charger::handleInterrupt(){
+    interruptTime = millis();
+    interruptPending = true;
+}
+
+bool Charger::update(){
+    if(!interruptPending){
+        return false;
+    }
+    // Clear the flag before reading, so an interrupt that arrives meanwhile is serviced by the next call
+    interruptPending = false;
+    uint32_t time = interruptTime;
+
+    // The flags are cleared by writing ones. A source raised after reading them keeps the interrupt pin low
+    // without a new falling edge, so read them again until all are cleared and the pin is released.
+    interruptFlags = 0;
+    uint8_t flags = PMIC.readPMICreg(Register::CHARGER_CHG_INT);
+    for(uint8_t attempt = 0; flags != 0 && attempt < MAX_INTERRUPT_CLEAR_ATTEMPTS; ++attempt){
+        interruptFlags |= flags;
+        PMIC.writePMICreg(Register::CHARGER_CHG_INT, flags);
+        flags = PMIC.readPMICreg(Register::CHARGER_CHG_INT);
+    }
+    if(flags != 0 || (interruptPin >= 0 && digitalRead(interruptPin) == LOW)){
+        interruptPending = true; // Still asserted, service it with the next call
+    }
+
+    ChargingState state = getState();
+    if(state != trackedState){
+        ChargingState previous = trackedState;
+        trackedState = state;
+        if(stateChangeCallback != nullptr){
+            stateChangeCallback(previous, state, time);
+        }
+    }
+    return true;
+}
+
+void Charger::onStateChange(void (*callback)(ChargingState previous, ChargingState current, uint32_t time)){
+    stateChangeCallback = callback;
+}
+
+ChargingState Charger::lastState(){
+    return trackedState;
+}
+
+uint8_t Charger::lastInterrupts(){
+    return interruptFlags;
+}
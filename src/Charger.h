@@ -1,4 +1,5 @@
 #ifndef CHARGER_H
+#define CHARGER_H
 
 #include <Arduino_PF1550.h>
 #include "WireUtils.h"
@@ -69,6 +70,21 @@ enum class ChargingState {
     chargerBypassed = 12
 };
 
+/**
+ * Bits of the PF1550 CHG_INT, CHG_INT_MASK and CHG_INT_OK registers.
+ */
+constexpr uint8_t CHARGER_INTERRUPT_BATTERY = 1 << 2;     // The battery status changed
+constexpr uint8_t CHARGER_INTERRUPT_CHARGER = 1 << 3;     // The charger state changed
+constexpr uint8_t CHARGER_INTERRUPT_VBUS = 1 << 5;        // The input voltage appeared, disappeared or left its valid range
+constexpr uint8_t CHARGER_INTERRUPT_THERMISTOR = 1 << 7;  // The battery temperature entered or left a thermistor window
+constexpr uint8_t CHARGER_STATE_INTERRUPTS = CHARGER_INTERRUPT_BATTERY | CHARGER_INTERRUPT_CHARGER | CHARGER_INTERRUPT_VBUS | CHARGER_INTERRUPT_THERMISTOR;
+
+/**
+ * Bits of the PF1550 VBUS_SNS register.
+ */
+constexpr uint8_t CHARGER_VBUS_UVLO_BIT = 2;   // The input voltage is below the undervoltage lockout threshold
+constexpr uint8_t CHARGER_VBUS_VALID_BIT = 5;  // The input voltage is within its valid range
+
 /**
  * @brief Class for controlling charging parameters and monitoring charging status.
  */
@@ -155,6 +171,20 @@ public:
      */
     bool setInputCurrentLimit(uint16_t current);
 
+    /**
+     * @brief Finds the next supported input current limit above a value, see setInputCurrentLimit().
+     * @param current The value in milli amperes (mA).
+     * @return The smallest supported limit greater than the value, or 0 if there is none.
+     */
+    static uint16_t higherInputCurrentLimit(uint16_t current);
+
+    /**
+     * @brief Finds the next supported input current limit below a value, see setInputCurrentLimit().
+     * @param current The value in milli amperes (mA).
+     * @return The largest supported limit less than the value, or 0 if there is none.
+     */
+    static uint16_t lowerInputCurrentLimit(uint16_t current);
+
     /**
      * @brief Get the input current limit. It is a safeguard to prevent overcurrent when charging
      * respectively to the maximum current the power source can provide.
@@ -195,6 +225,76 @@ public:
      * @return true if the enabled state was successfully set, false otherwise.
      */
     bool setEnabled(bool enabled);
+
+    /**
+     * @brief Enables the charger interrupts of the PMIC, so that changes of the charging state
+     * can be handled as they happen instead of polling getState().
+     * The PMIC pulls its interrupt pin (INTB) low until the interrupt is serviced by update().
+     * Call attachInterruptPin() with the pin it is connected to, or attach a function to that pin
+     * which calls handleInterrupt().
+     * @param sources Bit mask of the interrupt sources, see CHARGER_STATE_INTERRUPTS.
+     * @return True if the interrupts were enabled, false if the PMIC communication failed.
+     */
+    bool enableInterrupts(uint8_t sources = CHARGER_STATE_INTERRUPTS);
+
+    /**
+     * @brief Masks all charger interrupts of the PMIC again.
+     */
+    void disableInterrupts();
+
+    /**
+     * @brief Calls handleInterrupt() when the PMIC pulls the given pin low.
+     * update() also checks the level of this pin, so an interrupt that the PMIC raised while
+     * the previous one was being serviced isn't missed.
+     * Only one charger can be attached at a time.
+     * @param pin The pin connected to the interrupt output (INTB) of the PMIC, see the schematics of the board.
+     */
+    void attachInterruptPin(pin_size_t pin);
+
+    /**
+     * @brief Notes that the PMIC raised an interrupt. Call this from the interrupt handler of the PMIC interrupt pin.
+     * It doesn't access the I2C bus, the interrupt is serviced by the next call to update().
+     */
+    void handleInterrupt();
+
+    /**
+     * @brief Services a pending interrupt: clears it in the PMIC, reads the charging state and
+     * calls the state change callback if the state changed. Call this from the loop.
+     * Sources that are raised while clearing are cleared as well, as the interrupt pin only
+     * goes high again once no source is left. If one is still left after a few attempts,
+     * the interrupt stays pending for the next call.
+     * It doesn't access the I2C bus if no interrupt is pending.
+     * @return True if an interrupt was serviced, false otherwise.
+     */
+    bool update();
+
+    /**
+     * @brief Sets a function that is called from update() whenever the charging state changed,
+     * e.g. when fast charging ends or charging is suspended because the battery is too hot.
+     * @param callback The function, called with the previous and the new state and the time of the interrupt
+     * in milliseconds (ms) as returned by millis(), or nullptr to remove it.
+     */
+    void onStateChange(void (*callback)(ChargingState previous, ChargingState current, uint32_t time));
+
+    /**
+     * @brief Returns the charging state as of the last serviced interrupt, without accessing the PMIC.
+     * @return The charging state, none before enableInterrupts() was called.
+     */
+    ChargingState lastState();
+
+    /**
+     * @brief Returns the interrupt sources that were cleared when the last interrupt was serviced.
+     * @return Bit mask of the interrupt sources, see CHARGER_STATE_INTERRUPTS.
+     */
+    uint8_t lastInterrupts();
+
+private:
+    volatile bool interruptPending = false;
+    int interruptPin = -1;
+    volatile uint32_t interruptTime = 0;
+    ChargingState trackedState = ChargingState::none;
+    uint8_t interruptFlags = 0;
+    void (*stateChangeCallback)(ChargingState previous, ChargingState current, uint32_t time) = nullptr;
 };
 
 #endif // CHARGER_H
\ No newline at end of file
@@ -0,0 +1,110 @@
+#include "EnergyBudgetGovernor.h"
+
+void EnergyBudgetGovernor::setDeadline(uint32_t deadline) {
+    this->deadline = deadline;
+}
+
+void EnergyBudgetGovernor::setReserveCapacity(float reserveCapacity) {
+    this->reserveCapacity = max(reserveCapacity, 0.0f);
+}
+
+void EnergyBudgetGovernor::setBasePower(float basePower) {
+    this->basePower = max(basePower, 0.0f);
+}
+
+void EnergyBudgetGovernor::setHistoryTimeConstant(uint32_t timeConstant) {
+    this->historyTimeConstant = max(timeConstant, static_cast<uint32_t>(1));
+}
+
+void EnergyBudgetGovernor::setMinimumDutyCycle(float minimumDutyCycle) {
+    this->minimumDutyCycle = constrain(minimumDutyCycle, 0.0f, 1.0f);
+}
+
+EnergyBudget EnergyBudgetGovernor::update(uint32_t now, float remainingCapacity, float averagePower, float voltage) {
+    result.replanned = false;
+    averagePower = max(averagePower, 0.0f); // No power is drawn while charging
+
+    if (hasPreviousUpdate && remainingCapacity > previousCapacity + DEFAULT_BUDGET_MINIMUM_CAPACITY_DROP) {
+        // The battery was charged, the consumption before doesn't say anything about the remaining capacity
+        hasHistory = false;
+        result.replanned = true;
+    }
+
+    if (!hasHistory) {
+        // Start over with the gauge's average power until the capacity has dropped enough to be measured
+        observedPower = averagePower;
+        observedDutyCycle = result.dutyCycle;
+        referenceTime = now;
+        referenceCapacity = remainingCapacity;
+        dutyCycleIntegral = 0.0f;
+        hasHistory = true;
+    } else {
+        dutyCycleIntegral += result.dutyCycle * (now - previousTime);
+
+        // The capacity drop covers sleep and standby as well, so it's preferred over the gauge's average power
+        float capacityDrop = referenceCapacity - remainingCapacity;
+        uint32_t dropDuration = now - referenceTime;
+        if (capacityDrop >= DEFAULT_BUDGET_MINIMUM_CAPACITY_DROP && dropDuration > 0) {
+            addObservation(capacityDrop * voltage * 3600.0f / dropDuration, dutyCycleIntegral / dropDuration, dropDuration);
+            referenceTime = now;
+            referenceCapacity = remainingCapacity;
+            dutyCycleIntegral = 0.0f;
+        }
+    }
+
+    hasPreviousUpdate = true;
+    previousTime = now;
+    previousCapacity = remainingCapacity;
+
+    // mAh * V = mWh, spread over the hours left until the deadline
+    float availableEnergy = max(remainingCapacity - reserveCapacity, 0.0f) * voltage;
+    uint32_t timeLeft = deadline > now ? deadline - now : 0;
+
+    result.observedPower = observedPower;
+    result.allowedPower = timeLeft > 0 ? availableEnergy * 3600.0f / timeLeft : 0.0f;
+    result.projectedLifetime = observedPower > 0.0f ? min(availableEnergy * 3600.0f / observedPower, static_cast<float>(UINT32_MAX)) : UINT32_MAX;
+    result.onTrack = result.projectedLifetime >= timeLeft * (1.0f - BUDGET_ON_TRACK_TOLERANCE);
+
+    // The power above the base power scales with the duty cycle
+    float activityPower = (observedPower - basePower) / max(observedDutyCycle, minimumDutyCycle);
+    result.fullActivityPower = basePower + max(activityPower, 0.0f);
+
+    if (activityPower <= 0.0f) {
+        result.dutyCycle = 1.0f;
+    } else {
+        result.dutyCycle = constrain((result.allowedPower - basePower) / activityPower, minimumDutyCycle, 1.0f);
+    }
+    return result;
+}
+
+EnergyBudget EnergyBudgetGovernor::update(uint32_t now, Battery &battery) {
+    // The fuel gauge reports the power drawn from the battery as a negative value
+    return update(now, battery.remainingCapacity(), -static_cast<float>(battery.averagePower()), battery.averageVoltage());
+}
+
+EnergyBudget EnergyBudgetGovernor::budget() {
+    return result;
+}
+
+void EnergyBudgetGovernor::reset() {
+    hasHistory = false;
+    hasPreviousUpdate = false;
+    result = EnergyBudget();
+}
+
+void EnergyBudgetGovernor::addObservation(float power, float dutyCycle, uint32_t duration) {
+    float modelActivityPower = (observedPower - basePower) / max(observedDutyCycle, minimumDutyCycle);
+    float observedActivityPower = (power - basePower) / max(dutyCycle, minimumDutyCycle);
+
+    // A large change means the load changed, so the history is replaced instead of blended
+    if (fabsf(observedActivityPower - modelActivityPower) > BUDGET_LOAD_CHANGE_RATIO * fabsf(modelActivityPower)) {
+        observedPower = power;
+        observedDutyCycle = dutyCycle;
+        result.replanned = true;
+        return;
+    }
+
+    float weight = 1.0f - expf(-static_cast<float>(duration) / historyTimeConstant);
+    observedPower += weight * (power - observedPower);
+    observedDutyCycle += weight * (dutyCycle - observedDutyCycle);
+}
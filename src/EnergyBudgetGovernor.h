@@ -0,0 +1,152 @@
+#ifndef ENERGY_BUDGET_GOVERNOR_H
+#define ENERGY_BUDGET_GOVERNOR_H
+
+#include "Arduino.h"
+#include "Battery.h"
+
+constexpr uint32_t DEFAULT_BUDGET_HISTORY_TIME_CONSTANT = 6UL * 3600; // s, how long the consumption history is remembered
+constexpr float DEFAULT_BUDGET_MINIMUM_CAPACITY_DROP = 2.0f; // mAh, capacity drop needed before it's used as a measurement
+constexpr float BUDGET_LOAD_CHANGE_RATIO = 0.5f; // Relative change of the activity power that counts as a load change
+constexpr float BUDGET_ON_TRACK_TOLERANCE = 0.05f; // Relative shortfall of the projected lifetime that still counts as on track
+constexpr float DEFAULT_BUDGET_MINIMUM_DUTY_CYCLE = 0.01f; // Lower limit of the duty cycle
+
+/**
+ * @brief The output of the EnergyBudgetGovernor after an update.
+ */
+struct EnergyBudget {
+    /// @brief The average power in milliwatts (mW) the application may use to reach the deadline.
+    float allowedPower = 0.0f;
+
+    /// @brief The average power in milliwatts (mW) the application used recently.
+    float observedPower = 0.0f;
+
+    /// @brief The estimated power in milliwatts (mW) the application would use at its full activity, including the base power.
+    float fullActivityPower = 0.0f;
+
+    /// @brief The fraction of its full activity (sampling and transmission rates) the application may run at, between the minimum duty cycle and 1.
+    /// E.g. with a duty cycle of 0.25 a measurement planned every minute should be taken every 4 minutes.
+    float dutyCycle = 1.0f;
+
+    /// @brief The time in seconds (s) the battery lasts at the observed power.
+    uint32_t projectedLifetime = 0;
+
+    /// @brief True if the battery lasts until the deadline at the observed power, within a tolerance of 5%.
+    bool onTrack = true;
+
+    /// @brief True if the history was discarded in this update because the battery was charged or the activity power changed.
+    bool replanned = false;
+};
+
+/**
+ * @brief Spreads the remaining battery energy over the time until a deadline.
+ *
+ * The governor is updated periodically with the remaining capacity and the average power. From the
+ * remaining energy and the time left until the deadline it computes the average power the application
+ * may use. It learns how much power the application uses at its full activity from the power observed
+ * at the duty cycles it handed out before, and returns the duty cycle that fits the allowed power.
+ * The application scales its activity by it, e.g. multiplies its measurement rate by dutyCycle.
+ *
+ * The observed power is taken from the drop of the remaining capacity when there is enough history,
+ * as it also covers the time spent in sleep or standby between updates. Until then the average power
+ * reported by the fuel gauge is used. The history is discarded when the battery gets charged,
+ * and the power estimate follows a new observation immediately when the activity power changes a lot.
+ * Since the allowed power is recomputed from the remaining energy on every update, spending
+ * too much early on automatically lowers the budget later.
+ *
+ * Times are in seconds of any monotonic timebase, e.g. the Unix time from the RTC. The governor doesn't
+ * access any hardware except in update(uint32_t, Battery&), so it can be driven with simulated values.
+ */
+class EnergyBudgetGovernor {
+    public:
+        /**
+         * @brief Sets the time until which the battery has to last.
+         * @param deadline The deadline in seconds, in the same timebase as the time passed to update().
+         */
+        void setDeadline(uint32_t deadline);
+
+        /**
+         * @brief Sets the capacity that must remain in the battery at the deadline.
+         * @param reserveCapacity The reserve in milliampere-hours (mAh).
+         */
+        void setReserveCapacity(float reserveCapacity);
+
+        /**
+         * @brief Sets the power that is drawn regardless of the activity, e.g. the standby power.
+         * Only the power above it is scaled by the duty cycle.
+         * @param basePower The base power in milliwatts (mW).
+         */
+        void setBasePower(float basePower);
+
+        /**
+         * @brief Sets how long the consumption history is remembered.
+         * Longer times give a steadier output, shorter times react faster to changes.
+         * @param timeConstant The time constant in seconds (s).
+         */
+        void setHistoryTimeConstant(uint32_t timeConstant);
+
+        /**
+         * @brief Sets the lower limit of the duty cycle.
+         * @param minimumDutyCycle The smallest duty cycle returned, even if the budget is exceeded.
+         */
+        void setMinimumDutyCycle(float minimumDutyCycle);
+
+        /**
+         * @brief Updates the plan with new measurements.
+         * @param now The current time in seconds.
+         * @param remainingCapacity The remaining capacity in milliampere-hours (mAh).
+         * @param averagePower The recent average power drawn from the battery in milliwatts (mW).
+         * @param voltage The battery voltage in volts (V).
+         * @return The new budget.
+         */
+        EnergyBudget update(uint32_t now, float remainingCapacity, float averagePower, float voltage);
+
+        /**
+         * @brief Updates the plan with the readings of the fuel gauge.
+         * @param now The current time in seconds.
+         * @param battery The battery to read.
+         * @return The new budget.
+         */
+        EnergyBudget update(uint32_t now, Battery &battery);
+
+        /**
+         * @brief Returns the result of the last update.
+         * @return The budget.
+         */
+        EnergyBudget budget();
+
+        /**
+         * @brief Discards the consumption history.
+         */
+        void reset();
+
+    private:
+        /**
+         * Adds a power observation to the history, weighted by the time it covers.
+         * @param power The average power during the observation.
+         * @param dutyCycle The average duty cycle during the observation.
+         * @param duration The time the observation covers in seconds.
+         */
+        void addObservation(float power, float dutyCycle, uint32_t duration);
+
+        uint32_t deadline = 0;
+        float reserveCapacity = 0.0f;
+        float basePower = 0.0f;
+        uint32_t historyTimeConstant = DEFAULT_BUDGET_HISTORY_TIME_CONSTANT;
+        float minimumDutyCycle = DEFAULT_BUDGET_MINIMUM_DUTY_CYCLE;
+
+        EnergyBudget result;
+        bool hasHistory = false;
+        float observedPower = 0.0f;
+        float observedDutyCycle = 1.0f; // The duty cycle averaged the same way as the observed power
+
+        bool hasPreviousUpdate = false;
+        uint32_t previousTime = 0;
+        float previousCapacity = 0.0f;
+
+        // The capacity and time at which the current capacity drop measurement started
+        uint32_t referenceTime = 0;
+        float referenceCapacity = 0.0f;
+        float dutyCycleIntegral = 0.0f; // Duty cycle multiplied by seconds since the reference time
+};
+
+#endif
@@ -0,0 +1,88 @@
+#include "EnergyProbe.h"
+#include "BatteryConstants.h"
+
+void EnergyBucket::add(const EnergyMeasurement &measurement) {
+    ++count;
+    total.charge += measurement.charge;
+    total.energy += measurement.energy;
+    total.duration += measurement.duration;
+    total.averageCurrent = total.duration > 0.0f ? total.charge * 3600.0f / total.duration : 0.0f;
+}
+
+EnergyBucket *EnergyBuckets::get(const char *name) {
+    for (uint8_t index = 0; index < count; ++index) {
+        if (strcmp(buckets[index].name, name) == 0) {
+            return &buckets[index];
+        }
+    }
+
+    if (count == MAX_ENERGY_BUCKETS) {
+        return nullptr;
+    }
+
+    buckets[count] = EnergyBucket();
+    buckets[count].name = name;
+    return &buckets[count++];
+}
+
+void EnergyBuckets::reset() {
+    count = 0;
+}
+
+void EnergyBuckets::dump(Print &output) {
+    output.println("name, count, charge (mAh), energy (mWh), duration (s), average current (mA), energy per run (mWh)");
+    for (uint8_t index = 0; index < count; ++index) {
+        const EnergyBucket &bucket = buckets[index];
+        output.print(bucket.name);
+        output.print(", ");
+        output.print(bucket.count);
+        output.print(", ");
+        output.print(bucket.total.charge, 3);
+        output.print(", ");
+        output.print(bucket.total.energy, 3);
+        output.print(", ");
+        output.print(bucket.total.duration, 1);
+        output.print(", ");
+        output.print(bucket.total.averageCurrent, 3);
+        output.print(", ");
+        output.println(bucket.count > 0 ? bucket.total.energy / bucket.count : 0.0f, 4);
+    }
+}
+
+EnergyProbe::EnergyProbe(Battery &battery, EnergyBucket *bucket) : battery(&battery), bucket(bucket) {
+    start = battery.coulombCounter();
+}
+
+EnergyProbe::~EnergyProbe() {
+    stop();
+}
+
+EnergyMeasurement EnergyProbe::stop() {
+    if (!running) {
+        return result;
+    }
+
+    running = false;
+    result = between(start, battery->coulombCounter());
+    if (bucket != nullptr) {
+        bucket->add(result);
+    }
+    return result;
+}
+
+EnergyMeasurement EnergyProbe::between(const CoulombCounterSnapshot &start, const CoulombCounterSnapshot &end) {
+    EnergyMeasurement measurement;
+
+    // The signed difference handles the wrap-around of the 16 bit counter, QH decreases while discharging
+    int16_t chargeDifference = static_cast<int16_t>(end.charge - start.charge);
+    measurement.charge = -chargeDifference * CAPACITY_MULTIPLIER_MAH;
+    measurement.duration = (end.timer - start.timer) * TIMER_MULTIPLIER_S;
+
+    float averageVoltage = (start.averageVoltage + end.averageVoltage) / 2.0f * VOLTAGE_MULTIPLIER_MV / 1000.0f;
+    measurement.energy = measurement.charge * averageVoltage;
+
+    if (measurement.duration > 0.0f) {
+        measurement.averageCurrent = measurement.charge * 3600.0f / measurement.duration;
+    }
+    return measurement;
+}
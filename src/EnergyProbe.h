@@ -0,0 +1,129 @@
+#ifndef ENERGY_PROBE_H
+#define ENERGY_PROBE_H
+
+#include "Arduino.h"
+#include "Battery.h"
+
+constexpr uint8_t MAX_ENERGY_BUCKETS = 8; // Maximum number of named buckets in EnergyBuckets
+
+/**
+ * @brief The charge and energy drawn from the battery over a period of time.
+ */
+struct EnergyMeasurement {
+    /// @brief The charge drawn from the battery in milliampere-hours (mAh). Negative while charging.
+    float charge = 0.0f;
+
+    /// @brief The energy drawn from the battery in milliwatt-hours (mWh). Negative while charging.
+    float energy = 0.0f;
+
+    /// @brief The average current drawn from the battery in milli amperes (mA).
+    float averageCurrent = 0.0f;
+
+    /// @brief The duration of the measurement in seconds (s).
+    float duration = 0.0f;
+};
+
+/**
+ * @brief Accumulates the measurements of all probes of the same code region.
+ */
+struct EnergyBucket {
+    /// @brief The name of the code region, e.g. "uplink".
+    const char *name = nullptr;
+
+    /// @brief The number of measurements added to the bucket.
+    uint32_t count = 0;
+
+    /// @brief The sum of all measurements.
+    EnergyMeasurement total;
+
+    /**
+     * @brief Adds a measurement to the bucket.
+     * @param measurement The measurement to add.
+     */
+    void add(const EnergyMeasurement &measurement);
+};
+
+/**
+ * @brief A fixed set of named energy buckets that can be printed as a table.
+ */
+class EnergyBuckets {
+    public:
+        /**
+         * @brief Returns the bucket with the given name and creates it if it doesn't exist yet.
+         * @param name The name of the bucket. The string must outlive the buckets, e.g. a string literal.
+         * @return The bucket, or nullptr if all MAX_ENERGY_BUCKETS buckets are in use.
+         */
+        EnergyBucket *get(const char *name);
+
+        /**
+         * @brief Removes all buckets.
+         */
+        void reset();
+
+        /**
+         * @brief Prints the totals and averages of all buckets, one line per bucket.
+         * @param output Where to print the table, e.g. Serial.
+         */
+        void dump(Print &output);
+
+    private:
+        EnergyBucket buckets[MAX_ENERGY_BUCKETS];
+        uint8_t count = 0;
+};
+
+/**
+ * @brief Measures the charge and energy drawn from the battery by a region of code.
+ *
+ * The probe reads the fuel gauge's coulomb counter when it's created and again when it's destroyed
+ * or stopped, and adds the result to a bucket. Put it in a block around the code to measure:
+ *
+ *     {
+ *         EnergyProbe probe(battery, buckets.get("uplink"));
+ *         sendUplink();
+ *     }
+ *
+ * The coulomb counter has a resolution of 0.5mAh, so short regions only become meaningful
+ * when they are measured many times and accumulated in a bucket.
+ */
+class EnergyProbe {
+    public:
+        /**
+         * @brief Starts a measurement.
+         * @param battery The battery to measure.
+         * @param bucket The bucket the measurement is added to when it stops, or nullptr.
+         */
+        EnergyProbe(Battery &battery, EnergyBucket *bucket = nullptr);
+
+        /**
+         * @brief Stops the measurement if it's still running.
+         */
+        ~EnergyProbe();
+
+        EnergyProbe(const EnergyProbe &) = delete;
+        EnergyProbe &operator=(const EnergyProbe &) = delete;
+
+        /**
+         * @brief Stops the measurement and adds it to the bucket.
+         * Calling it again returns the same measurement.
+         * @return The measurement since the probe was created.
+         */
+        EnergyMeasurement stop();
+
+        /**
+         * @brief Calculates the charge and energy between two coulomb counter snapshots.
+         * Handles the wrap-around of the coulomb counter and the timer.
+         * @param start The snapshot at the beginning of the period.
+         * @param end The snapshot at the end of the period.
+         * @return The measurement for the period.
+         */
+        static EnergyMeasurement between(const CoulombCounterSnapshot &start, const CoulombCounterSnapshot &end);
+
+    private:
+        Battery *battery;
+        EnergyBucket *bucket;
+        CoulombCounterSnapshot start;
+        EnergyMeasurement result;
+        bool running = true;
+};
+
+#endif
@@ -0,0 +1,189 @@
+#include "GaugePoller.h"
+#include "WireUtils.h"
+#include "BatteryConstants.h"
+
+constexpr uint32_t GAUGE_PHASE_TOLERANCE_MS = 8; // Bracket width from which the phase counts as locked, plus the drift
+constexpr uint32_t GAUGE_READ_MARGIN_MS = 2; // Delay after the latest expected update
+constexpr uint32_t GAUGE_RETRY_INTERVAL_MS = 5; // Shortest delay before reading again if an update is late
+constexpr uint32_t GAUGE_DRIFT_DIVISOR = 128; // Allows the clocks to drift apart by up to 1/128 of a period per update
+constexpr uint8_t GAUGE_PERIOD_REFRESH_UPDATES = 16; // Updates after which the task period is read again
+
+/**
+ * Returns the later of two millis() timestamps, taking the overflow into account.
+ */
+static uint32_t laterOf(uint32_t a, uint32_t b) {
+    return static_cast<int32_t>(a - b) > 0 ? a : b;
+}
+
+/**
+ * Returns the earlier of two millis() timestamps, taking the overflow into account.
+ */
+static uint32_t earlierOf(uint32_t a, uint32_t b) {
+    return static_cast<int32_t>(a - b) < 0 ? a : b;
+}
+
+GaugePoller::GaugePoller(Battery &battery) : battery(&battery) {
+}
+
+GaugeReading GaugePoller::poll() {
+    ++pollCount;
+    uint32_t now = millis();
+
+    if (!started) {
+        readOutputs();
+        started = true;
+        lastRead = now;
+        updateLatest = now;
+        refreshTaskPeriod();
+        reading.fresh = true;
+        reading.time = now;
+        return reading;
+    }
+
+    GaugeReading cached = reading;
+    cached.fresh = false;
+    if (static_cast<int32_t>(now - nextRead) < 0) {
+        return cached;
+    }
+
+    uint32_t drift = period / GAUGE_DRIFT_DIVISOR;
+    uint32_t expectedEarliest = updateEarliest + period - drift;
+    uint32_t expectedLatest = updateLatest + period + drift;
+
+    if (readOutputs()) {
+        // The update happened after the previous read, which still saw the old values,
+        // narrow the prediction down with that unless the clocks drifted out of it
+        uint32_t earliest = laterOf(lastRead, expectedEarliest);
+        uint32_t latest = earlierOf(now, expectedLatest);
+        if (static_cast<int32_t>(latest - earliest) <= 0) {
+            earliest = lastRead;
+            latest = now;
+        }
+        updateEarliest = earliest;
+        updateLatest = latest;
+        lastRead = now;
+
+        reading.fresh = true;
+        reading.time = latest;
+        if (++updatesSinceRefresh >= GAUGE_PERIOD_REFRESH_UPDATES) {
+            refreshTaskPeriod();
+        } else {
+            scheduleNextUpdate();
+        }
+        return reading;
+    }
+    lastRead = now;
+
+    int32_t overdue = static_cast<int32_t>(now - expectedLatest);
+    if (overdue >= static_cast<int32_t>(period)) {
+        // A whole period without a change, either the fuel gauge entered hibernate mode
+        // or it reported the same values again
+        uint32_t previousPeriod = period;
+        refreshTaskPeriod();
+        if (period == previousPeriod) {
+            updateEarliest = expectedEarliest;
+            updateLatest = expectedLatest;
+            scheduleNextUpdate();
+        }
+        return cached;
+    }
+
+    if (overdue < 0) {
+        // Still within the prediction, halve the rest of it
+        uint32_t remaining = expectedLatest - now;
+        nextRead = remaining > phaseTolerance() ? now + remaining / 2 : expectedLatest + GAUGE_READ_MARGIN_MS;
+    } else {
+        // Back off exponentially, so identical values don't keep the bus busy for a whole period
+        nextRead = now + max(GAUGE_RETRY_INTERVAL_MS, static_cast<uint32_t>(overdue));
+    }
+    return cached;
+}
+
+bool GaugePoller::available() {
+    return !started || static_cast<int32_t>(millis() - nextRead) >= 0;
+}
+
+uint32_t GaugePoller::nextUpdate() {
+    return started ? nextRead : millis();
+}
+
+uint32_t GaugePoller::taskPeriod() {
+    return period;
+}
+
+bool GaugePoller::isSynchronised() {
+    return started && updateLatest - updateEarliest <= phaseTolerance();
+}
+
+uint32_t GaugePoller::polls() {
+    return pollCount;
+}
+
+uint32_t GaugePoller::transactions() {
+    return transactionCount;
+}
+
+void GaugePoller::reset() {
+    reading = GaugeReading();
+    memset(outputs, 0, sizeof(outputs));
+    period = 0;
+    updatesSinceRefresh = 0;
+    started = false;
+    pollCount = 0;
+    transactionCount = 0;
+}
+
+bool GaugePoller::readOutputs() {
+    uint16_t values[GAUGE_OUTPUT_REGISTERS];
+    readRegisters16Bits(battery->wire, FUEL_GAUGE_ADDRESS, REP_CAP_REG, values, GAUGE_OUTPUT_REGISTERS);
+    ++transactionCount;
+
+    // Any update changes at least the low bits of the voltage or current
+    if (started && memcmp(values, outputs, sizeof(values)) == 0) {
+        return false;
+    }
+    memcpy(outputs, values, sizeof(values));
+
+    reading.remainingCapacity = values[REP_CAP_REG - REP_CAP_REG] * CAPACITY_MULTIPLIER_MAH;
+    reading.percentage = values[REP_SOC_REG - REP_CAP_REG] * PERCENTAGE_MULTIPLIER;
+    reading.temperature = static_cast<int16_t>(values[TEMP_REG - REP_CAP_REG]) * TEMPERATURE_MULTIPLIER_C;
+    reading.voltage = values[VCELL_REG - REP_CAP_REG] * VOLTAGE_MULTIPLIER_MV / 1000.0f;
+    reading.current = static_cast<int16_t>(values[CURRENT_REG - REP_CAP_REG]) * CURRENT_MULTIPLIER_MA;
+    reading.averageCurrent = static_cast<int16_t>(values[AVG_CURRENT_REG - REP_CAP_REG]) * CURRENT_MULTIPLIER_MA;
+    reading.power = reading.voltage * reading.current;
+    return true;
+}
+
+void GaugePoller::refreshTaskPeriod() {
+    uint32_t activePeriod = ceil(ACTIVE_TASK_PERIOD_MS);
+    uint32_t newPeriod = battery->taskPeriod();
+    // Battery::taskPeriod() also reads the HibCfg register in hibernate mode
+    transactionCount += newPeriod > activePeriod ? 2 : 1;
+    updatesSinceRefresh = 0;
+
+    if (newPeriod != period) {
+        // The phase is unknown again, the last update was at most one period before the last one seen
+        period = newPeriod;
+        updateEarliest = updateLatest - period;
+    }
+    scheduleNextUpdate();
+}
+
+void GaugePoller::scheduleNextUpdate() {
+    uint32_t drift = period / GAUGE_DRIFT_DIVISOR;
+    uint32_t expectedEarliest = updateEarliest + period - drift;
+    uint32_t expectedLatest = updateLatest + period + drift;
+    uint32_t width = expectedLatest - expectedEarliest;
+
+    if (width > phaseTolerance()) {
+        // Bisect the prediction to find the phase
+        nextRead = expectedEarliest + width / 2;
+    } else {
+        nextRead = expectedLatest + GAUGE_READ_MARGIN_MS;
+    }
+}
+
+uint32_t GaugePoller::phaseTolerance() {
+    // A locked bracket widens by the drift on both sides each period, that alone mustn't restart the search
+    return GAUGE_PHASE_TOLERANCE_MS + 2 * (period / GAUGE_DRIFT_DIVISOR);
+}
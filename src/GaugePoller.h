@@ -0,0 +1,159 @@
+#ifndef GAUGE_POLLER_H
+#define GAUGE_POLLER_H
+
+#include "Arduino.h"
+#include "Battery.h"
+
+constexpr uint8_t GAUGE_OUTPUT_REGISTERS = 7; // RepCap (0x05) to AvgCurrent (0x0B), read in one transaction
+
+/**
+ * @brief The output registers of the fuel gauge from one task period.
+ */
+struct GaugeReading {
+    /// @brief True if the fuel gauge updated the values since the previous reading, false if they are repeated.
+    bool fresh = false;
+
+    /// @brief The estimated time of the update that produced the values in milliseconds (ms), as returned by millis().
+    uint32_t time = 0;
+
+    /// @brief The battery voltage in volts (V).
+    float voltage = 0.0f;
+
+    /// @brief The battery current in milli amperes (mA), at the full resolution of the Current register.
+    float current = 0.0f;
+
+    /// @brief The average battery current in milli amperes (mA).
+    float averageCurrent = 0.0f;
+
+    /// @brief The battery power in milliwatts (mW).
+    float power = 0.0f;
+
+    /// @brief The state of charge in percent, at the full resolution of the RepSOC register.
+    float percentage = 0.0f;
+
+    /// @brief The remaining capacity in milliampere-hours (mAh).
+    float remainingCapacity = 0.0f;
+
+    /// @brief The temperature in degrees Celsius, as selected with Battery::setTemperatureMeasurementMode().
+    float temperature = 0.0f;
+};
+
+/**
+ * @brief Reads the fuel gauge only when it has new values.
+ *
+ * The fuel gauge refreshes its output registers once per task period, which is 175ms in active mode and
+ * 5.6s or more in hibernate mode. Reading them more often returns the same values again. The poller learns
+ * when the updates happen and only accesses the bus just after an update is due, every other call to poll()
+ * returns the previous reading, marked as not fresh. All output registers are read in a single transaction.
+ *
+ * The phase of the updates is found by bisection: the first updates are bracketed between a read that saw
+ * the old values and one that saw the new ones, until the bracket is narrower than a few milliseconds.
+ * From then on the bracket is carried forward by one task period, which costs one read per update.
+ * A read that finds unchanged values is retried shortly after, so drift between the clocks of the
+ * fuel gauge and the microcontroller is corrected as it occurs. The task period is read again regularly
+ * and whenever an update is missed, so switching between active and hibernate mode is followed.
+ *
+ *     GaugePoller poller(battery);
+ *
+ *     void loop() {
+ *         GaugeReading reading = poller.poll();
+ *         if (reading.fresh) {
+ *             Serial.println(reading.current);
+ *         }
+ *     }
+ */
+class GaugePoller {
+    public:
+        /**
+         * @brief Constructs a new GaugePoller object.
+         * @param battery The battery to read.
+         */
+        GaugePoller(Battery &battery);
+
+        /**
+         * @brief Returns the most recent values of the fuel gauge.
+         * The bus is only accessed if an update is due, so this can be called in a tight loop.
+         * @return The reading. Its fresh flag is set the first time new values are returned.
+         */
+        GaugeReading poll();
+
+        /**
+         * @brief Checks if the next call to poll() will read the fuel gauge.
+         * @return True if an update is due, false otherwise.
+         */
+        bool available();
+
+        /**
+         * @brief Returns when the next update of the fuel gauge is expected, e.g. to sleep until then.
+         * @return The time in milliseconds (ms), as returned by millis().
+         */
+        uint32_t nextUpdate();
+
+        /**
+         * @brief Returns the task period the poller is following.
+         * @return The task period in milliseconds (ms), 0 before the first poll.
+         */
+        uint32_t taskPeriod();
+
+        /**
+         * @brief Checks if the poller knows when the updates happen within a few milliseconds.
+         * @return True if the phase is locked, false while it's still searched.
+         */
+        bool isSynchronised();
+
+        /**
+         * @brief Returns the number of calls to poll() since the last reset.
+         * @return The number of polls.
+         */
+        uint32_t polls();
+
+        /**
+         * @brief Returns the number of bus transactions made since the last reset, including those
+         * that read the task period.
+         * @return The number of transactions.
+         */
+        uint32_t transactions();
+
+        /**
+         * @brief Forgets the timing of the updates and the cached reading.
+         * Call this after changing the configuration of the fuel gauge, e.g. its hibernate settings.
+         */
+        void reset();
+
+    private:
+        /**
+         * Reads the output registers in one transaction.
+         * @return True if the values differ from the previous read, false otherwise.
+         */
+        bool readOutputs();
+
+        /**
+         * Reads the task period and restarts the phase search if it changed.
+         */
+        void refreshTaskPeriod();
+
+        /**
+         * Schedules the first read after the next expected update.
+         */
+        void scheduleNextUpdate();
+
+        /**
+         * Returns the bracket width up to which the phase counts as locked.
+         */
+        uint32_t phaseTolerance();
+
+        Battery *battery;
+        GaugeReading reading;
+        uint16_t outputs[GAUGE_OUTPUT_REGISTERS] = {};
+        uint32_t period = 0;
+        uint32_t updateEarliest = 0; // The last update happened after this time ...
+        uint32_t updateLatest = 0;   // ... and no later than this one
+        uint32_t lastRead = 0;
+        uint32_t nextRead = 0;
+        uint8_t updatesSinceRefresh = 0;
+        bool started = false;
+        uint32_t pollCount = 0;
+        uint32_t transactionCount = 0;
+};
+
+#endif
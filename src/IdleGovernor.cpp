@@ -0,0 +1,106 @@
+#include "IdleGovernor.h"
+
+// Rough estimates, the exit from standby includes booting and running setup()
+constexpr uint32_t DEFAULT_SLEEP_ENTRY_LATENCY = 1; // ms
+constexpr uint32_t DEFAULT_SLEEP_EXIT_LATENCY = 2; // ms
+constexpr uint32_t DEFAULT_STANDBY_ENTRY_LATENCY = 5; // ms
+constexpr uint32_t DEFAULT_STANDBY_EXIT_LATENCY = 500; // ms
+
+IdleGovernor::IdleGovernor() {
+    float activePower = CurrentBoardTraits::activeCurrent * NOMINAL_BATTERY_VOLTAGE;
+
+    IdleModeCharacteristics &active = modes[static_cast<uint8_t>(IdleMode::active)];
+    active.power = activePower;
+    active.transitionPower = activePower;
+
+    IdleModeCharacteristics &sleep = modes[static_cast<uint8_t>(IdleMode::sleep)];
+    sleep.power = CurrentBoardTraits::sleepCurrent * NOMINAL_BATTERY_VOLTAGE;
+    sleep.entryLatency = DEFAULT_SLEEP_ENTRY_LATENCY;
+    sleep.exitLatency = DEFAULT_SLEEP_EXIT_LATENCY;
+    sleep.transitionPower = activePower;
+
+    IdleModeCharacteristics &standby = modes[static_cast<uint8_t>(IdleMode::standby)];
+    standby.power = CurrentBoardTraits::standbyCurrent * NOMINAL_BATTERY_VOLTAGE;
+    standby.entryLatency = DEFAULT_STANDBY_ENTRY_LATENCY;
+    standby.exitLatency = DEFAULT_STANDBY_EXIT_LATENCY;
+    standby.transitionPower = activePower;
+}
+
+void IdleGovernor::setCharacteristics(IdleMode mode, IdleModeCharacteristics characteristics) {
+    modes[static_cast<uint8_t>(mode)] = characteristics;
+}
+
+IdleModeCharacteristics IdleGovernor::characteristics(IdleMode mode) {
+    return modes[static_cast<uint8_t>(mode)];
+}
+
+bool IdleGovernor::isAvailable(IdleMode mode) {
+    switch (mode) {
+        case IdleMode::sleep:
+            return CurrentBoardTraits::supportsSleep;
+        case IdleMode::standby:
+            return CurrentBoardTraits::supportsStandby;
+        default:
+            return true;
+    }
+}
+
+uint32_t IdleGovernor::breakEvenTime(IdleMode mode) {
+    const IdleModeCharacteristics &target = modes[static_cast<uint8_t>(mode)];
+    float activePower = modes[static_cast<uint8_t>(IdleMode::active)].power;
+    uint32_t latency = target.entryLatency + target.exitLatency;
+
+    if (mode == IdleMode::active) {
+        return 0;
+    }
+    if (target.power >= activePower) {
+        return UINT32_MAX;
+    }
+
+    // transitionPower * latency + power * (T - latency) = activePower * T
+    float breakEven = latency * (target.transitionPower - target.power) / (activePower - target.power);
+    return max(latency, static_cast<uint32_t>(ceilf(breakEven)));
+}
+
+float IdleGovernor::expectedEnergy(IdleMode mode, uint32_t idleTime) {
+    const IdleModeCharacteristics &target = modes[static_cast<uint8_t>(mode)];
+    uint32_t latency = target.entryLatency + target.exitLatency;
+    if (latency > idleTime) {
+        return -1.0f;
+    }
+
+    // mW * ms = µJ
+    return (target.transitionPower * latency + target.power * (idleTime - latency)) / 1000.0f;
+}
+
+IdleMode IdleGovernor::selectMode(uint32_t predictedIdleTime) {
+    IdleMode bestMode = IdleMode::active;
+    float lowestEnergy = expectedEnergy(IdleMode::active, predictedIdleTime);
+
+    for (uint8_t index = 1; index < IDLE_MODE_COUNT; ++index) {
+        IdleMode mode = static_cast<IdleMode>(index);
+        if (!isAvailable(mode)) {
+            continue;
+        }
+
+        float energy = expectedEnergy(mode, predictedIdleTime);
+        if (energy >= 0.0f && energy < lowestEnergy) {
+            lowestEnergy = energy;
+            bestMode = mode;
+        }
+    }
+    return bestMode;
+}
+
+void IdleGovernor::learnPower(IdleMode mode, float current, float voltage) {
+    // While charging the gauge doesn't see what the board draws, and a negative power would invert the break-even times
+    if (current <= 0.0f) {
+        return;
+    }
+    float &power = modes[static_cast<uint8_t>(mode)].power;
+    power += learningRate * (current * voltage - power);
+}
+
+void IdleGovernor::setLearningRate(float learningRate) {
+    this->learningRate = constrain(learningRate, 0.0f, 1.0f);
+}
@@ -0,0 +1,128 @@
+#ifndef IDLE_GOVERNOR_H
+#define IDLE_GOVERNOR_H
+
+#include "Arduino.h"
+#include "BoardTraits.h"
+
+constexpr float NOMINAL_BATTERY_VOLTAGE = 3.7f; // V, used to convert the typical board currents into power
+constexpr float DEFAULT_POWER_LEARNING_RATE = 0.2f; // Weight of a new measurement in learnPower()
+
+/**
+ * @brief The ways the board can spend an idle period.
+ */
+enum class IdleMode : uint8_t {
+    /// @brief Stay awake, e.g. with delay().
+    active = 0,
+
+    /// @brief Sleep and resume without a reset, see Board::sleepUntilWakeupEvent().
+    sleep = 1,
+
+    /// @brief Standby, the board restarts on wake-up, see Board::standByUntilWakeupEvent().
+    standby = 2
+};
+
+constexpr uint8_t IDLE_MODE_COUNT = 3;
+
+/**
+ * @brief The energy cost of an idle mode.
+ */
+struct IdleModeCharacteristics {
+    /// @brief Power in milliwatts (mW) while in the mode.
+    float power = 0.0f;
+
+    /// @brief Time in milliseconds (ms) it takes to enter the mode.
+    uint32_t entryLatency = 0;
+
+    /// @brief Time in milliseconds (ms) it takes to be ready again after the wake-up, including setup() for standby.
+    uint32_t exitLatency = 0;
+
+    /// @brief Power in milliwatts (mW) while entering and leaving the mode.
+    float transitionPower = 0.0f;
+};
+
+/**
+ * @brief Picks the idle mode that uses the least energy for a predicted idle period.
+ *
+ * Entering a low power mode costs energy and time. For short idle periods staying active uses less energy,
+ * for longer ones sleep and then standby pay off. The break-even time of a mode is the idle duration above
+ * which it uses less energy than staying active. The governor compares the expected energy of all
+ * modes the board supports and picks the cheapest one whose entry and exit latency fit in the idle period.
+ *
+ * The defaults are based on the typical currents of the board with the peripherals off and rough latency estimates.
+ * Set your own values with setCharacteristics() or learn the power from fuel gauge measurements with learnPower().
+ */
+class IdleGovernor {
+    public:
+        /**
+         * @brief Constructs a new IdleGovernor object with the default characteristics of the board.
+         */
+        IdleGovernor();
+
+        /**
+         * @brief Sets the energy cost of an idle mode.
+         * @param mode The idle mode to configure.
+         * @param characteristics The power and latencies of the mode.
+         */
+        void setCharacteristics(IdleMode mode, IdleModeCharacteristics characteristics);
+
+        /**
+         * @brief Returns the energy cost of an idle mode.
+         * @param mode The idle mode.
+         * @return The power and latencies of the mode.
+         */
+        IdleModeCharacteristics characteristics(IdleMode mode);
+
+        /**
+         * @brief Checks if the board supports an idle mode.
+         * @param mode The idle mode to check.
+         * @return True if the mode can be selected, false otherwise.
+         */
+        bool isAvailable(IdleMode mode);
+
+        /**
+         * @brief Calculates the idle duration above which a mode uses less energy than staying active.
+         * @param mode The idle mode.
+         * @return The break-even time in milliseconds (ms), UINT32_MAX if the mode never pays off.
+         */
+        uint32_t breakEvenTime(IdleMode mode);
+
+        /**
+         * @brief Calculates the energy a mode uses over an idle period.
+         * @param mode The idle mode.
+         * @param idleTime The duration of the idle period in milliseconds (ms).
+         * @return The energy in millijoules (mJ), or a negative value if the latencies don't fit in the idle period.
+         */
+        float expectedEnergy(IdleMode mode, uint32_t idleTime);
+
+        /**
+         * @brief Picks the idle mode that uses the least energy.
+         * @param predictedIdleTime The predicted duration of the idle period in milliseconds (ms).
+         * @return The idle mode to use.
+         */
+        IdleMode selectMode(uint32_t predictedIdleTime);
+
+        /**
+         * @brief Updates the power of a mode with a measurement, e.g. the average current reported
+         * by the fuel gauge while in the mode or the average sleep current after waking up from standby.
+         * The measurement is blended into the current value using the learning rate.
+         * The current is the one drawn from the battery, which is positive. The fuel gauge reports discharging
+         * as negative, so pass -battery.averageCurrent(). The measurements of EnergyProbe and SleepTracker
+         * are already positive. Measurements that aren't positive, e.g. while charging, are ignored.
+         * @param mode The idle mode the measurement was taken in.
+         * @param current The current drawn from the battery in milli amperes (mA).
+         * @param voltage The battery voltage in volts (V) during the measurement.
+         */
+        void learnPower(IdleMode mode, float current, float voltage);
+
+        /**
+         * @brief Sets how strongly a new measurement changes the learned power.
+         * @param learningRate Value between 0 (ignore measurements) and 1 (only use the last measurement).
+         */
+        void setLearningRate(float learningRate);
+
+    private:
+        IdleModeCharacteristics modes[IDLE_MODE_COUNT];
+        float learningRate = DEFAULT_POWER_LEARNING_RATE;
+};
+
+#endif
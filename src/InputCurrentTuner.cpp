@@ -0,0 +1,171 @@
+#include "InputCurrentTuner.h"
+
+constexpr uint32_t INPUT_RECOVERY_MS = 50; // Samples right after a change of the limit may still show the previous one
+
+PMICInputCurrentControl::PMICInputCurrentControl(Charger &charger) : charger(&charger) {
+}
+
+bool PMICInputCurrentControl::setInputCurrentLimit(uint16_t current) {
+    return charger->setInputCurrentLimit(current);
+}
+
+bool PMICInputCurrentControl::isInputValid() {
+    uint8_t registerValue = PMIC.readPMICreg(Register::CHARGER_VBUS_SNS);
+    return bitRead(registerValue, CHARGER_VBUS_VALID_BIT) == 1 && bitRead(registerValue, CHARGER_VBUS_UVLO_BIT) == 0;
+}
+
+#if defined(ARDUINO_POWER_MANAGEMENT_HOST_SIM)
+SimulatedPowerSource::SimulatedPowerSource(float resistance, float openCircuitVoltage, float minimumVoltage)
+    : resistance(resistance), openCircuitVoltage(openCircuitVoltage), minimumVoltage(minimumVoltage) {
+}
+
+void SimulatedPowerSource::setResistance(float resistance) {
+    this->resistance = resistance;
+}
+
+void SimulatedPowerSource::setConnected(bool connected) {
+    this->connected = connected;
+}
+
+float SimulatedPowerSource::inputVoltage() {
+    if (!connected) {
+        return 0.0f;
+    }
+    return openCircuitVoltage - (currentLimit / 1000.0f) * resistance;
+}
+
+bool SimulatedPowerSource::setInputCurrentLimit(uint16_t current) {
+    if (Charger::higherInputCurrentLimit(current > 0 ? current - 1 : 0) != current) {
+        return false; // Not supported by the charger
+    }
+    currentLimit = current;
+    return true;
+}
+
+bool SimulatedPowerSource::isInputValid() {
+    return connected && inputVoltage() >= minimumVoltage;
+}
+#endif
+
+InputCurrentTuner::InputCurrentTuner(InputCurrentControl &control) : control(&control) {
+}
+
+bool InputCurrentTuner::setRange(uint16_t minimum, uint16_t maximum) {
+    // The smallest supported limit not below the minimum and the largest one not above the maximum
+    uint16_t lowest = Charger::higherInputCurrentLimit(minimum > 0 ? minimum - 1 : 0);
+    uint16_t highest = Charger::lowerInputCurrentLimit(maximum < UINT16_MAX ? maximum + 1 : maximum);
+    if (lowest == 0 || highest == 0 || highest < lowest) {
+        return false;
+    }
+
+    minimumLimit = lowest;
+    maximumLimit = highest;
+    return true;
+}
+
+void InputCurrentTuner::setSettleTime(uint32_t duration) {
+    settleTime = duration;
+}
+
+void InputCurrentTuner::setReprobeInterval(uint32_t duration) {
+    reprobeInterval = duration;
+}
+
+bool InputCurrentTuner::begin(uint32_t now) {
+    currentState = InputCurrentTunerState::probing;
+    sagLimit = 0;
+    sagCount = 0;
+    currentLimit = minimumLimit;
+    lastChange = now;
+    return control->setInputCurrentLimit(minimumLimit);
+}
+
+void InputCurrentTuner::update(uint32_t now) {
+    uint32_t elapsed = now - lastChange;
+    if (elapsed < INPUT_RECOVERY_MS) {
+        return;
+    }
+    bool valid = control->isInputValid();
+
+    if (currentState == InputCurrentTunerState::noSource) {
+        if (valid) {
+            currentState = InputCurrentTunerState::probing;
+            lastChange = now;
+        }
+        return;
+    }
+
+    if (!valid) {
+        ++sagCount;
+        if (currentLimit <= minimumLimit) {
+            // Not even the minimum can be drawn, wait until the source comes back
+            currentState = InputCurrentTunerState::noSource;
+            sagLimit = 0;
+            lastChange = now;
+            return;
+        }
+        sagLimit = currentLimit;
+        currentState = InputCurrentTunerState::holding;
+        applyLimit(previousLimit(currentLimit), now);
+        return;
+    }
+
+    if (currentState == InputCurrentTunerState::probing) {
+        if (elapsed < settleTime) {
+            return;
+        }
+        uint16_t next = nextLimit(currentLimit);
+        if (next == currentLimit) {
+            currentState = InputCurrentTunerState::holding;
+            lastChange = now;
+            return;
+        }
+        applyLimit(next, now);
+        return;
+    }
+
+    // Holding: the source may have become stronger meanwhile, try one step above again
+    if (elapsed >= reprobeInterval) {
+        sagLimit = 0;
+        currentState = InputCurrentTunerState::probing;
+        uint16_t next = nextLimit(currentLimit);
+        if (next != currentLimit) {
+            applyLimit(next, now);
+        } else {
+            lastChange = now;
+        }
+    }
+}
+
+uint16_t InputCurrentTuner::limit() {
+    return currentLimit;
+}
+
+uint16_t InputCurrentTuner::ceiling() {
+    return sagLimit;
+}
+
+InputCurrentTunerState InputCurrentTuner::state() {
+    return currentState;
+}
+
+uint32_t InputCurrentTuner::sags() {
+    return sagCount;
+}
+
+void InputCurrentTuner::applyLimit(uint16_t current, uint32_t now) {
+    if (control->setInputCurrentLimit(current)) {
+        currentLimit = current;
+    }
+    lastChange = now;
+}
+
+uint16_t InputCurrentTuner::nextLimit(uint16_t current) {
+    uint16_t next = Charger::higherInputCurrentLimit(current);
+    return next == 0 || next > maximumLimit ? current : next;
+}
+
+uint16_t InputCurrentTuner::previousLimit(uint16_t current) {
+    uint16_t previous = Charger::lowerInputCurrentLimit(current);
+    return previous == 0 || previous < minimumLimit ? current : previous;
+}
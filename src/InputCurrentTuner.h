@@ -0,0 +1,228 @@
+#ifndef INPUT_CURRENT_TUNER_H
+#define INPUT_CURRENT_TUNER_H
+
+#include "Arduino.h"
+#include "Charger.h"
+
+/**
+ * @brief The input of the charger as seen by the InputCurrentTuner.
+ * Implement this to tune another charger or to simulate a power source.
+ */
+class InputCurrentControl {
+    public:
+        virtual ~InputCurrentControl() = default;
+
+        /**
+         * @brief Sets the input current limit.
+         * @param current The limit in milli amperes (mA), one of the values supported by Charger::setInputCurrentLimit().
+         * @return True if the limit was set, false otherwise.
+         */
+        virtual bool setInputCurrentLimit(uint16_t current) = 0;
+
+        /**
+         * @brief Checks if the input voltage is within its valid range.
+         * @return True if the input voltage is valid, false if it sagged or there is no power source.
+         */
+        virtual bool isInputValid() = 0;
+};
+
+/**
+ * @brief Controls the input of the PF1550 charger.
+ * The input counts as valid while the VBUS_VALID bit of the CHARGER_VBUS_SNS register is set
+ * and the input isn't in undervoltage lockout, the same bit Board::isUSBPowered() reads.
+ */
+class PMICInputCurrentControl : public InputCurrentControl {
+    public:
+        /**
+         * @brief Constructs a new PMICInputCurrentControl object.
+         * @param charger The charger whose input current limit is set.
+         */
+        PMICInputCurrentControl(Charger &charger);
+
+        bool setInputCurrentLimit(uint16_t current) override;
+        bool isInputValid() override;
+
+    private:
+        Charger *charger;
+};
+
+#if defined(ARDUINO_POWER_MANAGEMENT_HOST_SIM)
+/**
+ * @brief Simulates a power source with internal resistance on the host, e.g. a weak USB port.
+ * The charger draws the full input current limit, which makes the input voltage drop by
+ * the limit times the resistance. The input is valid while it stays above the minimum voltage.
+ */
+class SimulatedPowerSource : public InputCurrentControl {
+    public:
+        /**
+         * @brief Constructs a new SimulatedPowerSource object, connected and with no input current limit set.
+         * @param resistance The series resistance in ohms (Ω).
+         * @param openCircuitVoltage The voltage in volts (V) without load.
+         * @param minimumVoltage The lowest valid input voltage in volts (V).
+         */
+        SimulatedPowerSource(float resistance, float openCircuitVoltage = 5.0f, float minimumVoltage = 4.35f);
+
+        /**
+         * @brief Changes the series resistance, e.g. to simulate a solar panel that gets shaded.
+         * @param resistance The series resistance in ohms (Ω).
+         */
+        void setResistance(float resistance);
+
+        /**
+         * @brief Connects or disconnects the source.
+         * @param connected True if the source is connected.
+         */
+        void setConnected(bool connected);
+
+        /**
+         * @brief Returns the input voltage at the current limit.
+         * @return The voltage in volts (V), 0 if the source is disconnected.
+         */
+        float inputVoltage();
+
+        bool setInputCurrentLimit(uint16_t current) override;
+        bool isInputValid() override;
+
+    private:
+        float resistance;
+        float openCircuitVoltage;
+        float minimumVoltage;
+        bool connected = true;
+        uint16_t currentLimit = 0;
+};
+#endif
+
+/**
+ * @brief The phases of the InputCurrentTuner.
+ */
+enum class InputCurrentTunerState : uint8_t {
+    /// @brief There is no power source, or it can't even supply the minimum limit. The limit stays at the minimum.
+    noSource = 0,
+
+    /// @brief The limit is raised step by step as long as the input voltage stays valid.
+    probing = 1,
+
+    /// @brief The limit is kept one step below the one at which the input voltage sagged.
+    holding = 2
+};
+
+/**
+ * @brief Finds the highest input current limit a weak power source can sustain, e.g. a USB port
+ * of a laptop or a small solar panel.
+ *
+ * A source with internal resistance sags when more current is drawn than it can deliver, which
+ * makes the charger lose its input and stop charging. Starting from the minimum, the tuner raises
+ * the limit through the values supported by the charger whenever the input stayed valid for the
+ * settle time. When the input sags, the tuner goes back to the previous limit and holds it.
+ * As the source may get stronger again, e.g. when the sun comes out, the next higher limit is
+ * probed again after the reprobe interval.
+ *
+ *     PMICInputCurrentControl input(charger);
+ *     InputCurrentTuner tuner(input);
+ *
+ *     void setup() {
+ *         tuner.begin(millis());
+ *     }
+ *
+ *     void loop() {
+ *         tuner.update(millis());
+ *     }
+ */
+class InputCurrentTuner {
+    public:
+        /**
+         * @brief Constructs a new InputCurrentTuner object.
+         * @param control The input to tune.
+         */
+        InputCurrentTuner(InputCurrentControl &control);
+
+        /**
+         * @brief Sets the range of the limit. The values are rounded inwards to supported limits.
+         * The default range is 100mA to 1500mA.
+         * @param minimum The lowest limit in milli amperes (mA).
+         * @param maximum The highest limit in milli amperes (mA).
+         * @return True if the range contains at least one supported limit, false otherwise.
+         */
+        bool setRange(uint16_t minimum, uint16_t maximum);
+
+        /**
+         * @brief Sets how long the input has to stay valid before the next higher limit is tried.
+         * It should cover the time the charger takes to ramp up its current. The default is 2s.
+         * @param duration The settle time in milliseconds (ms).
+         */
+        void setSettleTime(uint32_t duration);
+
+        /**
+         * @brief Sets how long a limit is held before the next higher one is tried again. The default is 10 minutes.
+         * @param duration The reprobe interval in milliseconds (ms).
+         */
+        void setReprobeInterval(uint32_t duration);
+
+        /**
+         * @brief Starts tuning from the minimum limit.
+         * @param now The current time in milliseconds (ms), e.g. millis().
+         * @return True if the limit was set, false otherwise.
+         */
+        bool begin(uint32_t now);
+
+        /**
+         * @brief Samples the input and adjusts the limit. Call this often, e.g. from the loop,
+         * so that short sags are noticed. The limit is changed at most once per call.
+         * @param now The current time in milliseconds (ms), e.g. millis().
+         */
+        void update(uint32_t now);
+
+        /**
+         * @brief Returns the input current limit that is set.
+         * @return The limit in milli amperes (mA).
+         */
+        uint16_t limit();
+
+        /**
+         * @brief Returns the lowest limit at which the input sagged since the last reprobe.
+         * @return The limit in milli amperes (mA), 0 if the input didn't sag.
+         */
+        uint16_t ceiling();
+
+        /**
+         * @brief Returns the phase of the tuner.
+         * @return The state.
+         */
+        InputCurrentTunerState state();
+
+        /**
+         * @brief Returns the number of sags since begin().
+         * @return The number of sags.
+         */
+        uint32_t sags();
+
+    private:
+        /**
+         * Sets the limit and restarts the settle time.
+         */
+        void applyLimit(uint16_t current, uint32_t now);
+
+        /**
+         * Returns the next supported limit above the given one, or the given one if there is none within the range.
+         */
+        uint16_t nextLimit(uint16_t current);
+
+        /**
+         * Returns the next supported limit below the given one, or the given one if there is none within the range.
+         */
+        uint16_t previousLimit(uint16_t current);
+
+        InputCurrentControl *control;
+        uint16_t minimumLimit = 100;
+        uint16_t maximumLimit = 1500;
+        uint32_t settleTime = 2000;
+        uint32_t reprobeInterval = 600000;
+
+        InputCurrentTunerState currentState = InputCurrentTunerState::noSource;
+        uint16_t currentLimit = 0;
+        uint16_t sagLimit = 0;
+        uint32_t lastChange = 0;
+        uint32_t sagCount = 0;
+};
+
+#endif
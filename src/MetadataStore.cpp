@@ -0,0 +1,486 @@
+#include "MetadataStore.h"
+
+// Every sector starts with two header slots of the size of a record: the format header is written
+// after the sector was erased, the open header when the sector becomes part of the log.
+constexpr uint32_t SECTOR_MAGIC = 0x564B4D50; // "PMKV"
+constexpr uint8_t FORMAT_HEADER_OFFSET = 0;
+constexpr uint8_t OPEN_HEADER_OFFSET = METADATA_RECORD_SIZE;
+constexpr uint8_t FIRST_RECORD_OFFSET = 2 * METADATA_RECORD_SIZE;
+
+// Layout of a record, multi-byte values are little endian
+constexpr uint8_t RECORD_KEY_OFFSET = 0;
+constexpr uint8_t RECORD_LENGTH_OFFSET = 2;
+constexpr uint8_t RECORD_VALUE_OFFSET = 3;
+constexpr uint8_t RECORD_CHECKSUM_OFFSET = 14;
+constexpr uint8_t RECORD_TOMBSTONE_LENGTH = 0x80; // Marks a removed key
+
+constexpr uint8_t SECTOR_UNFORMATTED = 0;
+constexpr uint8_t SECTOR_ERASED = 1;
+constexpr uint8_t SECTOR_USED = 2;
+
+static void writeValue(uint8_t *data, uint32_t value, uint8_t size) {
+    for (uint8_t index = 0; index < size; ++index) {
+        data[index] = value >> (8 * index);
+    }
+}
+
+static uint32_t readValue(const uint8_t *data, uint8_t size) {
+    uint32_t value = 0;
+    for (uint8_t index = 0; index < size; ++index) {
+        value |= static_cast<uint32_t>(data[index]) << (8 * index);
+    }
+    return value;
+}
+
+MetadataStoreBase::MetadataStoreBase(BlockStorage &storage, MetadataIndexEntry *index, uint16_t indexCapacity)
+    : storage(&storage), index(index), indexCapacity(indexCapacity) {
+}
+
+bool MetadataStoreBase::begin() {
+    ready = false;
+    sectorSize = storage->eraseSize();
+    uint32_t programSize = storage->programSize();
+    if (sectorSize < FIRST_RECORD_OFFSET + METADATA_RECORD_SIZE || sectorSize % METADATA_RECORD_SIZE != 0) {
+        return false;
+    }
+    if (programSize == 0 || METADATA_RECORD_SIZE % programSize != 0) {
+        return false;
+    }
+    sectorCount = min(storage->size() / sectorSize, static_cast<uint32_t>(UINT16_MAX));
+    if (sectorCount < 2) {
+        return false;
+    }
+
+    usedSectors = 0;
+    sequence = 0;
+    indexedKeys = 0;
+    uint32_t oldestSequence = UINT32_MAX;
+    for (uint16_t sector = 0; sector < sectorCount; ++sector) {
+        uint32_t eraseCount = 0;
+        uint32_t sectorSequence = 0;
+        uint8_t state = sectorState(sector, eraseCount, sectorSequence);
+
+        if (state == SECTOR_UNFORMATTED && !formatSector(sector, eraseCount)) {
+            return false;
+        }
+        if (state != SECTOR_USED) {
+            continue;
+        }
+
+        ++usedSectors;
+        if (sectorSequence >= sequence) {
+            sequence = sectorSequence;
+            headSector = sector;
+        }
+        if (sectorSequence < oldestSequence) {
+            oldestSequence = sectorSequence;
+            oldestSector = sector;
+        }
+    }
+
+    ready = true;
+    if (usedSectors == 0) {
+        return openSector(0);
+    }
+
+    // The head ends at its first erased record
+    uint8_t record[METADATA_RECORD_SIZE];
+    for (headOffset = FIRST_RECORD_OFFSET; headOffset < sectorSize; headOffset += METADATA_RECORD_SIZE) {
+        if (!storage->read(sectorAddress(headSector) + headOffset, record, METADATA_RECORD_SIZE)) {
+            ready = false;
+            return false;
+        }
+        if (isErased(record)) {
+            break;
+        }
+    }
+
+    ready = buildIndex();
+    return ready;
+}
+
+bool MetadataStoreBase::write(uint16_t key, const void *value, uint8_t length) {
+    if (!ready || key == METADATA_INVALID_KEY || length > METADATA_MAX_VALUE_SIZE) {
+        return false;
+    }
+    ++counters.writes;
+
+    // Don't wear the memory with a value that didn't change
+    uint8_t record[METADATA_RECORD_SIZE];
+    if (findRecord(key, record) >= 0) {
+        if (record[RECORD_LENGTH_OFFSET] == length && memcmp(record + RECORD_VALUE_OFFSET, value, length) == 0) {
+            ++counters.unchangedWrites;
+            return true;
+        }
+    } else if (indexedKeys == indexCapacity) {
+        return false; // A new key that doesn't fit into the index
+    }
+
+    memset(record, 0, METADATA_RECORD_SIZE);
+    writeValue(record + RECORD_KEY_OFFSET, key, 2);
+    record[RECORD_LENGTH_OFFSET] = length;
+    memcpy(record + RECORD_VALUE_OFFSET, value, length);
+    writeValue(record + RECORD_CHECKSUM_OFFSET, checksum(record, RECORD_CHECKSUM_OFFSET), 2);
+    return appendRecord(record);
+}
+
+int16_t MetadataStoreBase::read(uint16_t key, void *value, uint8_t size) {
+    uint8_t record[METADATA_RECORD_SIZE];
+    if (!ready || findRecord(key, record) < 0) {
+        return -1;
+    }
+
+    uint8_t length = record[RECORD_LENGTH_OFFSET];
+    memcpy(value, record + RECORD_VALUE_OFFSET, min(length, size));
+    return length;
+}
+
+bool MetadataStoreBase::remove(uint16_t key) {
+    if (!ready) {
+        return false;
+    }
+    ++counters.writes;
+
+    uint8_t record[METADATA_RECORD_SIZE];
+    if (findRecord(key, record) < 0) {
+        ++counters.unchangedWrites;
+        return true;
+    }
+
+    memset(record, 0, METADATA_RECORD_SIZE);
+    writeValue(record + RECORD_KEY_OFFSET, key, 2);
+    record[RECORD_LENGTH_OFFSET] = RECORD_TOMBSTONE_LENGTH;
+    writeValue(record + RECORD_CHECKSUM_OFFSET, checksum(record, RECORD_CHECKSUM_OFFSET), 2);
+    return appendRecord(record);
+}
+
+bool MetadataStoreBase::compact() {
+    if (!ready || usedSectors < 2) {
+        return false;
+    }
+
+    // Open a new head if the current one can't take the records, but never use up the last erased sector
+    uint32_t oldestAddress = sectorAddress(oldestSector);
+    uint8_t record[METADATA_RECORD_SIZE];
+    uint32_t currentBytes = 0;
+    for (uint32_t offset = FIRST_RECORD_OFFSET; offset < sectorSize; offset += METADATA_RECORD_SIZE) {
+        if (storage->read(oldestAddress + offset, record, METADATA_RECORD_SIZE) && isCurrent(oldestAddress + offset, record)) {
+            currentBytes += METADATA_RECORD_SIZE;
+        }
+    }
+    if (currentBytes == sectorSize - FIRST_RECORD_OFFSET) {
+        return false; // All records are current, compacting wouldn't free anything
+    }
+    if (headOffset + currentBytes > sectorSize) {
+        int32_t sector = nextErasedSector();
+        if (sectorCount - usedSectors < 2 || sector < 0 || !openSector(sector)) {
+            return false;
+        }
+    }
+    return compactOldest();
+}
+
+MetadataStoreStats MetadataStoreBase::stats() {
+    MetadataStoreStats result = counters;
+    result.minimumEraseCount = UINT32_MAX;
+    for (uint16_t sector = 0; sector < sectorCount; ++sector) {
+        uint32_t eraseCount = 0;
+        uint32_t sectorSequence = 0;
+        sectorState(sector, eraseCount, sectorSequence);
+        result.minimumEraseCount = min(result.minimumEraseCount, eraseCount);
+        result.maximumEraseCount = max(result.maximumEraseCount, eraseCount);
+    }
+    if (result.minimumEraseCount == UINT32_MAX) {
+        result.minimumEraseCount = 0;
+    }
+    return result;
+}
+
+int32_t MetadataStoreBase::findRecord(uint16_t key, uint8_t *record) {
+    int32_t position = indexOf(key);
+    if (position < 0 || !storage->read(index[position].address, record, METADATA_RECORD_SIZE)) {
+        return -1;
+    }
+    return index[position].address;
+}
+
+bool MetadataStoreBase::isCurrent(uint32_t address, const uint8_t *record) {
+    if (!isValid(record) || record[RECORD_LENGTH_OFFSET] == RECORD_TOMBSTONE_LENGTH) {
+        return false;
+    }
+    int32_t position = indexOf(readValue(record + RECORD_KEY_OFFSET, 2));
+    return position >= 0 && index[position].address == address;
+}
+
+int32_t MetadataStoreBase::indexOf(uint16_t key) {
+    // The index only holds a few keys, a linear search is as fast as keeping it sorted
+    for (uint16_t position = 0; position < indexedKeys; ++position) {
+        if (index[position].key == key) {
+            return position;
+        }
+    }
+    return -1;
+}
+
+bool MetadataStoreBase::indexRecord(const uint8_t *record, uint32_t address) {
+    uint16_t key = readValue(record + RECORD_KEY_OFFSET, 2);
+    int32_t position = indexOf(key);
+
+    if (record[RECORD_LENGTH_OFFSET] == RECORD_TOMBSTONE_LENGTH) {
+        if (position >= 0) {
+            index[position] = index[--indexedKeys];
+        }
+        return true;
+    }
+    if (position < 0) {
+        if (indexedKeys == indexCapacity) {
+            return false;
+        }
+        position = indexedKeys++;
+        index[position].key = key;
+    }
+    index[position].address = address;
+    return true;
+}
+
+bool MetadataStoreBase::buildIndex() {
+    // The log runs through the used sectors in ring order, newer records replace older ones in the index
+    uint8_t record[METADATA_RECORD_SIZE];
+    uint16_t sector = oldestSector;
+    for (uint16_t visited = 0; visited < usedSectors; ++visited) {
+        uint32_t address = sectorAddress(sector);
+        uint32_t end = sector == headSector ? headOffset : sectorSize;
+        for (uint32_t offset = FIRST_RECORD_OFFSET; offset < end; offset += METADATA_RECORD_SIZE) {
+            if (!storage->read(address + offset, record, METADATA_RECORD_SIZE)) {
+                return false;
+            }
+            if (isValid(record) && !indexRecord(record, address + offset)) {
+                return false; // More keys than the index holds
+            }
+        }
+
+        for (uint16_t step = 1; step < sectorCount; ++step) {
+            uint16_t nextSector = (sector + step) % sectorCount;
+            uint32_t eraseCount;
+            uint32_t sectorSequence;
+            if (sectorState(nextSector, eraseCount, sectorSequence) == SECTOR_USED) {
+                sector = nextSector;
+                break;
+            }
+        }
+    }
+    return true;
+}
+
+bool MetadataStoreBase::appendRecord(const uint8_t *record) {
+    // Every attempt to open a sector compacts at most one, so the store is full if none has room after a full round
+    for (uint16_t attempt = 0; attempt <= sectorCount; ++attempt) {
+        if (headOffset + METADATA_RECORD_SIZE <= sectorSize) {
+            uint32_t address = sectorAddress(headSector) + headOffset;
+            if (!storage->program(address, record, METADATA_RECORD_SIZE)) {
+                return false;
+            }
+            headOffset += METADATA_RECORD_SIZE;
+            counters.programmedBytes += METADATA_RECORD_SIZE;
+            return indexRecord(record, address);
+        }
+        // Opening the last spare sector compacts the oldest one. If no record of the log is stale,
+        // that only moves the records around and erases sectors without making room.
+        if (sectorCount - usedSectors < 2 && !canReclaim()) {
+            return false;
+        }
+        if (!advanceHead()) {
+            return false;
+        }
+    }
+    return false;
+}
+
+bool MetadataStoreBase::canReclaim() {
+    // Start with the oldest sector, it's the next one to be compacted
+    uint16_t sector = oldestSector;
+    for (uint16_t visited = 0; visited < usedSectors; ++visited) {
+        if (hasStaleRecords(sector)) {
+            return true;
+        }
+
+        for (uint16_t step = 1; step < sectorCount; ++step) {
+            uint16_t nextSector = (sector + step) % sectorCount;
+            uint32_t eraseCount;
+            uint32_t sectorSequence;
+            if (sectorState(nextSector, eraseCount, sectorSequence) == SECTOR_USED) {
+                sector = nextSector;
+                break;
+            }
+        }
+    }
+    return false;
+}
+
+bool MetadataStoreBase::hasStaleRecords(uint16_t sector) {
+    uint32_t address = sectorAddress(sector);
+    uint32_t end = sector == headSector ? headOffset : sectorSize;
+    uint8_t record[METADATA_RECORD_SIZE];
+    for (uint32_t offset = FIRST_RECORD_OFFSET; offset < end; offset += METADATA_RECORD_SIZE) {
+        // An erased record was left behind when compact() opened a new head early, it's free after compaction too
+        if (!storage->read(address + offset, record, METADATA_RECORD_SIZE) || isErased(record) || !isCurrent(address + offset, record)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool MetadataStoreBase::advanceHead() {
+    int32_t sector = nextErasedSector();
+    if (sector < 0 || !openSector(sector)) {
+        return false;
+    }
+
+    // Keep one sector erased, so that there is always room to compact into
+    if (usedSectors == sectorCount) {
+        return compactOldest();
+    }
+    return true;
+}
+
+bool MetadataStoreBase::compactOldest() {
+    if (usedSectors < 2) {
+        return false;
+    }
+
+    uint32_t oldestAddress = sectorAddress(oldestSector);
+    uint8_t record[METADATA_RECORD_SIZE];
+    for (uint32_t offset = FIRST_RECORD_OFFSET; offset < sectorSize; offset += METADATA_RECORD_SIZE) {
+        if (!storage->read(oldestAddress + offset, record, METADATA_RECORD_SIZE)) {
+            return false;
+        }
+        if (isErased(record)) {
+            break;
+        }
+        if (!isCurrent(oldestAddress + offset, record)) {
+            continue; // Overwritten, removed or torn
+        }
+        uint32_t address = sectorAddress(headSector) + headOffset;
+        if (headOffset + METADATA_RECORD_SIZE > sectorSize || !storage->program(address, record, METADATA_RECORD_SIZE)) {
+            return false;
+        }
+        headOffset += METADATA_RECORD_SIZE;
+        counters.programmedBytes += METADATA_RECORD_SIZE;
+        indexRecord(record, address); // The key is indexed already, so this can't fail
+    }
+
+    uint32_t eraseCount = 0;
+    uint32_t sectorSequence = 0;
+    sectorState(oldestSector, eraseCount, sectorSequence);
+    if (!formatSector(oldestSector, eraseCount + 1)) {
+        return false;
+    }
+    ++counters.compactions;
+    --usedSectors;
+
+    // The next sector of the log is the new oldest one
+    for (uint16_t step = 1; step < sectorCount; ++step) {
+        uint16_t sector = (oldestSector + step) % sectorCount;
+        if (sectorState(sector, eraseCount, sectorSequence) == SECTOR_USED) {
+            oldestSector = sector;
+            break;
+        }
+    }
+    return true;
+}
+
+int32_t MetadataStoreBase::nextErasedSector() {
+    for (uint16_t step = 1; step < sectorCount; ++step) {
+        uint16_t sector = (headSector + step) % sectorCount;
+        uint32_t eraseCount;
+        uint32_t sectorSequence;
+        if (sectorState(sector, eraseCount, sectorSequence) == SECTOR_ERASED) {
+            return sector;
+        }
+    }
+    return -1;
+}
+
+bool MetadataStoreBase::formatSector(uint16_t sector, uint32_t eraseCount) {
+    if (!storage->erase(sectorAddress(sector), sectorSize)) {
+        return false;
+    }
+    ++counters.erases;
+
+    uint8_t header[METADATA_RECORD_SIZE] = {};
+    writeValue(header, SECTOR_MAGIC, 4);
+    writeValue(header + 4, eraseCount, 4);
+    writeValue(header + RECORD_CHECKSUM_OFFSET, checksum(header, RECORD_CHECKSUM_OFFSET), 2);
+    if (!storage->program(sectorAddress(sector) + FORMAT_HEADER_OFFSET, header, METADATA_RECORD_SIZE)) {
+        return false;
+    }
+    counters.programmedBytes += METADATA_RECORD_SIZE;
+    return true;
+}
+
+bool MetadataStoreBase::openSector(uint16_t sector) {
+    uint8_t header[METADATA_RECORD_SIZE] = {};
+    writeValue(header, sequence + 1, 4);
+    writeValue(header + RECORD_CHECKSUM_OFFSET, checksum(header, RECORD_CHECKSUM_OFFSET), 2);
+    if (!storage->program(sectorAddress(sector) + OPEN_HEADER_OFFSET, header, METADATA_RECORD_SIZE)) {
+        return false;
+    }
+    counters.programmedBytes += METADATA_RECORD_SIZE;
+
+    ++sequence;
+    headSector = sector;
+    headOffset = FIRST_RECORD_OFFSET;
+    if (++usedSectors == 1) {
+        oldestSector = sector;
+    }
+    return true;
+}
+
+uint8_t MetadataStoreBase::sectorState(uint16_t sector, uint32_t &eraseCount, uint32_t &sectorSequence) {
+    uint8_t header[METADATA_RECORD_SIZE];
+    eraseCount = 0;
+    if (!storage->read(sectorAddress(sector) + FORMAT_HEADER_OFFSET, header, METADATA_RECORD_SIZE) || !isValid(header) || readValue(header, 4) != SECTOR_MAGIC) {
+        return SECTOR_UNFORMATTED;
+    }
+    eraseCount = readValue(header + 4, 4);
+
+    if (!storage->read(sectorAddress(sector) + OPEN_HEADER_OFFSET, header, METADATA_RECORD_SIZE)) {
+        return SECTOR_UNFORMATTED;
+    }
+    if (isErased(header)) {
+        return SECTOR_ERASED;
+    }
+    if (!isValid(header)) {
+        return SECTOR_UNFORMATTED; // Power was lost while the sector was opened, it doesn't hold any records yet
+    }
+    sectorSequence = readValue(header, 4);
+    return SECTOR_USED;
+}
+
+uint32_t MetadataStoreBase::sectorAddress(uint16_t sector) {
+    return static_cast<uint32_t>(sector) * sectorSize;
+}
+
+bool MetadataStoreBase::isErased(const uint8_t *record) {
+    for (uint8_t index = 0; index < METADATA_RECORD_SIZE; ++index) {
+        if (record[index] != 0xFF) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool MetadataStoreBase::isValid(const uint8_t *record) {
+    return !isErased(record) && readValue(record + RECORD_CHECKSUM_OFFSET, 2) == checksum(record, RECORD_CHECKSUM_OFFSET);
+}
+
+uint16_t MetadataStoreBase::checksum(const uint8_t *data, uint8_t length) {
+    uint16_t crc = 0xFFFF;
+    for (uint8_t index = 0; index < length; ++index) {
+        crc ^= static_cast<uint16_t>(data[index]) << 8;
+        for (uint8_t bit = 0; bit < 8; ++bit) {
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+        }
+    }
+    return crc;
+}
@@ -0,0 +1,300 @@
+#ifndef METADATA_STORE_H
+#define METADATA_STORE_H
+
+#include "Arduino.h"
+#include "BlockStorage.h"
+
+constexpr uint8_t METADATA_RECORD_SIZE = 16; // Bytes of a record, the program size of the memory must divide it
+constexpr uint8_t METADATA_MAX_VALUE_SIZE = 11; // Bytes of a value that fit into a record
+constexpr uint16_t METADATA_INVALID_KEY = 0xFFFF; // Reserved, an erased record reads as this key
+
+/**
+ * @brief Counters that show how much the MetadataStore wore the memory.
+ */
+struct MetadataStoreStats {
+    /// @brief The number of values written by the application, including removals.
+    uint32_t writes = 0;
+
+    /// @brief The number of writes that were skipped because the value didn't change.
+    uint32_t unchangedWrites = 0;
+
+    /// @brief The number of bytes programmed, including sector headers and records moved by compactions.
+    uint32_t programmedBytes = 0;
+
+    /// @brief The number of sector erases.
+    uint32_t erases = 0;
+
+    /// @brief The number of sectors that were compacted.
+    uint32_t compactions = 0;
+
+    /// @brief The lowest erase count of all sectors.
+    uint32_t minimumEraseCount = 0;
+
+    /// @brief The highest erase count of all sectors. Close to minimumEraseCount if the wear is levelled well.
+    uint32_t maximumEraseCount = 0;
+
+    /**
+     * @brief The bytes programmed per byte of records written by the application.
+     * 1 means that nothing but the records themselves was programmed.
+     * @return The write amplification, 0 before the first write.
+     */
+    float writeAmplification() const {
+        uint32_t recordBytes = (writes - unchangedWrites) * METADATA_RECORD_SIZE;
+        return recordBytes > 0 ? static_cast<float>(programmedBytes) / recordBytes : 0.0f;
+    }
+};
+
+/**
+ * @brief Where the newest record of a key is stored, see MetadataStoreBase.
+ */
+struct MetadataIndexEntry {
+    uint16_t key;
+    uint32_t address;
+};
+
+/**
+ * @brief A small key/value store for state that has to survive a reset, e.g. learned parameters or counters.
+ *
+ * Instead of rewriting a flash sector for every update, the store appends a fixed-size record with a CRC to a log.
+ * Reading a key returns the newest valid record, so a record that was torn by a power loss is ignored.
+ * The sectors are used one after the other in a ring, which spreads the erases evenly over all of them.
+ * One sector is always kept erased: when the log reaches it, the oldest sector is compacted by moving
+ * its records that are still current to the head of the log and erasing it.
+ *
+ * Writing a value that didn't change doesn't touch the memory, so it's fine to save state unconditionally.
+ *
+ * begin() reads the log once and keeps the address of the newest record of each key in RAM,
+ * so reading a key, writing it and compacting a sector don't have to search the log.
+ * Use MetadataStore with the number of keys the application stores.
+ */
+class MetadataStoreBase {
+    public:
+        /**
+         * @brief Reads the log from the memory and indexes the keys. Sectors that don't hold a valid log are erased.
+         * @return True if the store is ready, false if the memory doesn't fit, can't be accessed
+         * or holds more keys than the index.
+         */
+        bool begin();
+
+        /**
+         * @brief Writes a value.
+         * @param key The key, any value except METADATA_INVALID_KEY.
+         * @param value The value.
+         * @param length The length of the value, up to METADATA_MAX_VALUE_SIZE bytes.
+         * The memory is full when all records are current, that's detected without erasing anything, so retrying doesn't wear it.
+         * @return True if the value was written or didn't change, false if the memory or the index is full or the memory failed.
+         */
+        bool write(uint16_t key, const void *value, uint8_t length);
+
+        /**
+         * @brief Reads a value.
+         * @param key The key.
+         * @param value The buffer that receives the value.
+         * @param size The size of the buffer, a longer value is truncated.
+         * @return The length of the stored value, -1 if the key wasn't found.
+         */
+        int16_t read(uint16_t key, void *value, uint8_t size);
+
+        /**
+         * @brief Removes a value.
+         * @param key The key.
+         * @return True if the value was removed or didn't exist, false if the memory is full or failed.
+         */
+        bool remove(uint16_t key);
+
+        /**
+         * @brief Writes a value of a trivially copyable type, e.g. a float or a small struct.
+         * @param key The key.
+         * @param value The value.
+         * @return True if the value was written or didn't change, false otherwise.
+         */
+        template <typename T>
+        bool put(uint16_t key, const T &value) {
+            static_assert(sizeof(T) <= METADATA_MAX_VALUE_SIZE, "The value doesn't fit into a record");
+            return write(key, &value, sizeof(T));
+        }
+
+        /**
+         * @brief Reads a value of a trivially copyable type.
+         * @param key The key.
+         * @param value Receives the value, left unchanged if the key wasn't found or the length doesn't match.
+         * @return True if the value was read, false otherwise.
+         */
+        template <typename T>
+        bool get(uint16_t key, T &value) {
+            T storedValue;
+            if (read(key, &storedValue, sizeof(T)) != sizeof(T)) {
+                return false;
+            }
+            value = storedValue;
+            return true;
+        }
+
+        /**
+         * @brief Compacts the oldest sector now, so that a later write doesn't have to. Call it when there is time, e.g. before standby.
+         * @return True if a sector was compacted, false if the log only spans one sector, the memory is full
+         * or all records of the oldest sector are current, so compacting it wouldn't free anything.
+         */
+        bool compact();
+
+        /**
+         * @brief Returns the wear counters, including the erase counts of all sectors.
+         * @return The statistics.
+         */
+        MetadataStoreStats stats();
+
+    protected:
+        /**
+         * @brief Constructs a new MetadataStoreBase object.
+         * @param storage The memory to use. It needs at least two sectors of at least 48 bytes.
+         * @param index The index of the keys.
+         * @param indexCapacity The number of keys the index can hold.
+         */
+        MetadataStoreBase(BlockStorage &storage, MetadataIndexEntry *index, uint16_t indexCapacity);
+
+    private:
+        /**
+         * Reads the newest record of a key.
+         * @param key The key to look for.
+         * @param record Receives the record.
+         * @return The address of the record, or -1 if the key isn't stored.
+         */
+        int32_t findRecord(uint16_t key, uint8_t *record);
+
+        /**
+         * Returns true if the record at the given address is the newest one of its key and not a removal.
+         */
+        bool isCurrent(uint32_t address, const uint8_t *record);
+
+        /**
+         * Returns the position of a key in the index, or -1 if it isn't stored.
+         */
+        int32_t indexOf(uint16_t key);
+
+        /**
+         * Points the key of a valid record to the given address, or drops it if the record is a removal.
+         * @return False if the key is new and the index is full.
+         */
+        bool indexRecord(const uint8_t *record, uint32_t address);
+
+        /**
+         * Rebuilds the index from the log, from the oldest record to the newest.
+         */
+        bool buildIndex();
+
+        /**
+         * Appends an encoded record to the head of the log, opening new sectors as needed.
+         */
+        bool appendRecord(const uint8_t *record);
+
+        /**
+         * Returns true if compacting the log frees at least one record, i.e. a used sector holds a stale or erased record.
+         */
+        bool canReclaim();
+
+        /**
+         * Returns true if the sector holds a record that is overwritten, removed, torn or erased.
+         */
+        bool hasStaleRecords(uint16_t sector);
+
+        /**
+         * Makes the next erased sector the head of the log and compacts the oldest sector if no erased sector is left.
+         */
+        bool advanceHead();
+
+        /**
+         * Moves the current records of the oldest sector to the head and erases it.
+         * The head must have room for all of them.
+         */
+        bool compactOldest();
+
+        /**
+         * Returns the first erased sector after the head, or -1 if there is none.
+         */
+        int32_t nextErasedSector();
+
+        /**
+         * Erases a sector and writes its format header.
+         */
+        bool formatSector(uint16_t sector, uint32_t eraseCount);
+
+        /**
+         * Writes the open header of an erased sector and makes it the head of the log.
+         */
+        bool openSector(uint16_t sector);
+
+        /**
+         * Returns the state of a sector from its headers.
+         * @param sector The sector.
+         * @param eraseCount Receives the erase count if the sector is formatted.
+         * @param sectorSequence Receives the sequence number if the sector is open.
+         * @return 0 if not formatted, 1 if erased, 2 if it's part of the log.
+         */
+        uint8_t sectorState(uint16_t sector, uint32_t &eraseCount, uint32_t &sectorSequence);
+
+        /**
+         * Returns the address of the first byte of a sector.
+         */
+        uint32_t sectorAddress(uint16_t sector);
+
+        /**
+         * Returns true if the record is completely erased.
+         */
+        static bool isErased(const uint8_t *record);
+
+        /**
+         * Returns true if the CRC of the record matches.
+         */
+        static bool isValid(const uint8_t *record);
+
+        /**
+         * Computes the CRC-16/CCITT of the given bytes.
+         */
+        static uint16_t checksum(const uint8_t *data, uint8_t length);
+
+        BlockStorage *storage;
+        MetadataIndexEntry *index;
+        uint16_t indexCapacity;
+        uint16_t indexedKeys = 0;
+        uint32_t sectorSize = 0;
+        uint16_t sectorCount = 0;
+        uint16_t usedSectors = 0;
+        uint16_t oldestSector = 0;
+        uint16_t headSector = 0;
+        uint32_t headOffset = 0; // Offset of the next free record in the head sector
+        uint32_t sequence = 0; // Sequence number of the head sector
+        bool ready = false;
+        MetadataStoreStats counters;
+};
+
+/**
+ * @brief A MetadataStore that can hold the given number of keys.
+ * Each key takes 8 bytes of RAM for the index.
+ *
+ *     uint8_t buffer[8 * 1024];
+ *     RamBlockStorage storage(buffer, sizeof(buffer), 1024);
+ *     MetadataStore<16> store(storage);
+ *
+ *     store.begin();
+ *     store.put(WAKE_COUNTER_KEY, wakeCounter + 1);
+ */
+template <uint16_t Keys = 32>
+class MetadataStore : public MetadataStoreBase {
+    public:
+        /**
+         * @brief Constructs a new MetadataStore object.
+         * @param storage The memory to use. It needs at least two sectors of at least 48 bytes.
+         */
+        MetadataStore(BlockStorage &storage) : MetadataStoreBase(storage, entries, Keys) {
+        }
+
+        // The index points into this object
+        MetadataStore(const MetadataStore &) = delete;
+        MetadataStore &operator=(const MetadataStore &) = delete;
+
+    private:
+        static_assert(Keys > 0, "The store needs room for at least one key");
+        MetadataIndexEntry entries[Keys];
+};
+
+#endif
@@ -0,0 +1,223 @@
+#include "MetricMonitor.h"
+
+MetricMonitor::MetricMonitor() {
+    for (uint8_t metric = 0; metric < BATTERY_METRIC_COUNT; ++metric) {
+        firstSubscription[metric] = -1;
+    }
+}
+
+int16_t MetricMonitor::above(BatteryMetric metric, float threshold, float hysteresis, void (*callback)(BatteryMetric metric, float value)) {
+    return add(MetricCondition::above, metric, threshold, hysteresis, callback);
+}
+
+int16_t MetricMonitor::below(BatteryMetric metric, float threshold, float hysteresis, void (*callback)(BatteryMetric metric, float value)) {
+    return add(MetricCondition::below, metric, threshold, hysteresis, callback);
+}
+
+int16_t MetricMonitor::change(BatteryMetric metric, float delta, void (*callback)(BatteryMetric metric, float value)) {
+    if (delta <= 0) {
+        return -1;
+    }
+    return add(MetricCondition::change, metric, 0.0f, delta, callback);
+}
+
+bool MetricMonitor::remove(uint8_t id) {
+    if (id >= MAX_METRIC_SUBSCRIPTIONS || !used[id]) {
+        return false;
+    }
+
+    // Unlink the subscription from the chain of its metric
+    uint8_t metric = static_cast<uint8_t>(subscriptions[id].metric);
+    int8_t *link = &firstSubscription[metric];
+    while (*link != static_cast<int8_t>(id)) {
+        link = &subscriptions[*link].next;
+    }
+    *link = subscriptions[id].next;
+
+    used[id] = false;
+    --subscriptionCount;
+    updateBand(metric);
+    return true;
+}
+
+uint8_t MetricMonitor::count() {
+    return subscriptionCount;
+}
+
+uint8_t MetricMonitor::subscribedMetrics() {
+    uint8_t metrics = 0;
+    for (uint8_t metric = 0; metric < BATTERY_METRIC_COUNT; ++metric) {
+        if (firstSubscription[metric] >= 0) {
+            bitSet(metrics, metric);
+        }
+    }
+    return metrics;
+}
+
+uint8_t MetricMonitor::update(const BatterySample &sample) {
+    uint8_t fired = 0;
+
+    for (uint8_t metric = 0; metric < BATTERY_METRIC_COUNT; ++metric) {
+        if (firstSubscription[metric] < 0) {
+            continue;
+        }
+
+        float value = sample.values[metric];
+        bool unchanged = value == lastValue[metric] || (value > bandLow[metric] && value < bandHigh[metric]);
+        lastValue[metric] = value;
+        if (unchanged && !bitRead(dirtyMetrics, metric)) {
+            continue;
+        }
+        bitClear(dirtyMetrics, metric);
+
+        // A callback may remove any subscription, so the chain is copied before the first one runs
+        int8_t chain[MAX_METRIC_SUBSCRIPTIONS];
+        uint8_t chainLength = 0;
+        for (int8_t index = firstSubscription[metric]; index >= 0; index = subscriptions[index].next) {
+            chain[chainLength++] = index;
+        }
+
+        for (uint8_t position = 0; position < chainLength; ++position) {
+            uint8_t index = chain[position];
+            // Skip subscriptions that were removed by an earlier callback, or replaced by one of another metric
+            if (!used[index] || subscriptions[index].metric != static_cast<BatteryMetric>(metric)) {
+                continue;
+            }
+            Subscription &subscription = subscriptions[index];
+            ++evaluationCount;
+            if (evaluate(subscription, value)) {
+                subscription.callback(static_cast<BatteryMetric>(metric), value);
+                ++fired;
+            }
+        }
+        updateBand(metric);
+    }
+    return fired;
+}
+
+uint8_t MetricMonitor::update(Battery &battery) {
+    uint8_t metrics = subscribedMetrics();
+    // Without a battery the fuel gauge reads return -1, which must not cross any threshold
+    if (metrics == 0 || !battery.isConnected()) {
+        return 0;
+    }
+    return update(BatterySample::read(battery, metrics));
+}
+
+uint32_t MetricMonitor::evaluations() {
+    return evaluationCount;
+}
+
+int16_t MetricMonitor::add(MetricCondition condition, BatteryMetric metric, float threshold, float margin,
+                           void (*callback)(BatteryMetric metric, float value)) {
+    if (callback == nullptr || margin < 0 || static_cast<uint8_t>(metric) >= BATTERY_METRIC_COUNT) {
+        return -1;
+    }
+
+    int8_t id = -1;
+    for (uint8_t index = 0; index < MAX_METRIC_SUBSCRIPTIONS; ++index) {
+        if (!used[index]) {
+            id = index;
+            break;
+        }
+    }
+    if (id < 0) {
+        return -1;
+    }
+
+    Subscription &subscription = subscriptions[id];
+    subscription.condition = condition;
+    subscription.metric = metric;
+    subscription.armed = condition != MetricCondition::change;
+    subscription.threshold = threshold;
+    subscription.margin = margin;
+    subscription.callback = callback;
+    subscription.next = -1;
+
+    // Append to the chain, so the callbacks run in the order of subscription
+    uint8_t metricIndex = static_cast<uint8_t>(metric);
+    int8_t *link = &firstSubscription[metricIndex];
+    while (*link >= 0) {
+        link = &subscriptions[*link].next;
+    }
+    *link = id;
+
+    used[id] = true;
+    ++subscriptionCount;
+    // The new subscription hasn't seen a value yet, so the next update must not skip the metric
+    bitSet(dirtyMetrics, metricIndex);
+    return id;
+}
+
+bool MetricMonitor::evaluate(Subscription &subscription, float value) {
+    switch (subscription.condition) {
+        case MetricCondition::above:
+            if (subscription.armed && value > subscription.threshold) {
+                subscription.armed = false;
+                return true;
+            }
+            if (!subscription.armed && value < subscription.threshold - subscription.margin) {
+                subscription.armed = true;
+            }
+            return false;
+
+        case MetricCondition::below:
+            if (subscription.armed && value < subscription.threshold) {
+                subscription.armed = false;
+                return true;
+            }
+            if (!subscription.armed && value > subscription.threshold + subscription.margin) {
+                subscription.armed = true;
+            }
+            return false;
+
+        case MetricCondition::change:
+            if (!subscription.armed) {
+                // The first value is the reference
+                subscription.threshold = value;
+                subscription.armed = true;
+                return false;
+            }
+            if (fabs(value - subscription.threshold) >= subscription.margin) {
+                subscription.threshold = value;
+                return true;
+            }
+            return false;
+    }
+    return false;
+}
+
+void MetricMonitor::updateBand(uint8_t metric) {
+    // The band is open on both ends: a value on its edge is evaluated, which is conservative
+    float low = -INFINITY;
+    float high = INFINITY;
+
+    for (int8_t index = firstSubscription[metric]; index >= 0; index = subscriptions[index].next) {
+        const Subscription &subscription = subscriptions[index];
+        switch (subscription.condition) {
+            case MetricCondition::above:
+                if (subscription.armed) {
+                    high = min(high, subscription.threshold);
+                } else {
+                    low = max(low, subscription.threshold - subscription.margin);
+                }
+                break;
+
+            case MetricCondition::below:
+                if (subscription.armed) {
+                    low = max(low, subscription.threshold);
+                } else {
+                    high = min(high, subscription.threshold + subscription.margin);
+                }
+                break;
+
+            case MetricCondition::change:
+                low = max(low, subscription.threshold - subscription.margin);
+                high = min(high, subscription.threshold + subscription.margin);
+                break;
+        }
+    }
+
+    bandLow[metric] = low;
+    bandHigh[metric] = high;
+}
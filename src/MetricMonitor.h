@@ -0,0 +1,168 @@
+#ifndef METRIC_MONITOR_H
+#define METRIC_MONITOR_H
+
+#include "Arduino.h"
+#include "Battery.h"
+#include "TelemetryRollup.h"
+
+constexpr uint8_t MAX_METRIC_SUBSCRIPTIONS = 16; // Maximum number of subscriptions a MetricMonitor can hold
+
+/**
+ * @brief The condition a subscription of the MetricMonitor waits for.
+ */
+enum class MetricCondition : uint8_t {
+    /// @brief The value rose above the threshold. Fires again after it fell below the threshold minus the hysteresis.
+    above = 0,
+
+    /// @brief The value fell below the threshold. Fires again after it rose above the threshold plus the hysteresis.
+    below = 1,
+
+    /// @brief The value changed by at least the delta since the subscription last fired.
+    change = 2
+};
+
+/**
+ * @brief Calls functions when battery metrics cross a threshold or change by a given amount.
+ *
+ * All subscriptions are evaluated on the same sample, so consumers that each want to know about
+ * their own condition share a single read of the fuel gauge. The subscriptions of a metric are
+ * chained together, and for each metric the monitor keeps the band in which none of them can fire.
+ * A metric whose value didn't change or stayed within its band is skipped with a single comparison,
+ * so the cost of an update scales with the metrics that moved, not with the number of subscriptions.
+ *
+ *     MetricMonitor monitor;
+ *
+ *     void lowBattery(BatteryMetric metric, float value) {
+ *         Serial.println("Battery low: " + String(value) + "%");
+ *     }
+ *
+ *     void setup() {
+ *         monitor.below(BatteryMetric::percentage, 20, 2, lowBattery);
+ *     }
+ *
+ *     void loop() {
+ *         monitor.update(battery);
+ *     }
+ */
+class MetricMonitor {
+    public:
+        /**
+         * @brief Constructs a new MetricMonitor object without any subscriptions.
+         */
+        MetricMonitor();
+
+        /**
+         * @brief Subscribes to a metric rising above a threshold.
+         * If the first value is already above the threshold, the callback is called right away.
+         * @param metric The metric.
+         * @param threshold The threshold.
+         * @param hysteresis How far the value has to fall below the threshold before the subscription fires again.
+         * @param callback The function to call with the metric and its value.
+         * @return The identifier of the subscription, or -1 if the table is full or the parameters are invalid.
+         */
+        int16_t above(BatteryMetric metric, float threshold, float hysteresis, void (*callback)(BatteryMetric metric, float value));
+
+        /**
+         * @brief Subscribes to a metric falling below a threshold, e.g. the state of charge crossing 20%.
+         * If the first value is already below the threshold, the callback is called right away.
+         * @param metric The metric.
+         * @param threshold The threshold.
+         * @param hysteresis How far the value has to rise above the threshold before the subscription fires again.
+         * @param callback The function to call with the metric and its value.
+         * @return The identifier of the subscription, or -1 if the table is full or the parameters are invalid.
+         */
+        int16_t below(BatteryMetric metric, float threshold, float hysteresis, void (*callback)(BatteryMetric metric, float value));
+
+        /**
+         * @brief Subscribes to a metric changing by at least a given amount, e.g. the current by 5mA.
+         * The change is measured from the value at which the subscription last fired, so slow drifts are reported too.
+         * @param metric The metric.
+         * @param delta The change. Must be greater than 0.
+         * @param callback The function to call with the metric and its value.
+         * @return The identifier of the subscription, or -1 if the table is full or the parameters are invalid.
+         */
+        int16_t change(BatteryMetric metric, float delta, void (*callback)(BatteryMetric metric, float value));
+
+        /**
+         * @brief Removes a subscription.
+         * @param id The identifier returned when subscribing.
+         * @return True if the subscription was removed, false if it doesn't exist.
+         */
+        bool remove(uint8_t id);
+
+        /**
+         * @brief Returns the number of subscriptions.
+         * @return The number of subscriptions.
+         */
+        uint8_t count();
+
+        /**
+         * @brief Returns the metrics that have at least one subscription, e.g. to only read those.
+         * @return Bit mask of the metrics, indexed by BatteryMetric.
+         */
+        uint8_t subscribedMetrics();
+
+        /**
+         * @brief Evaluates the subscriptions on a sample and calls the callbacks of those that fire.
+         * A callback may remove any subscription, removed subscriptions aren't evaluated anymore.
+         * Don't pass samples read while no battery was connected, their values are -1.
+         * @param sample The sample, only the subscribed metrics are used.
+         * @return The number of callbacks that were called.
+         */
+        uint8_t update(const BatterySample &sample);
+
+        /**
+         * @brief Reads the subscribed metrics from the fuel gauge and evaluates the subscriptions.
+         * Nothing is evaluated while no battery is connected.
+         * @param battery The battery to read.
+         * @return The number of callbacks that were called.
+         */
+        uint8_t update(Battery &battery);
+
+        /**
+         * @brief Returns how many subscriptions were evaluated individually since the monitor was created,
+         * i.e. how often the early-outs didn't apply.
+         * @return The number of evaluations.
+         */
+        uint32_t evaluations();
+
+    private:
+        struct Subscription {
+            MetricCondition condition;
+            BatteryMetric metric;
+            bool armed; // For MetricCondition::change, whether the reference value was set
+            float threshold; // The reference value for MetricCondition::change
+            float margin; // The hysteresis, or the delta for MetricCondition::change
+            void (*callback)(BatteryMetric metric, float value);
+            int8_t next; // The next subscription of the same metric, -1 at the end of the chain
+        };
+
+        /**
+         * Adds a subscription to the table and the chain of its metric.
+         */
+        int16_t add(MetricCondition condition, BatteryMetric metric, float threshold, float margin,
+                    void (*callback)(BatteryMetric metric, float value));
+
+        /**
+         * Evaluates one subscription and updates its state.
+         * @return True if it fired, false otherwise.
+         */
+        bool evaluate(Subscription &subscription, float value);
+
+        /**
+         * Recomputes the band of a metric in which none of its subscriptions can fire.
+         */
+        void updateBand(uint8_t metric);
+
+        Subscription subscriptions[MAX_METRIC_SUBSCRIPTIONS];
+        bool used[MAX_METRIC_SUBSCRIPTIONS] = {};
+        int8_t firstSubscription[BATTERY_METRIC_COUNT];
+        float lastValue[BATTERY_METRIC_COUNT] = {};
+        float bandLow[BATTERY_METRIC_COUNT] = {};
+        float bandHigh[BATTERY_METRIC_COUNT] = {};
+        uint8_t dirtyMetrics = 0; // Bit mask of the metrics that must be evaluated even if they didn't move
+        uint8_t subscriptionCount = 0;
+        uint32_t evaluationCount = 0;
+};
+
+#endif
@@ -0,0 +1,178 @@
+#include "PeakTracker.h"
+
+PercentileEstimator::PercentileEstimator(float quantile) : targetQuantile(constrain(quantile, 0.0f, 1.0f)) {
+}
+
+void PercentileEstimator::add(float value) {
+    // Collect the first values as they are, they initialise the markers
+    if (samples < PERCENTILE_MARKERS) {
+        uint8_t index = samples++;
+        while (index > 0 && heights[index - 1] > value) {
+            heights[index] = heights[index - 1];
+            --index;
+        }
+        heights[index] = value;
+
+        if (samples == PERCENTILE_MARKERS) {
+            float quantile = targetQuantile;
+            float initialPositions[PERCENTILE_MARKERS] = {0.0f, 2 * quantile, 4 * quantile, 2 + 2 * quantile, 4.0f};
+            for (uint8_t marker = 0; marker < PERCENTILE_MARKERS; ++marker) {
+                positions[marker] = marker;
+                desiredPositions[marker] = initialPositions[marker];
+            }
+        }
+        return;
+    }
+    ++samples;
+
+    // Find the cell the value falls into, extending the outer markers if needed
+    uint8_t cell;
+    if (value < heights[0]) {
+        heights[0] = value;
+        cell = 0;
+    } else if (value >= heights[PERCENTILE_MARKERS - 1]) {
+        heights[PERCENTILE_MARKERS - 1] = value;
+        cell = PERCENTILE_MARKERS - 2;
+    } else {
+        cell = 0;
+        while (value >= heights[cell + 1]) {
+            ++cell;
+        }
+    }
+
+    const float increments[PERCENTILE_MARKERS] = {0.0f, targetQuantile / 2, targetQuantile, (1 + targetQuantile) / 2, 1.0f};
+    for (uint8_t marker = 0; marker < PERCENTILE_MARKERS; ++marker) {
+        if (marker > cell) {
+            positions[marker] += 1.0f;
+        }
+        desiredPositions[marker] += increments[marker];
+    }
+
+    // Move the inner markers towards their desired positions
+    for (uint8_t marker = 1; marker < PERCENTILE_MARKERS - 1; ++marker) {
+        float offset = desiredPositions[marker] - positions[marker];
+        bool moveUp = offset >= 1.0f && positions[marker + 1] - positions[marker] > 1.0f;
+        bool moveDown = offset <= -1.0f && positions[marker - 1] - positions[marker] < -1.0f;
+        if (!moveUp && !moveDown) {
+            continue;
+        }
+
+        int8_t step = moveUp ? 1 : -1;
+        float below = positions[marker] - positions[marker - 1];
+        float above = positions[marker + 1] - positions[marker];
+        float parabolic = heights[marker] + step / (positions[marker + 1] - positions[marker - 1])
+            * ((below + step) * (heights[marker + 1] - heights[marker]) / above
+            + (above - step) * (heights[marker] - heights[marker - 1]) / below);
+
+        if (heights[marker - 1] < parabolic && parabolic < heights[marker + 1]) {
+            heights[marker] = parabolic;
+        } else {
+            // The parabola overshoots a neighbour, fall back to linear interpolation
+            uint8_t neighbour = marker + step;
+            heights[marker] += step * (heights[neighbour] - heights[marker]) / (positions[neighbour] - positions[marker]);
+        }
+        positions[marker] += step;
+    }
+}
+
+float PercentileEstimator::value() const {
+    if (samples == 0) {
+        return 0.0f;
+    }
+    if (samples < PERCENTILE_MARKERS) {
+        // The values are still sorted, use the nearest rank
+        uint8_t index = static_cast<uint8_t>(targetQuantile * (samples - 1) + 0.5f);
+        return heights[index];
+    }
+    return heights[2];
+}
+
+uint32_t PercentileEstimator::count() const {
+    return samples;
+}
+
+float PercentileEstimator::quantile() const {
+    return targetQuantile;
+}
+
+void PercentileEstimator::reset() {
+    samples = 0;
+}
+
+void PeakTracker::setWindow(uint32_t duration) {
+    this->window = duration;
+}
+
+void PeakTracker::setPercentile(float quantile) {
+    percentileEnabled = quantile > 0.0f;
+    estimator = PercentileEstimator(quantile);
+    current.percentile = 0.0f;
+}
+
+void PeakTracker::add(float value, uint32_t now) {
+    if (!started) {
+        current.windowStart = now;
+        started = true;
+    } else if (window > 0 && now - current.windowStart >= window) {
+        // Start the new window where the previous one ended, so the windows stay aligned
+        reset(current.windowStart + (now - current.windowStart) / window * window);
+    }
+
+    if (current.count == 0) {
+        current.minimum = value;
+        current.minimumTime = now;
+        current.maximum = value;
+        current.maximumTime = now;
+    } else if (value < current.minimum) {
+        current.minimum = value;
+        current.minimumTime = now;
+    } else if (value > current.maximum) {
+        current.maximum = value;
+        current.maximumTime = now;
+    }
+    ++current.count;
+
+    if (percentileEnabled) {
+        estimator.add(value);
+        current.percentile = estimator.value();
+    }
+}
+
+PeakStatistics PeakTracker::statistics() {
+    return current;
+}
+
+PeakStatistics PeakTracker::previousWindow() {
+    return previous;
+}
+
+void PeakTracker::reset(uint32_t now) {
+    previous = current;
+    current = PeakStatistics();
+    current.windowStart = now;
+    started = true;
+    estimator.reset();
+}
+
+BatteryPeakTracker::BatteryPeakTracker(Battery &battery) : battery(&battery) {
+}
+
+void BatteryPeakTracker::update() {
+    uint32_t now = millis();
+    voltageTracker.add(battery->voltage(), now);
+    currentTracker.add(battery->highResolutionCurrent(), now);
+}
+
+PeakTracker &BatteryPeakTracker::voltage() {
+    return voltageTracker;
+}
+
+PeakTracker &BatteryPeakTracker::current() {
+    return currentTracker;
+}
+
+void BatteryPeakTracker::reset() {
+    uint32_t now = millis();
+    voltageTracker.reset(now);
+    currentTracker.reset(now);
+}
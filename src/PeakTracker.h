@@ -0,0 +1,186 @@
+#ifndef PEAK_TRACKER_H
+#define PEAK_TRACKER_H
+
+#include "Arduino.h"
+#include "Battery.h"
+
+constexpr uint8_t PERCENTILE_MARKERS = 5; // Markers of the P² estimator
+
+/**
+ * @brief Estimates a percentile of a stream of values in constant memory.
+ *
+ * Uses the P² algorithm (Jain and Chlamtac, 1985): five markers follow the minimum, the maximum,
+ * the percentile and two points in between, and are moved along a piecewise parabolic curve
+ * as values arrive. No values are stored, so a long window costs as little as a short one.
+ */
+class PercentileEstimator {
+    public:
+        /**
+         * @brief Constructs a new PercentileEstimator object.
+         * @param quantile The percentile to estimate as a fraction, e.g. 0.99 for the 99th percentile.
+         */
+        PercentileEstimator(float quantile = 0.5f);
+
+        /**
+         * @brief Adds a value.
+         * @param value The value.
+         */
+        void add(float value);
+
+        /**
+         * @brief Returns the estimate. It's exact for up to five values.
+         * @return The estimated percentile, 0 if no value was added.
+         */
+        float value() const;
+
+        /**
+         * @brief Returns the number of values added since the last reset.
+         * @return The number of values.
+         */
+        uint32_t count() const;
+
+        /**
+         * @brief Returns the percentile that is estimated.
+         * @return The percentile as a fraction.
+         */
+        float quantile() const;
+
+        /**
+         * @brief Discards all values.
+         */
+        void reset();
+
+    private:
+        float targetQuantile;
+        uint32_t samples = 0;
+        float heights[PERCENTILE_MARKERS] = {};
+        float positions[PERCENTILE_MARKERS] = {};
+        float desiredPositions[PERCENTILE_MARKERS] = {};
+};
+
+/**
+ * @brief The extremes of a signal within a window.
+ */
+struct PeakStatistics {
+    /// @brief The smallest value.
+    float minimum = 0.0f;
+
+    /// @brief The time of the smallest value in milliseconds (ms), as returned by millis().
+    uint32_t minimumTime = 0;
+
+    /// @brief The largest value.
+    float maximum = 0.0f;
+
+    /// @brief The time of the largest value in milliseconds (ms), as returned by millis().
+    uint32_t maximumTime = 0;
+
+    /// @brief The estimated percentile set with PeakTracker::setPercentile(), 0 if it's disabled.
+    float percentile = 0.0f;
+
+    /// @brief The number of values in the window. The other values are invalid if it's 0.
+    uint32_t count = 0;
+
+    /// @brief The start of the window in milliseconds (ms).
+    uint32_t windowStart = 0;
+};
+
+/**
+ * @brief Tracks the smallest and largest value of a signal and when they occurred.
+ * The tracker can start a new window automatically after a fixed duration, the statistics of the
+ * window that ended are kept until the next one ends.
+ */
+class PeakTracker {
+    public:
+        /**
+         * @brief Starts a new window automatically after the given duration.
+         * @param duration The length of a window in milliseconds (ms), 0 to only start a new window with reset().
+         */
+        void setWindow(uint32_t duration);
+
+        /**
+         * @brief Additionally estimates a percentile of the values, e.g. to tell a rare spike from a frequent load.
+         * @param quantile The percentile as a fraction, e.g. 0.99, or 0 to disable the estimate.
+         */
+        void setPercentile(float quantile);
+
+        /**
+         * @brief Adds a value.
+         * @param value The value.
+         * @param now The time of the value in milliseconds (ms), e.g. millis().
+         */
+        void add(float value, uint32_t now);
+
+        /**
+         * @brief Returns the statistics of the current window.
+         * @return The statistics.
+         */
+        PeakStatistics statistics();
+
+        /**
+         * @brief Returns the statistics of the window that ended last.
+         * @return The statistics, their count is 0 if no window ended yet.
+         */
+        PeakStatistics previousWindow();
+
+        /**
+         * @brief Ends the current window and starts a new one.
+         * @param now The start of the new window in milliseconds (ms).
+         */
+        void reset(uint32_t now);
+
+    private:
+        uint32_t window = 0;
+        bool started = false;
+        bool percentileEnabled = false;
+        PeakStatistics current;
+        PeakStatistics previous;
+        PercentileEstimator estimator;
+};
+
+/**
+ * @brief Tracks the extremes of the battery voltage and current at the full resolution of the fuel gauge.
+ *
+ * Battery::minimumVoltage() and Battery::maximumCurrent() are kept by the fuel gauge itself, but with a resolution
+ * of only 20mV and 160mA. This tracker is fed from the VCell and Current registers instead, which have a resolution
+ * of 78µV and 0.156mA. The fuel gauge updates them once per task period (175ms in active mode), so update() should
+ * be called at least that often to catch short load spikes, e.g. from the loop or a timer.
+ * The current keeps the sign of the fuel gauge, negative while discharging, so the highest load is the minimum of a window.
+ */
+class BatteryPeakTracker {
+    public:
+        /**
+         * @brief Constructs a new BatteryPeakTracker object.
+         * @param battery The battery to read.
+         */
+        BatteryPeakTracker(Battery &battery);
+
+        /**
+         * @brief Reads the voltage and current from the fuel gauge and adds them.
+         */
+        void update();
+
+        /**
+         * @brief Returns the tracker of the voltage in volts (V), e.g. to configure its window.
+         * @return The voltage tracker.
+         */
+        PeakTracker &voltage();
+
+        /**
+         * @brief Returns the tracker of the current in milli amperes (mA), e.g. to configure its window.
+         * The current is negative while discharging, see Battery::highResolutionCurrent().
+         * @return The current tracker.
+         */
+        PeakTracker &current();
+
+        /**
+         * @brief Starts a new window for both trackers.
+         */
+        void reset();
+
+    private:
+        Battery *battery;
+        PeakTracker voltageTracker;
+        PeakTracker currentTracker;
+};
+
+#endif
@@ -0,0 +1,120 @@
+#include "PowerDomain.h"
+
+PowerDomain::PowerDomain(Board &board) : board(&board) {
+    if (CurrentBoardTraits::hasCameraRails) {
+        // The camera needs all three LDOs, acquiring LDO1 powers up the whole camera
+        addDependency(PowerRail::ldo1, PowerRail::ldo2);
+        addDependency(PowerRail::ldo1, PowerRail::ldo3);
+    }
+}
+
+bool PowerDomain::acquire(PowerRail rail) {
+    uint8_t index = static_cast<uint8_t>(rail);
+    if (userCount[index] == UINT8_MAX) {
+        return false;
+    }
+
+    // A rail that is still on during its idle timeout already holds its dependencies
+    if (!enabled[index]) {
+        for (uint8_t dependency = 0; dependency < POWER_RAIL_COUNT; ++dependency) {
+            if (!bitRead(dependencies[index], dependency)) {
+                continue;
+            }
+            if (!acquire(static_cast<PowerRail>(dependency))) {
+                // Give back what was acquired so far, the rail stays off
+                releaseDependencies(index);
+                return false;
+            }
+            bitSet(heldDependencies[index], dependency);
+        }
+        board->setRailEnabled(rail, true);
+        enabled[index] = true;
+    }
+
+    ++userCount[index];
+    return true;
+}
+
+bool PowerDomain::release(PowerRail rail) {
+    uint8_t index = static_cast<uint8_t>(rail);
+    if (userCount[index] == 0) {
+        return false;
+    }
+
+    if (--userCount[index] > 0) {
+        return true;
+    }
+
+    if (idleTimeout[index] == 0) {
+        turnOff(index);
+    } else {
+        releaseTime[index] = millis();
+    }
+    return true;
+}
+
+uint8_t PowerDomain::users(PowerRail rail) {
+    return userCount[static_cast<uint8_t>(rail)];
+}
+
+bool PowerDomain::isEnabled(PowerRail rail) {
+    return enabled[static_cast<uint8_t>(rail)];
+}
+
+void PowerDomain::setIdleTimeout(PowerRail rail, uint32_t timeout) {
+    idleTimeout[static_cast<uint8_t>(rail)] = timeout;
+}
+
+bool PowerDomain::addDependency(PowerRail rail, PowerRail dependency) {
+    uint8_t index = static_cast<uint8_t>(rail);
+    uint8_t dependencyIndex = static_cast<uint8_t>(dependency);
+
+    if (index == dependencyIndex || dependsOn(dependencyIndex, index)) {
+        return false;
+    }
+
+    dependencies[index] |= (1 << dependencyIndex);
+    return true;
+}
+
+void PowerDomain::update() {
+    unsigned long now = millis();
+
+    // Dependencies are released by turnOff(), so a single pass also handles rails
+    // whose last dependent was just turned off as long as they have no timeout themselves.
+    for (uint8_t index = 0; index < POWER_RAIL_COUNT; ++index) {
+        if (enabled[index] && userCount[index] == 0 && now - releaseTime[index] >= idleTimeout[index]) {
+            turnOff(index);
+        }
+    }
+}
+
+void PowerDomain::turnOff(uint8_t index) {
+    board->setRailEnabled(static_cast<PowerRail>(index), false);
+    enabled[index] = false;
+
+    // Release the dependencies after the dependent rail is off
+    releaseDependencies(index);
+}
+
+void PowerDomain::releaseDependencies(uint8_t index) {
+    // Only the dependencies that were acquired for the rail, one added while it was on was never acquired
+    for (uint8_t dependency = 0; dependency < POWER_RAIL_COUNT; ++dependency) {
+        if (bitRead(heldDependencies[index], dependency)) {
+            bitClear(heldDependencies[index], dependency);
+            release(static_cast<PowerRail>(dependency));
+        }
+    }
+}
+
+bool PowerDomain::dependsOn(uint8_t index, uint8_t target) {
+    for (uint8_t dependency = 0; dependency < POWER_RAIL_COUNT; ++dependency) {
+        if (!bitRead(dependencies[index], dependency)) {
+            continue;
+        }
+        if (dependency == target || dependsOn(dependency, target)) {
+            return true;
+        }
+    }
+    return false;
+}
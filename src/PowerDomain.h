@@ -0,0 +1,111 @@
+#ifndef POWER_DOMAIN_H
+#define POWER_DOMAIN_H
+
+#include "Board.h"
+
+/**
+ * @brief Shares the PMIC power rails between several drivers.
+ *
+ * Each driver acquires the rails it needs and releases them when it's done.
+ * A rail is turned on when its first user acquires it and turned off as soon as
+ * the last user releases it, or after an optional idle timeout.
+ * Rails can depend on other rails which are then acquired and released together with them.
+ * On the Nicla Vision LDO1 depends on LDO2 and LDO3 by default so that acquiring LDO1 powers the camera.
+ *
+ * Use a single instance per sketch and don't mix it with the plain on/off switches of the Board class
+ * for the same rails, otherwise the reference counts no longer reflect the state of the rails.
+ */
+class PowerDomain {
+    public:
+        /**
+         * @brief Constructs a new PowerDomain object.
+         * @param board The board whose power rails are managed.
+         */
+        PowerDomain(Board &board);
+
+        /**
+         * @brief Acquires a power rail and the rails it depends on.
+         * The rail is turned on if it wasn't in use before.
+         * @param rail The power rail to acquire.
+         * @return True if the rail was acquired, false if the maximum number of users of the rail
+         * or one of its dependencies was reached. Nothing is acquired in that case.
+         */
+        bool acquire(PowerRail rail);
+
+        /**
+         * @brief Releases a power rail previously acquired with acquire().
+         * When the last user releases the rail it's turned off, either immediately
+         * or once the idle timeout has expired. The rails it depends on are released afterwards.
+         * @param rail The power rail to release.
+         * @return True if the rail was released, false if it wasn't acquired.
+         */
+        bool release(PowerRail rail);
+
+        /**
+         * @brief Returns the number of users currently holding a power rail.
+         * Rails acquired as a dependency count their dependents as users.
+         * @param rail The power rail to check.
+         * @return The number of users of the rail.
+         */
+        uint8_t users(PowerRail rail);
+
+        /**
+         * @brief Checks if a power rail is turned on by this power domain.
+         * This includes rails without users whose idle timeout hasn't expired yet.
+         * @param rail The power rail to check.
+         * @return True if the rail is turned on, false otherwise.
+         */
+        bool isEnabled(PowerRail rail);
+
+        /**
+         * @brief Sets the time a power rail stays on after its last user released it.
+         * This avoids toggling the rail when it's released and acquired again in quick succession.
+         * The timeout is only enforced when calling update().
+         * @param rail The power rail to configure.
+         * @param timeout The idle timeout in milliseconds. 0 turns the rail off immediately (default).
+         */
+        void setIdleTimeout(PowerRail rail, uint32_t timeout);
+
+        /**
+         * @brief Makes a power rail depend on another one.
+         * Whenever the rail is acquired, the dependency is acquired first.
+         * When the rail is turned off, the dependency is released afterwards.
+         * A dependency added while the rail is on takes effect the next time the rail is turned on.
+         * @param rail The dependent power rail.
+         * @param dependency The power rail that needs to be on while the dependent rail is on.
+         * @return True if the dependency was added, false if it would create a circular dependency.
+         */
+        bool addDependency(PowerRail rail, PowerRail dependency);
+
+        /**
+         * @brief Turns off the idle rails whose timeout has expired.
+         * Call this regularly, e.g. from loop(), when using idle timeouts.
+         */
+        void update();
+
+    private:
+        /**
+         * Turns off a rail which has no more users and releases its dependencies.
+         */
+        void turnOff(uint8_t index);
+
+        /**
+         * Releases the dependencies that were acquired when the rail at the given index was turned on.
+         */
+        void releaseDependencies(uint8_t index);
+
+        /**
+         * Checks if the rail at the given index depends on the target rail, directly or through other rails.
+         */
+        bool dependsOn(uint8_t index, uint8_t target);
+
+        Board *board;
+        uint8_t userCount[POWER_RAIL_COUNT] = {0};
+        uint8_t dependencies[POWER_RAIL_COUNT] = {0}; // Bit mask of the rails each rail depends on
+        uint8_t heldDependencies[POWER_RAIL_COUNT] = {0}; // Bit mask of the dependencies each rail acquired when it was turned on
+        uint32_t idleTimeout[POWER_RAIL_COUNT] = {0};
+        uint32_t releaseTime[POWER_RAIL_COUNT] = {0};
+        bool enabled[POWER_RAIL_COUNT] = {false};
+};
+
+#endif
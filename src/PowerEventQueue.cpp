@@ -0,0 +1,129 @@
+#include "PowerEventQueue.h"
+
+PowerEventQueueBase::PowerEventQueueBase(PowerEvent *events, uint16_t size) : events(events), size(size) {
+}
+
+bool PowerEventQueueBase::push(const PowerEvent &event) {
+    uint16_t currentHead = head.load(std::memory_order_relaxed);
+    uint16_t nextHead = (currentHead + 1) % size;
+    if (nextHead == tail.load(std::memory_order_acquire)) {
+        droppedCount.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    events[currentHead] = event;
+    head.store(nextHead, std::memory_order_release); // Publishes the slot to the consumer
+    return true;
+}
+
+bool PowerEventQueueBase::push(PowerEventType type, uint32_t value) {
+    PowerEvent event;
+    event.type = type;
+    event.value = value;
+    event.time = millis();
+    return push(event);
+}
+
+bool PowerEventQueueBase::pop(PowerEvent &event) {
+    uint16_t currentTail = tail.load(std::memory_order_relaxed);
+    if (currentTail == head.load(std::memory_order_acquire)) {
+        return false;
+    }
+
+    event = events[currentTail];
+    tail.store((currentTail + 1) % size, std::memory_order_release); // Hands the slot back to the producer
+    return true;
+}
+
+bool PowerEventQueueBase::isEmpty() const {
+    return tail.load(std::memory_order_acquire) == head.load(std::memory_order_acquire);
+}
+
+uint16_t PowerEventQueueBase::count() const {
+    uint16_t currentHead = head.load(std::memory_order_acquire);
+    uint16_t currentTail = tail.load(std::memory_order_acquire);
+    return (currentHead + size - currentTail) % size;
+}
+
+uint32_t PowerEventQueueBase::dropped() const {
+    return droppedCount.load(std::memory_order_relaxed);
+}
+
+PowerEventDispatcher::PowerEventDispatcher(PowerEventQueueBase &queue) : queue(&queue) {
+    setCoalescing(PowerEventType::stateOfChargeChanged, true);
+}
+
+bool PowerEventDispatcher::on(PowerEventType type, void (*handler)(const PowerEvent &event)) {
+    if (handler == nullptr || handlerCount >= MAX_EVENT_HANDLERS) {
+        return false;
+    }
+
+    handlers[handlerCount++] = {type, handler};
+    return true;
+}
+
+bool PowerEventDispatcher::remove(void (*handler)(const PowerEvent &event)) {
+    bool removed = false;
+    uint8_t kept = 0;
+    for (uint8_t index = 0; index < handlerCount; ++index) {
+        if (handlers[index].function == handler) {
+            removed = true;
+            continue;
+        }
+        handlers[kept++] = handlers[index];
+    }
+    handlerCount = kept;
+    return removed;
+}
+
+void PowerEventDispatcher::setCoalescing(PowerEventType type, bool enabled) {
+    uint8_t typeBit = 1 << static_cast<uint8_t>(type);
+    if (enabled) {
+        coalescingMask |= typeBit;
+    } else {
+        coalescingMask &= ~typeBit;
+    }
+}
+
+uint16_t PowerEventDispatcher::dispatch() {
+    PowerEvent latest[POWER_EVENT_TYPE_COUNT];
+    uint8_t pendingMask = 0;
+    uint16_t delivered = 0;
+
+    // Only take the events that are queued now, so a producer that keeps pushing can't starve the loop
+    uint16_t available = queue->count();
+    PowerEvent event;
+    while (available-- > 0 && queue->pop(event)) {
+        uint8_t typeBit = 1 << static_cast<uint8_t>(event.type);
+        if (coalescingMask & typeBit) {
+            if (pendingMask & typeBit) {
+                ++coalescedCount;
+            }
+            latest[static_cast<uint8_t>(event.type)] = event;
+            pendingMask |= typeBit;
+            continue;
+        }
+        deliver(event);
+        ++delivered;
+    }
+
+    for (uint8_t type = 0; type < POWER_EVENT_TYPE_COUNT; ++type) {
+        if (pendingMask & (1 << type)) {
+            deliver(latest[type]);
+            ++delivered;
+        }
+    }
+    return delivered;
+}
+
+uint32_t PowerEventDispatcher::coalesced() {
+    return coalescedCount;
+}
+
+void PowerEventDispatcher::deliver(const PowerEvent &event) {
+    for (uint8_t index = 0; index < handlerCount; ++index) {
+        if (handlers[index].type == event.type) {
+            handlers[index].function(event);
+        }
+    }
+}
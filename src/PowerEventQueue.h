@@ -0,0 +1,210 @@
+#ifndef POWER_EVENT_QUEUE_H
+#define POWER_EVENT_QUEUE_H
+
+#include "Arduino.h"
+#include <atomic>
+
+constexpr uint8_t MAX_EVENT_HANDLERS = 8; // Maximum number of handlers a PowerEventDispatcher can hold
+
+/**
+ * @brief The kinds of events delivered by the PowerEventDispatcher.
+ */
+enum class PowerEventType : uint8_t {
+    /// @brief The fuel gauge asserted its ALRT pin, the value holds the Status register if it was read.
+    gaugeAlert = 0,
+
+    /// @brief The PMIC asserted its interrupt pin, the value holds the interrupt flags if they were read.
+    chargerInterrupt = 1,
+
+    /// @brief The board switched between battery and external power, the value is 1 if external power is present.
+    powerSourceChanged = 2,
+
+    /// @brief The state of charge changed, the value holds the new percentage.
+    stateOfChargeChanged = 3,
+
+    /// @brief An event of the application, the value is defined by it.
+    custom = 4
+};
+
+constexpr uint8_t POWER_EVENT_TYPE_COUNT = 5;
+
+/**
+ * @brief An event pushed to a PowerEventQueue.
+ */
+struct PowerEvent {
+    /// @brief The kind of event.
+    PowerEventType type = PowerEventType::custom;
+
+    /// @brief The payload, its meaning depends on the type.
+    uint32_t value = 0;
+
+    /// @brief The time at which the event occurred in milliseconds (ms), as returned by millis().
+    uint32_t time = 0;
+};
+
+/**
+ * @brief A queue of power events that an interrupt handler can push into without locks or allocation.
+ *
+ * The queue is a ring buffer with one producer and one consumer: only one context may push, e.g. a single
+ * interrupt handler or a thread, and only one may pop, usually the loop through a PowerEventDispatcher.
+ * The producer only writes the head index and the consumer only writes the tail index, both with
+ * release semantics, so the slot contents are visible before the index that publishes them.
+ * Events from several interrupts need one queue each, or the interrupts must not preempt each other.
+ *
+ * The size of the ring is set by PowerEventQueue, this class holds the logic that is shared by all sizes.
+ */
+class PowerEventQueueBase {
+    public:
+        /**
+         * @brief Pushes an event. Safe to call from an interrupt handler.
+         * @param event The event.
+         * @return True if the event was queued, false if the queue is full and the event was dropped.
+         */
+        bool push(const PowerEvent &event);
+
+        /**
+         * @brief Pushes an event with the current time. Safe to call from an interrupt handler.
+         * @param type The kind of event.
+         * @param value The payload.
+         * @return True if the event was queued, false if the queue is full and the event was dropped.
+         */
+        bool push(PowerEventType type, uint32_t value = 0);
+
+        /**
+         * @brief Removes the oldest event. Must only be called by the consumer.
+         * @param event Receives the event.
+         * @return True if an event was removed, false if the queue is empty.
+         */
+        bool pop(PowerEvent &event);
+
+        /**
+         * @brief Checks if there are no events, e.g. to decide whether the board may sleep.
+         * @return True if the queue is empty, false otherwise.
+         */
+        bool isEmpty() const;
+
+        /**
+         * @brief Returns the number of queued events. It may be outdated as soon as it returns.
+         * @return The number of events.
+         */
+        uint16_t count() const;
+
+        /**
+         * @brief Returns the number of events that were dropped because the queue was full.
+         * @return The number of dropped events.
+         */
+        uint32_t dropped() const;
+
+    protected:
+        /**
+         * Sets the storage of the ring. One slot stays free to tell a full queue from an empty one.
+         */
+        PowerEventQueueBase(PowerEvent *events, uint16_t size);
+
+    private:
+        PowerEvent *events;
+        uint16_t size;
+        std::atomic<uint16_t> head{0}; // Written by the producer only
+        std::atomic<uint16_t> tail{0}; // Written by the consumer only
+        std::atomic<uint32_t> droppedCount{0};
+};
+
+/**
+ * @brief A PowerEventQueue that can hold the given number of events.
+ *
+ *     PowerEventQueue<16> events;
+ *
+ *     void onAlert() {
+ *         events.push(PowerEventType::gaugeAlert);
+ *     }
+ */
+template <uint16_t Capacity = 16>
+class PowerEventQueue : public PowerEventQueueBase {
+    public:
+        PowerEventQueue() : PowerEventQueueBase(slots, Capacity + 1) {
+        }
+
+        // The ring points into this object
+        PowerEventQueue(const PowerEventQueue &) = delete;
+        PowerEventQueue &operator=(const PowerEventQueue &) = delete;
+
+    private:
+        static_assert(Capacity > 0 && Capacity < UINT16_MAX, "The capacity must be between 1 and 65534 events");
+        PowerEvent slots[Capacity + 1];
+};
+
+/**
+ * @brief Runs handlers for the events of a PowerEventQueue in the loop.
+ *
+ * Interrupt handlers only push events, the handlers then run outside of the interrupt context
+ * where they may use the I2C bus, Serial or allocate memory. Between events the loop can sleep,
+ * see PowerEventQueueBase::isEmpty().
+ *
+ * Types with coalescing enabled only deliver their latest event of each dispatch() call, e.g. a burst of
+ * state of charge changes results in a single handler call with the final percentage. Coalesced events are
+ * delivered after all other events of the same call. Coalescing is enabled for
+ * PowerEventType::stateOfChargeChanged by default.
+ */
+class PowerEventDispatcher {
+    public:
+        /**
+         * @brief Constructs a new PowerEventDispatcher object.
+         * @param queue The queue to take the events from. The dispatcher is its only consumer.
+         */
+        PowerEventDispatcher(PowerEventQueueBase &queue);
+
+        /**
+         * @brief Registers a handler for a type of events. Several handlers may be registered for the same type,
+         * they run in the order of registration.
+         * @param type The kind of events.
+         * @param handler The function to call with each event.
+         * @return True if the handler was registered, false if the table is full.
+         */
+        bool on(PowerEventType type, void (*handler)(const PowerEvent &event));
+
+        /**
+         * @brief Unregisters a handler from all types it was registered for.
+         * @param handler The function.
+         * @return True if the handler was registered, false otherwise.
+         */
+        bool remove(void (*handler)(const PowerEvent &event));
+
+        /**
+         * @brief Enables or disables coalescing for a type of events.
+         * @param type The kind of events.
+         * @param enabled True to only deliver the latest event of each dispatch() call, false to deliver all of them.
+         */
+        void setCoalescing(PowerEventType type, bool enabled);
+
+        /**
+         * @brief Takes all queued events and runs their handlers. Call this from the loop.
+         * Events pushed while the handlers run are left for the next call.
+         * @return The number of events that were delivered.
+         */
+        uint16_t dispatch();
+
+        /**
+         * @brief Returns the number of events that were skipped because a later event of the same type replaced them.
+         * @return The number of coalesced events.
+         */
+        uint32_t coalesced();
+
+    private:
+        /**
+         * Runs the handlers of one event.
+         */
+        void deliver(const PowerEvent &event);
+
+        struct Handler {
+            PowerEventType type;
+            void (*function)(const PowerEvent &event);
+        };
+
+        PowerEventQueueBase *queue;
+        Handler handlers[MAX_EVENT_HANDLERS];
+        uint8_t handlerCount = 0;
+        uint8_t coalescingMask = 0;
+        uint32_t coalescedCount = 0;
+};
+
+#endif
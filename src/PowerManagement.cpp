@@ -0,0 +1,47 @@
+#include "PowerManagement.h"
+
+PowerManagement::PowerManagement(Board &board, Battery &battery) : board(&board), battery(&battery) {
+}
+
+bool PowerManagement::begin(bool enforceReload) {
+    phaseTimings = PowerManagementTimings();
+    unsigned long startTime = micros();
+
+    // Same order as Board::begin(): the M4 core is booted before the PMIC is touched.
+    // The fuel gauge gets its output registers ready meanwhile, it starts on its own after power-up.
+    unsigned long phaseStartTime = micros();
+    board->prepareCores();
+    phaseTimings.boardSetup = micros() - phaseStartTime;
+
+    // The charger doesn't need any setup beyond the PMIC, which also initializes the I2C bus of the fuel gauge
+    phaseStartTime = micros();
+    if (PMIC.begin() != 0) {
+        return false;
+    }
+    phaseTimings.pmicInitialization = micros() - phaseStartTime;
+
+    bool configureFuelGauge = battery->requiresConfiguration(enforceReload);
+
+    if (configureFuelGauge) {
+        phaseStartTime = micros();
+        bool dataReady = battery->awaitDataReady();
+        phaseTimings.fuelGaugeReady = micros() - phaseStartTime;
+        if (!dataReady) {
+            return false; // Timeout while waiting for the battery gauge to be ready
+        }
+
+        phaseStartTime = micros();
+        bool configured = battery->configureFuelGauge();
+        phaseTimings.fuelGaugeConfiguration = micros() - phaseStartTime;
+        if (!configured) {
+            return false;
+        }
+    }
+
+    phaseTimings.total = micros() - startTime;
+    return true;
+}
+
+PowerManagementTimings PowerManagement::timings() {
+    return phaseTimings;
+}
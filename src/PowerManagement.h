@@ -0,0 +1,68 @@
+#ifndef POWER_MANAGEMENT_H
+#define POWER_MANAGEMENT_H
+
+#include "Arduino.h"
+#include "Battery.h"
+#include "Board.h"
+
+/**
+ * @brief The time each phase of PowerManagement::begin() took, in microseconds (µs).
+ */
+struct PowerManagementTimings {
+    /// @brief The board specific setup, e.g. booting the M4 core on the Portenta H7.
+    uint32_t boardSetup = 0;
+
+    /// @brief Initialising the PMIC and the I2C bus.
+    uint32_t pmicInitialization = 0;
+
+    /// @brief Waiting for the fuel gauge output registers to become ready after the board setup.
+    /// This is 0 if the fuel gauge didn't need to be configured.
+    uint32_t fuelGaugeReady = 0;
+
+    /// @brief Configuring the fuel gauge with the battery characteristics.
+    /// This is 0 if the fuel gauge didn't need to be configured.
+    uint32_t fuelGaugeConfiguration = 0;
+
+    /// @brief The whole initialisation.
+    uint32_t total = 0;
+};
+
+/**
+ * @brief Initialises the board, battery and charger together.
+ *
+ * Calling begin() on the Board, Battery and Charger objects separately initialises the PMIC three times.
+ * This class runs the board setup and initialises the PMIC once, in the same order as Board::begin(),
+ * while the fuel gauge gets its output registers ready, and only waits for the gauge afterwards.
+ * The time spent in each phase is recorded and can be read with timings().
+ */
+class PowerManagement {
+    public:
+        /**
+         * @brief Constructs a new PowerManagement object.
+         * @param board The board to initialise.
+         * @param battery The battery to initialise.
+         * The charger needs no setup beyond the PMIC, so a Charger object can be used right after begin().
+         */
+        PowerManagement(Board &board, Battery &battery);
+
+        /**
+         * @brief Initialises the PMIC, the board and the fuel gauge.
+         * Use this instead of calling begin() on the board, battery and charger.
+         * @param enforceReload If set to true, the battery gauge config will be reloaded.
+         * @return True if the initialization was successful, false otherwise.
+         */
+        bool begin(bool enforceReload = false);
+
+        /**
+         * @brief Returns the time each phase of the last call to begin() took.
+         * @return The timings of the initialisation phases.
+         */
+        PowerManagementTimings timings();
+
+    private:
+        Board *board;
+        Battery *battery;
+        PowerManagementTimings phaseTimings;
+};
+
+#endif
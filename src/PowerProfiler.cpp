@@ -0,0 +1,181 @@
+#include "PowerProfiler.h"
+
+BoardPowerProfileTarget::BoardPowerProfileTarget(Board &board, Battery &battery, Charger &charger)
+    : board(&board), battery(&battery), charger(&charger) {
+}
+
+bool BoardPowerProfileTarget::applyConfiguration(const PowerProfileConfiguration &configuration) {
+    return board->setPowerMode(configuration.mode) && charger->setEnabled(configuration.chargerEnabled);
+}
+
+bool BoardPowerProfileTarget::isChargerEnabled() {
+    return charger->isEnabled();
+}
+
+bool BoardPowerProfileTarget::setChargerEnabled(bool enabled) {
+    return charger->setEnabled(enabled);
+}
+
+float BoardPowerProfileTarget::averageCurrent() {
+    // The fuel gauge reports discharging as negative
+    return -battery->averageCurrent();
+}
+
+float BoardPowerProfileTarget::averagePower() {
+    return -battery->averagePower();
+}
+
+void BoardPowerProfileTarget::wait(uint32_t duration) {
+    delay(duration);
+}
+
+uint32_t BoardPowerProfileTarget::now() {
+    return millis();
+}
+
+#if defined(ARDUINO_POWER_MANAGEMENT_HOST_SIM)
+SimulatedPowerProfileTarget::SimulatedPowerProfileTarget(float baseCurrent, float voltage, uint32_t timeConstant)
+    : baseCurrent(baseCurrent), voltage(voltage), timeConstant(max(timeConstant, static_cast<uint32_t>(1))), filteredCurrent(baseCurrent) {
+}
+
+void SimulatedPowerProfileTarget::setRailCurrent(PowerRail rail, float current) {
+    railCurrents[static_cast<uint8_t>(rail)] = current;
+}
+
+void SimulatedPowerProfileTarget::setChargerCurrent(float current) {
+    chargerCurrent = current;
+}
+
+float SimulatedPowerProfileTarget::instantCurrent() {
+    float current = baseCurrent + (chargerEnabled ? chargerCurrent : 0.0f);
+    for (uint8_t index = 0; index < POWER_RAIL_COUNT; ++index) {
+        if (railEnabled[index]) {
+            current += railCurrents[index];
+        }
+    }
+    return current;
+}
+
+bool SimulatedPowerProfileTarget::applyConfiguration(const PowerProfileConfiguration &configuration) {
+    for (uint8_t index = 0; index < POWER_RAIL_COUNT; ++index) {
+        RailState state = configuration.mode.rails[index].state;
+        if (state != RailState::unchanged) {
+            railEnabled[index] = state == RailState::on;
+        }
+    }
+    chargerEnabled = configuration.chargerEnabled;
+    return true;
+}
+
+bool SimulatedPowerProfileTarget::isChargerEnabled() {
+    return chargerEnabled;
+}
+
+bool SimulatedPowerProfileTarget::setChargerEnabled(bool enabled) {
+    chargerEnabled = enabled;
+    return true;
+}
+
+float SimulatedPowerProfileTarget::averageCurrent() {
+    return filteredCurrent;
+}
+
+float SimulatedPowerProfileTarget::averagePower() {
+    return filteredCurrent * voltage;
+}
+
+void SimulatedPowerProfileTarget::wait(uint32_t duration) {
+    // A first order low pass like the averaging filter of the fuel gauge
+    filteredCurrent += (instantCurrent() - filteredCurrent) * (1.0f - expf(-static_cast<float>(duration) / timeConstant));
+    time += duration;
+}
+
+uint32_t SimulatedPowerProfileTarget::now() {
+    return time;
+}
+#endif
+
+PowerProfiler::PowerProfiler(PowerProfileTarget &target) : target(&target) {
+}
+
+void PowerProfiler::setSettleTime(uint32_t settleTime) {
+    this->settleTime = settleTime;
+}
+
+void PowerProfiler::setSampleWindow(uint32_t sampleWindow) {
+    this->sampleWindow = sampleWindow;
+}
+
+void PowerProfiler::setSampleInterval(uint32_t sampleInterval) {
+    this->sampleInterval = max(sampleInterval, static_cast<uint32_t>(1));
+}
+
+PowerProfileResult PowerProfiler::profile(const PowerProfileConfiguration &configuration) {
+    PowerProfileResult result;
+    result.name = configuration.mode.name;
+
+    if (!target->applyConfiguration(configuration)) {
+        return result;
+    }
+    target->wait(settleTime);
+
+    // Welford's algorithm keeps mean and variance numerically stable without storing the samples
+    float currentSquares = 0.0f;
+    float powerSquares = 0.0f;
+    uint32_t startTime = target->now();
+
+    do {
+        float current = target->averageCurrent();
+        float power = target->averagePower();
+        ++result.samples;
+
+        float currentDelta = current - result.meanCurrent;
+        result.meanCurrent += currentDelta / result.samples;
+        currentSquares += currentDelta * (current - result.meanCurrent);
+
+        float powerDelta = power - result.meanPower;
+        result.meanPower += powerDelta / result.samples;
+        powerSquares += powerDelta * (power - result.meanPower);
+
+        target->wait(sampleInterval);
+    } while (target->now() - startTime < sampleWindow);
+
+    if (result.samples > 1) {
+        result.currentVariance = currentSquares / (result.samples - 1);
+        result.powerVariance = powerSquares / (result.samples - 1);
+    }
+    result.valid = true;
+    return result;
+}
+
+void PowerProfiler::run(const PowerProfileConfiguration *configurations, uint8_t count, PowerProfileResult *results) {
+    bool chargerWasEnabled = target->isChargerEnabled();
+
+    for (uint8_t index = 0; index < count; ++index) {
+        results[index] = profile(configurations[index]);
+    }
+
+    target->setChargerEnabled(chargerWasEnabled);
+}
+
+void PowerProfiler::printResults(const PowerProfileResult *results, uint8_t count, Print &output) {
+    output.println("configuration, samples, mean current drawn (mA), current variance (mA^2), mean power drawn (mW), power variance (mW^2)");
+    for (uint8_t index = 0; index < count; ++index) {
+        const PowerProfileResult &result = results[index];
+        output.print(result.name != nullptr ? result.name : "unnamed");
+        if (!result.valid) {
+            output.println(", invalid configuration");
+            continue;
+        }
+        output.print(", ");
+        output.print(result.samples);
+        output.print(", ");
+        output.print(result.meanCurrent, 2);
+        output.print(", ");
+        output.print(result.currentVariance, 3);
+        output.print(", ");
+        output.print(result.meanPower, 2);
+        output.print(", ");
+        output.println(result.powerVariance, 3);
+    }
+}
@@ -0,0 +1,256 @@
+#ifndef POWER_PROFILER_H
+#define POWER_PROFILER_H
+
+#include "Arduino.h"
+#include "Battery.h"
+#include "Board.h"
+#include "Charger.h"
+
+constexpr uint32_t DEFAULT_PROFILE_SETTLE_TIME = 10000; // ms, about two time constants of AvgCurrent with the default filter
+constexpr uint32_t DEFAULT_PROFILE_SAMPLE_WINDOW = 30000; // ms
+constexpr uint32_t DEFAULT_PROFILE_SAMPLE_INTERVAL = 500; // ms
+
+/**
+ * @brief A board configuration to profile.
+ * The rail states and voltages, including the reference voltage (LDO2) and the external voltage (SW2), come from a power mode.
+ */
+struct PowerProfileConfiguration {
+    /// @brief The rail states and voltages to apply. Its name is used in the results table.
+    PowerMode mode;
+
+    /// @brief Whether the charger is enabled during the measurement.
+    bool chargerEnabled = true;
+};
+
+/**
+ * @brief The current and power measured for one configuration.
+ */
+struct PowerProfileResult {
+    /// @brief The name of the power mode of the configuration.
+    const char *name = nullptr;
+
+    /// @brief False if the configuration couldn't be applied, the other values are invalid in that case.
+    bool valid = false;
+
+    /// @brief The number of samples taken.
+    uint32_t samples = 0;
+
+    /// @brief The mean of the average current drawn from the battery in milli amperes (mA), positive while discharging.
+    float meanCurrent = 0.0f;
+
+    /// @brief The variance of the average current readings in mA².
+    float currentVariance = 0.0f;
+
+    /// @brief The mean of the average power drawn from the battery in milliwatts (mW), positive while discharging.
+    float meanPower = 0.0f;
+
+    /// @brief The variance of the average power readings in mW².
+    float powerVariance = 0.0f;
+};
+
+/**
+ * @brief The device measured by the PowerProfiler: it applies the configurations, measures them and keeps the time.
+ * Implement this to profile other hardware or to run the profiler against a simulation.
+ */
+class PowerProfileTarget {
+    public:
+        virtual ~PowerProfileTarget() = default;
+
+        /**
+         * @brief Applies the rail states and voltages of a configuration and its charger state.
+         * @param configuration The configuration to apply.
+         * @return True if the configuration was applied, false otherwise.
+         */
+        virtual bool applyConfiguration(const PowerProfileConfiguration &configuration) = 0;
+
+        /**
+         * @brief Checks if the charger is enabled.
+         * @return True if the charger is enabled, false otherwise.
+         */
+        virtual bool isChargerEnabled() = 0;
+
+        /**
+         * @brief Enables or disables the charger.
+         * @param enabled True to enable the charger, false to disable it.
+         * @return True if the charger state was set, false otherwise.
+         */
+        virtual bool setChargerEnabled(bool enabled) = 0;
+
+        /**
+         * @brief Reads the average current drawn from the battery.
+         * @return The current in milli amperes (mA), positive while discharging.
+         */
+        virtual float averageCurrent() = 0;
+
+        /**
+         * @brief Reads the average power drawn from the battery.
+         * @return The power in milliwatts (mW), positive while discharging.
+         */
+        virtual float averagePower() = 0;
+
+        /**
+         * @brief Waits for a while, e.g. for the readings to settle.
+         * @param duration The time to wait in milliseconds (ms).
+         */
+        virtual void wait(uint32_t duration) = 0;
+
+        /**
+         * @brief Returns the time of the target.
+         * @return The time in milliseconds (ms).
+         */
+        virtual uint32_t now() = 0;
+};
+
+/**
+ * @brief Profiles the board: the rails are set with Board::setPowerMode() and the current and power
+ * are read from Battery::averageCurrent() and Battery::averagePower().
+ * The fuel gauge reports discharging as negative, the readings are negated so the board's consumption is positive.
+ */
+class BoardPowerProfileTarget : public PowerProfileTarget {
+    public:
+        /**
+         * @brief Constructs a new BoardPowerProfileTarget object.
+         * @param board The board whose rails are configured.
+         * @param battery The battery used for the measurements.
+         * @param charger The charger that is enabled or disabled per configuration.
+         */
+        BoardPowerProfileTarget(Board &board, Battery &battery, Charger &charger);
+
+        bool applyConfiguration(const PowerProfileConfiguration &configuration) override;
+        bool isChargerEnabled() override;
+        bool setChargerEnabled(bool enabled) override;
+        float averageCurrent() override;
+        float averagePower() override;
+        void wait(uint32_t duration) override;
+        uint32_t now() override;
+
+    private:
+        Board *board;
+        Battery *battery;
+        Charger *charger;
+};
+
+#if defined(ARDUINO_POWER_MANAGEMENT_HOST_SIM)
+/**
+ * @brief Simulates a board for the PowerProfiler on the host.
+ * Each rail that is on adds its current to a base current, the enabled charger adds its own.
+ * The averages follow the current like the filter of the fuel gauge, so the settle time matters,
+ * and the time only advances in wait(), so a whole run completes instantly.
+ */
+class SimulatedPowerProfileTarget : public PowerProfileTarget {
+    public:
+        /**
+         * @brief Constructs a new SimulatedPowerProfileTarget object with all rails off and the charger enabled.
+         * @param baseCurrent The current in milli amperes (mA) drawn with all rails off.
+         * @param voltage The battery voltage in volts (V), used to compute the power.
+         * @param timeConstant The time constant of the averages in milliseconds (ms), 5.6s like the default filter of the fuel gauge.
+         */
+        SimulatedPowerProfileTarget(float baseCurrent, float voltage = 3.7f, uint32_t timeConstant = 5625);
+
+        /**
+         * @brief Sets the current a rail draws while it's on.
+         * @param rail The power rail.
+         * @param current The current in milli amperes (mA).
+         */
+        void setRailCurrent(PowerRail rail, float current);
+
+        /**
+         * @brief Sets the current the charger draws from the battery while it's enabled, e.g. for its own supply.
+         * @param current The current in milli amperes (mA).
+         */
+        void setChargerCurrent(float current);
+
+        /**
+         * @brief Returns the current drawn in the applied configuration, i.e. the value the averages settle on.
+         * @return The current in milli amperes (mA).
+         */
+        float instantCurrent();
+
+        bool applyConfiguration(const PowerProfileConfiguration &configuration) override;
+        bool isChargerEnabled() override;
+        bool setChargerEnabled(bool enabled) override;
+        float averageCurrent() override;
+        float averagePower() override;
+        void wait(uint32_t duration) override;
+        uint32_t now() override;
+
+    private:
+        float baseCurrent;
+        float voltage;
+        uint32_t timeConstant;
+        float railCurrents[POWER_RAIL_COUNT] = {};
+        bool railEnabled[POWER_RAIL_COUNT] = {};
+        float chargerCurrent = 0.0f;
+        bool chargerEnabled = true;
+        float filteredCurrent;
+        uint32_t time = 0;
+};
+#endif
+
+/**
+ * @brief Measures the current and power of a series of board configurations.
+ *
+ * For each configuration the profiler applies the power mode and charger state, waits for the
+ * fuel gauge averages to settle, then samples the average current and power over a window
+ * and computes their mean and variance.
+ * On the board use a BoardPowerProfileTarget and run it on battery power, as the fuel gauge only
+ * measures the current flowing from the battery. On the host a SimulatedPowerProfileTarget tests the harness itself.
+ */
+class PowerProfiler {
+    public:
+        /**
+         * @brief Constructs a new PowerProfiler object.
+         * @param target The device that is configured and measured.
+         */
+        PowerProfiler(PowerProfileTarget &target);
+
+        /**
+         * @brief Sets the time to wait after applying a configuration before sampling.
+         * @param settleTime The settle time in milliseconds (ms).
+         */
+        void setSettleTime(uint32_t settleTime);
+
+        /**
+         * @brief Sets the duration over which the samples of a configuration are taken.
+         * @param sampleWindow The sample window in milliseconds (ms).
+         */
+        void setSampleWindow(uint32_t sampleWindow);
+
+        /**
+         * @brief Sets the time between two samples.
+         * @param sampleInterval The sample interval in milliseconds (ms).
+         */
+        void setSampleInterval(uint32_t sampleInterval);
+
+        /**
+         * @brief Profiles a single configuration.
+         * @param configuration The configuration to apply and measure.
+         * @return The measured mean and variance of current and power.
+         */
+        PowerProfileResult profile(const PowerProfileConfiguration &configuration);
+
+        /**
+         * @brief Profiles a list of configurations one after the other.
+         * The charger is set back to its previous state at the end, the rails stay in the last configuration.
+         * @param configurations The configurations to profile.
+         * @param count The number of configurations.
+         * @param results Array of at least count elements that receives the results.
+         */
+        void run(const PowerProfileConfiguration *configurations, uint8_t count, PowerProfileResult *results);
+
+        /**
+         * @brief Prints the results as a table, one line per configuration.
+         * @param results The results to print.
+         * @param count The number of results.
+         * @param output Where to print the table, e.g. Serial.
+         */
+        static void printResults(const PowerProfileResult *results, uint8_t count, Print &output);
+
+    private:
+        PowerProfileTarget *target;
+        uint32_t settleTime = DEFAULT_PROFILE_SETTLE_TIME;
+        uint32_t sampleWindow = DEFAULT_PROFILE_SAMPLE_WINDOW;
+        uint32_t sampleInterval = DEFAULT_PROFILE_SAMPLE_INTERVAL;
+};
+
+#endif
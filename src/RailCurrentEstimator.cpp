@@ -0,0 +1,192 @@
+#include "RailCurrentEstimator.h"
+
+RailCurrentEstimator::RailCurrentEstimator() {
+    reset();
+}
+
+void RailCurrentEstimator::setSettleSamples(uint8_t settleSamples) {
+    this->settleSamples = min(settleSamples, static_cast<uint8_t>(UINT8_MAX - 1));
+}
+
+void RailCurrentEstimator::setAverageSamples(uint8_t averageSamples) {
+    this->averageSamples = max(averageSamples, static_cast<uint8_t>(1));
+}
+
+void RailCurrentEstimator::setForgettingFactor(float forgettingFactor) {
+    this->forgettingFactor = constrain(forgettingFactor, 0.5f, 1.0f);
+}
+
+void RailCurrentEstimator::update(const PowerMode &state, float current) {
+    uint8_t known;
+    uint8_t rails;
+    float voltages[POWER_RAIL_COUNT];
+    readState(state, known, rails, voltages);
+
+    bool voltagesChanged = false;
+    for (uint8_t index = 0; index < POWER_RAIL_COUNT; ++index) {
+        if (voltages[index] != railVoltages[index]) {
+            voltagesChanged = true;
+            // The current learned at the old voltage doesn't apply anymore
+            if (stateValid) {
+                resetParameter(index + 1);
+                railObservations[index] = 0;
+                bitClear(observedKnownRails, index);
+            }
+        }
+    }
+
+    if (!stateValid || known != knownRails || rails != enabledRails || voltagesChanged) {
+        knownRails = known;
+        enabledRails = rails;
+        memcpy(railVoltages, voltages, sizeof(railVoltages));
+        stateValid = true;
+        sampleCount = 0;
+        windowCount = 0;
+        windowSum = 0.0f;
+    }
+
+    if (sampleCount < settleSamples) {
+        ++sampleCount;
+        return;
+    }
+
+    windowSum += current;
+    if (++windowCount < averageSamples) {
+        return;
+    }
+
+    addObservation(windowSum / windowCount);
+    windowCount = 0;
+    windowSum = 0.0f;
+}
+
+void RailCurrentEstimator::update(Board &board, Battery &battery) {
+    float current = battery.highResolutionCurrent();
+    // -1 means no battery is connected, it's not a multiple of the current resolution
+    if (current == -1) {
+        return;
+    }
+
+    // The fuel gauge reports discharging as negative, the estimates are in current drawn
+    update(board.knownPowerMode(), -current);
+}
+
+float RailCurrentEstimator::railCurrent(PowerRail rail) {
+    return parameters[static_cast<uint8_t>(rail) + 1];
+}
+
+uint16_t RailCurrentEstimator::observations(PowerRail rail) {
+    return railObservations[static_cast<uint8_t>(rail)];
+}
+
+float RailCurrentEstimator::baselineCurrent() {
+    return parameters[0];
+}
+
+float RailCurrentEstimator::estimatedCurrent(const PowerMode &mode) {
+    float current = parameters[0];
+    for (uint8_t index = 0; index < POWER_RAIL_COUNT; ++index) {
+        RailState state = mode.rails[index].state;
+        bool on = state == RailState::on || (state == RailState::unchanged && stateValid && bitRead(enabledRails, index));
+        if (on) {
+            current += parameters[index + 1];
+        }
+    }
+    return current;
+}
+
+void RailCurrentEstimator::reset() {
+    for (uint8_t parameter = 0; parameter < RAIL_PARAMETER_COUNT; ++parameter) {
+        resetParameter(parameter);
+    }
+    for (uint8_t index = 0; index < POWER_RAIL_COUNT; ++index) {
+        railObservations[index] = 0;
+        railVoltages[index] = 0.0f;
+    }
+
+    knownRails = 0;
+    enabledRails = 0;
+    stateValid = false;
+    sampleCount = 0;
+    windowCount = 0;
+    windowSum = 0.0f;
+
+    observedKnownRails = 0;
+    observedEnabledRails = 0;
+    observed = false;
+}
+
+void RailCurrentEstimator::addObservation(float current) {
+    // The observation is the baseline plus the current of each rail that is on
+    float regressors[RAIL_PARAMETER_COUNT];
+    regressors[0] = 1.0f;
+    for (uint8_t index = 0; index < POWER_RAIL_COUNT; ++index) {
+        regressors[index + 1] = bitRead(enabledRails, index) ? 1.0f : 0.0f;
+    }
+
+    float gain[RAIL_PARAMETER_COUNT];
+    float denominator = forgettingFactor;
+    float prediction = 0.0f;
+    for (uint8_t row = 0; row < RAIL_PARAMETER_COUNT; ++row) {
+        gain[row] = 0.0f;
+        for (uint8_t column = 0; column < RAIL_PARAMETER_COUNT; ++column) {
+            gain[row] += covariance[row][column] * regressors[column];
+        }
+        denominator += regressors[row] * gain[row];
+        prediction += regressors[row] * parameters[row];
+    }
+
+    float error = current - prediction;
+    for (uint8_t row = 0; row < RAIL_PARAMETER_COUNT; ++row) {
+        parameters[row] += gain[row] / denominator * error;
+    }
+    for (uint8_t row = 0; row < RAIL_PARAMETER_COUNT; ++row) {
+        for (uint8_t column = 0; column < RAIL_PARAMETER_COUNT; ++column) {
+            covariance[row][column] = (covariance[row][column] - gain[row] * gain[column] / denominator) / forgettingFactor;
+        }
+    }
+
+    // Forgetting inflates the uncertainty of rails that aren't switched, bound it to what is known without observations
+    for (uint8_t parameter = 0; parameter < RAIL_PARAMETER_COUNT; ++parameter) {
+        if (covariance[parameter][parameter] > RAIL_INITIAL_COVARIANCE) {
+            float scale = sqrtf(RAIL_INITIAL_COVARIANCE / covariance[parameter][parameter]);
+            for (uint8_t other = 0; other < RAIL_PARAMETER_COUNT; ++other) {
+                covariance[parameter][other] *= scale;
+                covariance[other][parameter] *= scale;
+            }
+        }
+    }
+
+    uint8_t switchedRails = (observedEnabledRails ^ enabledRails) & observedKnownRails & knownRails;
+    for (uint8_t index = 0; observed && index < POWER_RAIL_COUNT; ++index) {
+        if (bitRead(switchedRails, index) && railObservations[index] < UINT16_MAX) {
+            ++railObservations[index];
+        }
+    }
+    observedKnownRails = knownRails;
+    observedEnabledRails = enabledRails;
+    observed = true;
+}
+
+void RailCurrentEstimator::resetParameter(uint8_t parameter) {
+    parameters[parameter] = 0.0f;
+    for (uint8_t other = 0; other < RAIL_PARAMETER_COUNT; ++other) {
+        covariance[parameter][other] = 0.0f;
+        covariance[other][parameter] = 0.0f;
+    }
+    covariance[parameter][parameter] = RAIL_INITIAL_COVARIANCE;
+}
+
+void RailCurrentEstimator::readState(const PowerMode &state, uint8_t &knownRails, uint8_t &enabledRails, float *voltages) {
+    knownRails = 0;
+    enabledRails = 0;
+    for (uint8_t index = 0; index < POWER_RAIL_COUNT; ++index) {
+        if (state.rails[index].state != RailState::unchanged) {
+            bitSet(knownRails, index);
+        }
+        if (state.rails[index].state == RailState::on) {
+            bitSet(enabledRails, index);
+        }
+        voltages[index] = state.rails[index].voltage;
+    }
+}
@@ -0,0 +1,147 @@
+#ifndef RAIL_CURRENT_ESTIMATOR_H
+#define RAIL_CURRENT_ESTIMATOR_H
+
+#include "Arduino.h"
+#include "Battery.h"
+#include "Board.h"
+
+constexpr uint8_t DEFAULT_RAIL_SETTLE_SAMPLES = 4; // Samples ignored after a rail change while the gauge reading settles
+constexpr uint8_t DEFAULT_RAIL_AVERAGE_SAMPLES = 8; // Samples averaged into one observation
+constexpr float DEFAULT_RAIL_FORGETTING_FACTOR = 0.98f; // Weight of the past observations in the fit
+constexpr float RAIL_INITIAL_COVARIANCE = 10000.0f; // (100mA)^2, the uncertainty of an estimate that wasn't learned yet
+constexpr uint8_t RAIL_PARAMETER_COUNT = POWER_RAIL_COUNT + 1; // The baseline and one current per rail
+
+/**
+ * @brief Learns how much current each power rail adds while the sketch is running.
+ *
+ * The estimator is fed with the rail states known by the Board and current samples from the fuel gauge.
+ * After a change the samples are given time to settle and then averaged. Each average is an observation
+ * of the baseline (the current drawn with all rails off) plus the currents of the rails that are on.
+ * The baseline and the rail currents are fitted jointly to all observations with recursive least squares,
+ * so rails that are switched together or never switched alone are separated as soon as they were seen in
+ * enough different combinations. Older observations are gradually forgotten to follow slow drifts.
+ *
+ * A rail whose state never changed can't be told apart from the baseline, check observations()
+ * before relying on its estimate. The estimates are learned at the voltages the rails had, a voltage
+ * change makes the estimate of that rail start over.
+ */
+class RailCurrentEstimator {
+    public:
+        /**
+         * @brief Constructs a new RailCurrentEstimator object without any learned estimates.
+         */
+        RailCurrentEstimator();
+
+        /**
+         * @brief Sets how many samples are ignored after a rail change.
+         * Battery::highResolutionCurrent() settles within a few samples, Battery::averageCurrent() needs several seconds.
+         * @param settleSamples The number of samples to ignore.
+         */
+        void setSettleSamples(uint8_t settleSamples);
+
+        /**
+         * @brief Sets how many settled samples are averaged into one observation.
+         * @param averageSamples The number of samples to average, at least 1.
+         */
+        void setAverageSamples(uint8_t averageSamples);
+
+        /**
+         * @brief Sets how quickly old observations are forgotten.
+         * An observation that is n observations old is weighted with forgettingFactor^n.
+         * @param forgettingFactor The factor between 0.5 and 1. 1 never forgets.
+         */
+        void setForgettingFactor(float forgettingFactor);
+
+        /**
+         * @brief Adds a current sample taken while the rails were in the given state.
+         * Rails whose state is unknown are assumed to stay as they are, their current is part of the baseline.
+         * The fuel gauge reports discharging as negative, so negate its readings, e.g. -battery.highResolutionCurrent().
+         * @param state The known rail states, e.g. from Board::knownPowerMode().
+         * @param current The current drawn from the battery in milli amperes (mA), positive while discharging.
+         */
+        void update(const PowerMode &state, float current);
+
+        /**
+         * @brief Reads the rail states from the board and the current from the battery and adds them as a sample.
+         * The current is Battery::highResolutionCurrent(), negated so that the current drawn is positive.
+         * Nothing is added while no battery is connected.
+         * Call it periodically, e.g. once per second, from the loop.
+         * @param board The board whose rail states are used.
+         * @param battery The battery whose current is sampled.
+         */
+        void update(Board &board, Battery &battery);
+
+        /**
+         * @brief Returns the learned current added by a rail when it's on.
+         * @param rail The power rail.
+         * @return The current in milli amperes (mA), 0 if nothing was learned yet.
+         */
+        float railCurrent(PowerRail rail);
+
+        /**
+         * @brief Returns how many switches of a rail were observed since its estimate was last started over.
+         * @param rail The power rail.
+         * @return The number of observed switches.
+         */
+        uint16_t observations(PowerRail rail);
+
+        /**
+         * @brief Returns the learned current drawn with all rails off.
+         * @return The current in milli amperes (mA).
+         */
+        float baselineCurrent();
+
+        /**
+         * @brief Estimates the current drawn in a hypothetical configuration.
+         * Rails that the power mode leaves unchanged are assumed to stay in their last sampled state.
+         * @param mode The power mode to estimate.
+         * @return The estimated current in milli amperes (mA).
+         */
+        float estimatedCurrent(const PowerMode &mode);
+
+        /**
+         * @brief Forgets all estimates.
+         */
+        void reset();
+
+    private:
+        /**
+         * Encodes the on/off states and voltages of a power mode so that changes can be detected.
+         */
+        static void readState(const PowerMode &state, uint8_t &knownRails, uint8_t &enabledRails, float *voltages);
+
+        /**
+         * Adds an averaged current drawn with the enabled rails on to the least squares fit.
+         */
+        void addObservation(float current);
+
+        /**
+         * Makes the estimate of a parameter start over, e.g. after the voltage of its rail changed.
+         */
+        void resetParameter(uint8_t parameter);
+
+        // The baseline followed by the rail currents, and the covariance of their estimates
+        float parameters[RAIL_PARAMETER_COUNT];
+        float covariance[RAIL_PARAMETER_COUNT][RAIL_PARAMETER_COUNT];
+        uint16_t railObservations[POWER_RAIL_COUNT];
+
+        // The configuration currently being averaged
+        uint8_t knownRails;
+        uint8_t enabledRails;
+        float railVoltages[POWER_RAIL_COUNT];
+        bool stateValid;
+        uint8_t sampleCount; // Samples since the configuration changed, saturates after settling
+        uint8_t windowCount;
+        float windowSum;
+
+        // The rails that were on during the last observation, to count switches
+        uint8_t observedKnownRails;
+        uint8_t observedEnabledRails;
+        bool observed;
+
+        uint8_t settleSamples = DEFAULT_RAIL_SETTLE_SAMPLES;
+        uint8_t averageSamples = DEFAULT_RAIL_AVERAGE_SAMPLES;
+        float forgettingFactor = DEFAULT_RAIL_FORGETTING_FACTOR;
+};
+
+#endif
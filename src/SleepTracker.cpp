@@ -0,0 +1,234 @@
+#include "SleepTracker.h"
+
+// Layout of the record in the store, multi-byte values are little endian
+constexpr uint8_t RECORD_MAGIC_OFFSET = 0;
+constexpr uint8_t RECORD_CHARGE_OFFSET = 2;
+constexpr uint8_t RECORD_TIMER_OFFSET = 4;
+constexpr uint8_t RECORD_VOLTAGE_OFFSET = 8;
+constexpr uint8_t RECORD_DELAY_OFFSET = 10;
+constexpr uint8_t RECORD_FLAGS_OFFSET = 14;
+constexpr uint8_t RECORD_CHECKSUM_OFFSET = 15;
+constexpr uint8_t RECORD_PIN_WAKEUP_BIT = 0;
+
+static void writeValue(uint8_t *data, uint32_t value, uint8_t size) {
+    for (uint8_t index = 0; index < size; ++index) {
+        data[index] = value >> (8 * index);
+    }
+}
+
+static uint32_t readValue(const uint8_t *data, uint8_t size) {
+    uint32_t value = 0;
+    for (uint8_t index = 0; index < size; ++index) {
+        value |= static_cast<uint32_t>(data[index]) << (8 * index);
+    }
+    return value;
+}
+
+#if defined(ARDUINO_PORTENTA_C33)
+constexpr uint16_t BACKUP_REGISTER_SIZE = 512;
+
+BackupRegisterStore::BackupRegisterStore(uint16_t offset) : offset(offset) {
+}
+
+bool BackupRegisterStore::write(const uint8_t *data, uint8_t length) {
+    if (offset + length > BACKUP_REGISTER_SIZE) {
+        return false;
+    }
+    for (uint8_t index = 0; index < length; ++index) {
+        R_SYSTEM->VBTBKR[offset + index].VBTBKR = data[index];
+    }
+    return true;
+}
+
+bool BackupRegisterStore::read(uint8_t *data, uint8_t length) {
+    if (offset + length > BACKUP_REGISTER_SIZE) {
+        return false;
+    }
+    for (uint8_t index = 0; index < length; ++index) {
+        data[index] = R_SYSTEM->VBTBKR[offset + index].VBTBKR;
+    }
+    return true;
+}
+#elif defined(ARDUINO_PORTENTA_H7)
+constexpr uint16_t BACKUP_REGISTER_SIZE = 32 * sizeof(uint32_t);
+
+BackupRegisterStore::BackupRegisterStore(uint16_t offset) : offset(offset) {
+}
+
+bool BackupRegisterStore::write(const uint8_t *data, uint8_t length) {
+    if (offset % sizeof(uint32_t) != 0 || offset + length > BACKUP_REGISTER_SIZE) {
+        return false;
+    }
+
+    // The backup domain is write protected after reset
+    HAL_PWR_EnableBkUpAccess();
+    volatile uint32_t *registers = &RTC->BKP0R + offset / sizeof(uint32_t);
+    for (uint8_t index = 0; index < length; index += sizeof(uint32_t)) {
+        registers[index / sizeof(uint32_t)] = readValue(data + index, min(length - index, static_cast<int>(sizeof(uint32_t))));
+    }
+    return true;
+}
+
+bool BackupRegisterStore::read(uint8_t *data, uint8_t length) {
+    if (offset % sizeof(uint32_t) != 0 || offset + length > BACKUP_REGISTER_SIZE) {
+        return false;
+    }
+
+    volatile uint32_t *registers = &RTC->BKP0R + offset / sizeof(uint32_t);
+    for (uint8_t index = 0; index < length; index += sizeof(uint32_t)) {
+        writeValue(data + index, registers[index / sizeof(uint32_t)], min(length - index, static_cast<int>(sizeof(uint32_t))));
+    }
+    return true;
+}
+#endif
+
+#if defined(ARDUINO_PORTENTA_C33)
+// The Deep Software Standby Interrupt Flag Registers tell which source ended deep software standby
+constexpr uint8_t DPSIFR2_RTC_FLAGS = R_SYSTEM_DPSIFR2_DRTCIIF_Msk | R_SYSTEM_DPSIFR2_DRTCAIF_Msk;
+constexpr uint16_t PRCR_UNLOCK_PRC1 = 0xA502; // Key 0xA5 and PRC1, which allows writing the low power mode registers
+constexpr uint16_t PRCR_LOCK = 0xA500;
+
+static WakeupReason readWakeupFlags() {
+    if ((R_SYSTEM->DPSIFR2 & DPSIFR2_RTC_FLAGS) != 0) {
+        return WakeupReason::timeElapsed;
+    }
+    // DPSIFR0 and DPSIFR1 hold the IRQ pins, the NMI pin is in DPSIFR2
+    if (R_SYSTEM->DPSIFR0 != 0 || R_SYSTEM->DPSIFR1 != 0 || (R_SYSTEM->DPSIFR2 & R_SYSTEM_DPSIFR2_DNMIF_Msk) != 0) {
+        return WakeupReason::pinActivity;
+    }
+    return WakeupReason::unknown;
+}
+
+static void clearWakeupFlags() {
+    R_SYSTEM->PRCR = PRCR_UNLOCK_PRC1;
+    R_SYSTEM->DPSIFR0 = 0;
+    R_SYSTEM->DPSIFR1 = 0;
+    R_SYSTEM->DPSIFR2 = 0;
+    R_SYSTEM->DPSIFR3 = 0;
+    R_SYSTEM->PRCR = PRCR_LOCK;
+}
+#elif defined(ARDUINO_PORTENTA_H7)
+constexpr uint32_t RTC_WAKEUP_FLAGS = RTC_ISR_WUTF | RTC_ISR_ALRAF;
+constexpr uint32_t WAKEUP_PIN_FLAGS = PWR_WKUPFR_WKUPF1 | PWR_WKUPFR_WKUPF2 | PWR_WKUPFR_WKUPF3
+                                    | PWR_WKUPFR_WKUPF4 | PWR_WKUPFR_WKUPF5 | PWR_WKUPFR_WKUPF6;
+constexpr uint32_t WAKEUP_PIN_CLEAR = PWR_WKUPCR_WKUPC1 | PWR_WKUPCR_WKUPC2 | PWR_WKUPCR_WKUPC3
+                                    | PWR_WKUPCR_WKUPC4 | PWR_WKUPCR_WKUPC5 | PWR_WKUPCR_WKUPC6;
+
+static WakeupReason readWakeupFlags() {
+    // The RTC flags are in the backup domain and the wakeup pin flags in PWR, both survive standby
+    if ((RTC->ISR & RTC_WAKEUP_FLAGS) != 0) {
+        return WakeupReason::timeElapsed;
+    }
+    if ((PWR->WKUPFR & WAKEUP_PIN_FLAGS) != 0) {
+        return WakeupReason::pinActivity;
+    }
+    return WakeupReason::unknown;
+}
+
+static void clearWakeupFlags() {
+    HAL_PWR_EnableBkUpAccess();
+    // The RTC flags are cleared by writing 0, writing 1 to the other flags leaves them unchanged. INIT is kept as it is.
+    RTC->ISR = ~(RTC_WAKEUP_FLAGS | RTC_ISR_INIT) | (RTC->ISR & RTC_ISR_INIT);
+    PWR->WKUPCR = WAKEUP_PIN_CLEAR;
+}
+#else
+static WakeupReason readWakeupFlags() {
+    return WakeupReason::unknown;
+}
+
+static void clearWakeupFlags() {
+}
+#endif
+
+SleepTracker::SleepTracker(Battery &battery, SleepStateStore &store) : battery(&battery), store(&store) {
+}
+
+bool SleepTracker::standByUntilWakeupEvent(Board &board) {
+    bool timeElapsedEnabled = (static_cast<uint8_t>(board.standbyType) & static_cast<uint8_t>(StandbyType::untilTimeElapsed)) != 0;
+    bool pinActivityEnabled = (static_cast<uint8_t>(board.standbyType) & static_cast<uint8_t>(StandbyType::untilPinActivity)) != 0;
+    uint32_t programmedDelay = 0;
+    if (timeElapsedEnabled) {
+        programmedDelay = board.wakeupDelayHours * 3600 + board.wakeupDelayMinutes * 60 + board.wakeupDelaySeconds;
+    }
+
+    bool saved = saveRecord(programmedDelay, pinActivityEnabled);
+    board.standByUntilWakeupEvent();
+    return saved;
+}
+
+bool SleepTracker::saveRecord(uint32_t programmedDelay, bool wakeupFromPin) {
+    // The flags are also set by events while running, clear them so that only the wakeup is reported
+    clearWakeupFlags();
+    CoulombCounterSnapshot snapshot = battery->coulombCounter();
+    uint8_t record[SLEEP_RECORD_SIZE] = {};
+
+    writeValue(record + RECORD_MAGIC_OFFSET, SLEEP_RECORD_MAGIC, 2);
+    writeValue(record + RECORD_CHARGE_OFFSET, snapshot.charge, 2);
+    writeValue(record + RECORD_TIMER_OFFSET, snapshot.timer, 4);
+    writeValue(record + RECORD_VOLTAGE_OFFSET, snapshot.averageVoltage, 2);
+    writeValue(record + RECORD_DELAY_OFFSET, programmedDelay, 4);
+    if (wakeupFromPin) {
+        bitSet(record[RECORD_FLAGS_OFFSET], RECORD_PIN_WAKEUP_BIT);
+    }
+    record[RECORD_CHECKSUM_OFFSET] = checksum(record, RECORD_CHECKSUM_OFFSET);
+
+    return store->write(record, SLEEP_RECORD_SIZE);
+}
+
+bool SleepTracker::wokeUpFromStandby(SleepReport &report) {
+    uint8_t record[SLEEP_RECORD_SIZE];
+    if (!store->read(record, SLEEP_RECORD_SIZE)) {
+        return false;
+    }
+    if (readValue(record + RECORD_MAGIC_OFFSET, 2) != SLEEP_RECORD_MAGIC || record[RECORD_CHECKSUM_OFFSET] != checksum(record, RECORD_CHECKSUM_OFFSET)) {
+        return false;
+    }
+
+    // Invalidate the record so that it's only reported once
+    uint8_t emptyRecord[SLEEP_RECORD_SIZE] = {};
+    store->write(emptyRecord, SLEEP_RECORD_SIZE);
+
+    CoulombCounterSnapshot start;
+    start.charge = readValue(record + RECORD_CHARGE_OFFSET, 2);
+    start.timer = readValue(record + RECORD_TIMER_OFFSET, 4);
+    start.averageVoltage = readValue(record + RECORD_VOLTAGE_OFFSET, 2);
+    CoulombCounterSnapshot end = battery->coulombCounter();
+
+    // A timer that went backwards means the fuel gauge was reset during standby
+    if (end.timer < start.timer) {
+        return false;
+    }
+
+    report.measurement = EnergyProbe::between(start, end);
+    report.programmedDelay = readValue(record + RECORD_DELAY_OFFSET, 4);
+
+    report.wakeupReason = readWakeupFlags();
+    clearWakeupFlags();
+    if (report.wakeupReason != WakeupReason::unknown) {
+        return true;
+    }
+
+    // Without a flag, e.g. if other code cleared them, the reason is inferred from the duration.
+    // The fuel gauge timer and the RTC run from different clocks, so allow for some difference.
+    bool wakeupFromPin = bitRead(record[RECORD_FLAGS_OFFSET], RECORD_PIN_WAKEUP_BIT);
+    float earliestAlarm = report.programmedDelay * (1.0f - SLEEP_TIMER_TOLERANCE) - 1.0f;
+    if (report.programmedDelay > 0 && report.measurement.duration >= earliestAlarm) {
+        report.wakeupReason = WakeupReason::timeElapsed;
+    } else if (wakeupFromPin) {
+        report.wakeupReason = WakeupReason::pinActivity;
+    } else {
+        report.wakeupReason = WakeupReason::unknown;
+    }
+    return true;
+}
+
+uint8_t SleepTracker::checksum(const uint8_t *data, uint8_t length) {
+    uint8_t crc = 0;
+    for (uint8_t index = 0; index < length; ++index) {
+        crc ^= data[index];
+        for (uint8_t bit = 0; bit < 8; ++bit) {
+            crc = (crc & 0x80) ? (crc << 1) ^ 0x07 : crc << 1;
+        }
+    }
+    return crc;
+}
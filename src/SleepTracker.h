@@ -0,0 +1,159 @@
+#ifndef SLEEP_TRACKER_H
+#define SLEEP_TRACKER_H
+
+#include "Arduino.h"
+#include "Battery.h"
+#include "Board.h"
+#include "EnergyProbe.h"
+
+constexpr uint8_t SLEEP_RECORD_SIZE = 16; // Bytes a SleepStateStore needs to hold
+constexpr uint16_t SLEEP_RECORD_MAGIC = 0x534C; // Marks a valid record
+constexpr float SLEEP_TIMER_TOLERANCE = 0.02f; // Relative difference between the fuel gauge timer and the RTC that is still considered on time
+
+/**
+ * @brief Memory that survives standby, used by the SleepTracker to keep its record while the MCU is off.
+ * Implement this to keep the record somewhere else, e.g. in an external FRAM.
+ */
+class SleepStateStore {
+    public:
+        virtual ~SleepStateStore() = default;
+
+        /**
+         * @brief Writes the record.
+         * @param data The bytes to write.
+         * @param length The number of bytes, SLEEP_RECORD_SIZE.
+         * @return True if the record was written, false otherwise.
+         */
+        virtual bool write(const uint8_t *data, uint8_t length) = 0;
+
+        /**
+         * @brief Reads the record back.
+         * @param data The buffer that receives the bytes.
+         * @param length The number of bytes, SLEEP_RECORD_SIZE.
+         * @return True if the record was read, false otherwise.
+         */
+        virtual bool read(uint8_t *data, uint8_t length) = 0;
+};
+
+#if defined(ARDUINO_PORTENTA_C33) || defined(ARDUINO_PORTENTA_H7)
+/**
+ * @brief Keeps the record in the backup registers of the MCU, which keep their content in standby.
+ * On the Portenta C33 these are the 512 bytes of the VBTBKR registers, on the Portenta H7 the 32 RTC backup registers (128 bytes).
+ */
+class BackupRegisterStore : public SleepStateStore {
+    public:
+        /**
+         * @brief Constructs a new BackupRegisterStore object.
+         * @param offset The first byte of the backup registers to use, so that other users of the registers can be left alone.
+         * On the Portenta H7 it has to be a multiple of 4.
+         */
+        BackupRegisterStore(uint16_t offset = 0);
+
+        bool write(const uint8_t *data, uint8_t length) override;
+        bool read(uint8_t *data, uint8_t length) override;
+
+    private:
+        uint16_t offset;
+};
+#endif
+
+/**
+ * @brief Why the board woke up from standby.
+ * On the Portenta C33 it's read from the deep software standby interrupt flags (DPSIFR0-DPSIFR2), on the Portenta H7
+ * from the RTC wakeup timer and alarm flags (RTC_ISR) and the wakeup pin flags (PWR_WKUPFR). If no flag is set,
+ * e.g. because other code cleared them, or on other boards, it's inferred from the elapsed time.
+ */
+enum class WakeupReason : uint8_t {
+    /// @brief The reason can't be told, e.g. no flag is set and the board woke up early without a pin wakeup enabled.
+    unknown = 0,
+
+    /// @brief The RTC alarm expired.
+    timeElapsed = 1,
+
+    /// @brief A wakeup pin became active before the RTC alarm.
+    pinActivity = 2
+};
+
+/**
+ * @brief What happened while the board was in standby.
+ */
+struct SleepReport {
+    /// @brief The duration, charge, energy and average current of the standby period.
+    EnergyMeasurement measurement;
+
+    /// @brief The RTC wakeup delay that was programmed in seconds (s), 0 if none.
+    uint32_t programmedDelay = 0;
+
+    /// @brief The reason of the wakeup.
+    WakeupReason wakeupReason = WakeupReason::unknown;
+};
+
+/**
+ * @brief Measures how much charge the board used while in standby.
+ *
+ * In standby the MCU loses its RAM, but the fuel gauge keeps counting. Before going to standby the tracker
+ * saves a snapshot of the coulomb counter and the programmed wakeup sources to memory that survives
+ * standby. After the restart it reads the snapshot back and compares it with the current coulomb counter:
+ *
+ *     void setup() {
+ *         ...
+ *         SleepReport report;
+ *         if (sleepTracker.wokeUpFromStandby(report)) {
+ *             Serial.println(report.measurement.averageCurrent * 1000); // µA
+ *         }
+ *     }
+ *
+ *     void loop() {
+ *         ...
+ *         sleepTracker.standByUntilWakeupEvent(board);
+ *     }
+ *
+ * The coulomb counter has a resolution of 0.5mAh, so the average current becomes accurate after long standby periods.
+ * The fuel gauge must not be shut down during standby (Board::shutDownFuelGauge()).
+ */
+class SleepTracker {
+    public:
+        /**
+         * @brief Constructs a new SleepTracker object.
+         * @param battery The battery whose coulomb counter is used.
+         * @param store The memory that keeps the record during standby.
+         */
+        SleepTracker(Battery &battery, SleepStateStore &store);
+
+        /**
+         * @brief Saves the record and sends the board to standby, see Board::standByUntilWakeupEvent().
+         * Enable the wakeup sources before calling this.
+         * @param board The board to send to standby.
+         * @return False if the record couldn't be saved, the board goes to standby anyway.
+         */
+        bool standByUntilWakeupEvent(Board &board);
+
+        /**
+         * @brief Saves the record without going to standby.
+         * Use this if the board is sent to standby some other way. The wakeup flags of the MCU are cleared.
+         * @param programmedDelay The RTC wakeup delay in seconds, 0 if none.
+         * @param wakeupFromPin True if a wakeup pin is enabled.
+         * @return True if the record was saved, false otherwise.
+         */
+        bool saveRecord(uint32_t programmedDelay, bool wakeupFromPin);
+
+        /**
+         * @brief Reads the record saved before standby and reports the standby period.
+         * The record is invalidated so that a later reset isn't mistaken for a wakeup, and the wakeup flags of the MCU are cleared.
+         * Call it early in setup(), before other code clears the wakeup flags.
+         * @param report Receives the report.
+         * @return True if a valid record was found, false after a regular reset or if the fuel gauge was reset in between.
+         */
+        bool wokeUpFromStandby(SleepReport &report);
+
+    private:
+        /**
+         * Computes a CRC-8 (polynomial 0x07) over the given bytes.
+         */
+        static uint8_t checksum(const uint8_t *data, uint8_t length);
+
+        Battery *battery;
+        SleepStateStore *store;
+};
+
+#endif
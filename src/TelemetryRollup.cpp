@@ -0,0 +1,149 @@
+#include "TelemetryRollup.h"
+
+constexpr uint32_t ROLLUP_PERIODS[ROLLUP_TIER_COUNT] = {1, 60, 3600, 86400}; // s
+
+BatterySample BatterySample::read(Battery &battery, uint8_t metrics) {
+    BatterySample sample;
+    if (bitRead(metrics, static_cast<uint8_t>(BatteryMetric::voltage))) {
+        sample[BatteryMetric::voltage] = battery.voltage();
+    }
+    if (bitRead(metrics, static_cast<uint8_t>(BatteryMetric::current))) {
+        sample[BatteryMetric::current] = battery.highResolutionCurrent();
+    }
+    if (bitRead(metrics, static_cast<uint8_t>(BatteryMetric::power))) {
+        sample[BatteryMetric::power] = battery.power();
+    }
+    if (bitRead(metrics, static_cast<uint8_t>(BatteryMetric::percentage))) {
+        sample[BatteryMetric::percentage] = battery.percentage();
+    }
+    if (bitRead(metrics, static_cast<uint8_t>(BatteryMetric::temperature))) {
+        sample[BatteryMetric::temperature] = battery.internalTemperature();
+    }
+    return sample;
+}
+
+void RollupBucket::add(const BatterySample &sample) {
+    for (uint8_t index = 0; index < BATTERY_METRIC_COUNT; ++index) {
+        RollupStatistics &statistics = metrics[index];
+        float value = sample.values[index];
+        if (count == 0) {
+            statistics.minimum = value;
+            statistics.maximum = value;
+        } else {
+            statistics.minimum = min(statistics.minimum, value);
+            statistics.maximum = max(statistics.maximum, value);
+        }
+        statistics.sum += value;
+        statistics.last = value;
+    }
+    ++count;
+}
+
+void RollupBucket::merge(const RollupBucket &other) {
+    if (other.count == 0) {
+        return;
+    }
+
+    for (uint8_t index = 0; index < BATTERY_METRIC_COUNT; ++index) {
+        RollupStatistics &statistics = metrics[index];
+        const RollupStatistics &otherStatistics = other.metrics[index];
+        if (count == 0) {
+            statistics = otherStatistics;
+            continue;
+        }
+        statistics.minimum = min(statistics.minimum, otherStatistics.minimum);
+        statistics.maximum = max(statistics.maximum, otherStatistics.maximum);
+        statistics.sum += otherStatistics.sum;
+        statistics.last = otherStatistics.last;
+    }
+    count += other.count;
+}
+
+void TelemetryRollupBase::add(uint32_t now, const BatterySample &sample) {
+    flush(now);
+
+    RollupBucket &bucket = open[0];
+    if (bucket.count == 0) {
+        bucket.start = now - now % ROLLUP_PERIODS[0];
+    }
+    bucket.add(sample);
+}
+
+void TelemetryRollupBase::update(uint32_t now, Battery &battery) {
+    add(now, BatterySample::read(battery));
+}
+
+void TelemetryRollupBase::flush(uint32_t now) {
+    // Closing a bucket fills the next tier, so the tiers are checked from fine to coarse
+    for (uint8_t tier = 0; tier < ROLLUP_TIER_COUNT; ++tier) {
+        if (open[tier].count > 0 && now - open[tier].start >= ROLLUP_PERIODS[tier]) {
+            closeBucket(tier);
+        }
+    }
+}
+
+uint16_t TelemetryRollupBase::count(RollupTier tier) {
+    return rings[static_cast<uint8_t>(tier)].count;
+}
+
+bool TelemetryRollupBase::bucket(RollupTier tier, uint16_t age, RollupBucket &bucket) {
+    Ring &ring = rings[static_cast<uint8_t>(tier)];
+    if (age >= ring.count) {
+        return false;
+    }
+    bucket = ring.buckets[(ring.next + ring.capacity - 1 - age) % ring.capacity];
+    return true;
+}
+
+RollupBucket TelemetryRollupBase::openBucket(RollupTier tier) {
+    return open[static_cast<uint8_t>(tier)];
+}
+
+void TelemetryRollupBase::onBucketClosed(void (*callback)(RollupTier tier, const RollupBucket &bucket)) {
+    bucketClosedCallback = callback;
+}
+
+void TelemetryRollupBase::reset() {
+    for (uint8_t tier = 0; tier < ROLLUP_TIER_COUNT; ++tier) {
+        rings[tier].next = 0;
+        rings[tier].count = 0;
+        open[tier] = RollupBucket();
+    }
+}
+
+uint32_t TelemetryRollupBase::period(RollupTier tier) {
+    return ROLLUP_PERIODS[static_cast<uint8_t>(tier)];
+}
+
+void TelemetryRollupBase::setRing(RollupTier tier, RollupBucket *buckets, uint16_t capacity) {
+    Ring &ring = rings[static_cast<uint8_t>(tier)];
+    ring.buckets = buckets;
+    ring.capacity = capacity;
+    ring.next = 0;
+    ring.count = 0;
+}
+
+void TelemetryRollupBase::closeBucket(uint8_t tier) {
+    RollupBucket &bucket = open[tier];
+    Ring &ring = rings[tier];
+    ring.buckets[ring.next] = bucket;
+    ring.next = (ring.next + 1) % ring.capacity;
+    if (ring.count < ring.capacity) {
+        ++ring.count;
+    }
+
+    if (bucketClosedCallback != nullptr) {
+        bucketClosedCallback(static_cast<RollupTier>(tier), bucket);
+    }
+
+    uint8_t nextTier = tier + 1;
+    if (nextTier < ROLLUP_TIER_COUNT) {
+        uint32_t nextStart = bucket.start - bucket.start % ROLLUP_PERIODS[nextTier];
+        if (open[nextTier].count > 0 && open[nextTier].start != nextStart) {
+            closeBucket(nextTier); // The coarser period ended without being flushed
+        }
+        open[nextTier].start = nextStart;
+        open[nextTier].merge(bucket);
+    }
+    bucket = RollupBucket();
+}
@@ -0,0 +1,265 @@
+#ifndef TELEMETRY_ROLLUP_H
+#define TELEMETRY_ROLLUP_H
+
+#include "Arduino.h"
+#include "Battery.h"
+
+/**
+ * @brief The battery readings that are aggregated by the TelemetryRollup.
+ */
+enum class BatteryMetric : uint8_t {
+    /// @brief The battery voltage in volts (V).
+    voltage = 0,
+
+    /// @brief The battery current in milli amperes (mA).
+    current = 1,
+
+    /// @brief The battery power in milliwatts (mW).
+    power = 2,
+
+    /// @brief The state of charge in percent.
+    percentage = 3,
+
+    /// @brief The temperature in degrees Celsius.
+    temperature = 4
+};
+
+constexpr uint8_t BATTERY_METRIC_COUNT = 5;
+constexpr uint8_t ALL_BATTERY_METRICS = (1 << BATTERY_METRIC_COUNT) - 1; // Bit mask with every BatteryMetric
+
+/**
+ * @brief The time resolutions of the TelemetryRollup.
+ */
+enum class RollupTier : uint8_t {
+    second = 0,
+    minute = 1,
+    hour = 2,
+    day = 3
+};
+
+constexpr uint8_t ROLLUP_TIER_COUNT = 4;
+
+/**
+ * @brief One reading of all metrics.
+ */
+struct BatterySample {
+    float values[BATTERY_METRIC_COUNT] = {};
+
+    /**
+     * @brief Accesses the value of a metric.
+     * @param metric The metric.
+     * @return The value.
+     */
+    float &operator[](BatteryMetric metric) {
+        return values[static_cast<uint8_t>(metric)];
+    }
+
+    /**
+     * @brief Reads the metrics from the fuel gauge.
+     * @param battery The battery to read.
+     * @param metrics Bit mask of the metrics to read, indexed by BatteryMetric. The others are left at 0.
+     * @return The sample.
+     */
+    static BatterySample read(Battery &battery, uint8_t metrics = ALL_BATTERY_METRICS);
+};
+
+/**
+ * @brief The aggregate of one metric over a period.
+ */
+struct RollupStatistics {
+    /// @brief The smallest value.
+    float minimum = 0.0f;
+
+    /// @brief The largest value.
+    float maximum = 0.0f;
+
+    /// @brief The sum of the values, see mean().
+    float sum = 0.0f;
+
+    /// @brief The most recent value.
+    float last = 0.0f;
+
+    /**
+     * @brief The average of the values.
+     * @param count The number of values, RollupBucket::count.
+     * @return The mean, 0 if there are no values.
+     */
+    float mean(uint32_t count) const {
+        return count > 0 ? sum / count : 0.0f;
+    }
+};
+
+/**
+ * @brief The aggregates of all metrics over one period of a tier.
+ */
+struct RollupBucket {
+    /// @brief The start of the period in seconds, a multiple of the tier's period.
+    uint32_t start = 0;
+
+    /// @brief The number of samples in the period.
+    uint32_t count = 0;
+
+    /// @brief The aggregates, indexed by BatteryMetric.
+    RollupStatistics metrics[BATTERY_METRIC_COUNT];
+
+    /**
+     * @brief Accesses the aggregate of a metric.
+     * @param metric The metric.
+     * @return The aggregate.
+     */
+    const RollupStatistics &operator[](BatteryMetric metric) const {
+        return metrics[static_cast<uint8_t>(metric)];
+    }
+
+    /**
+     * @brief Adds a sample to the aggregates.
+     * @param sample The sample.
+     */
+    void add(const BatterySample &sample);
+
+    /**
+     * @brief Adds the aggregates of a later bucket, e.g. a second to its minute.
+     * @param other The bucket to add.
+     */
+    void merge(const RollupBucket &other);
+};
+
+/**
+ * @brief Aggregates battery readings into per second, minute, hour and day buckets.
+ *
+ * Each tier keeps its most recent buckets in a ring of fixed size, so the memory doesn't grow with the uptime.
+ * A sample is only added to the open bucket of the finest tier. When a period ends, its bucket is pushed to its
+ * ring and merged into the open bucket of the next tier, so a sample takes constant time however long
+ * the history is. Periods are aligned to multiples of their length, e.g. days start at midnight UTC
+ * when the time is given as Unix time. Periods without samples don't produce a bucket.
+ *
+ * The sizes of the rings are set by TelemetryRollup, this class holds the logic that is shared by all sizes.
+ */
+class TelemetryRollupBase {
+    public:
+        /**
+         * @brief Adds a sample.
+         * @param now The time of the sample in seconds, e.g. the Unix time from the RTC. It must not go backwards.
+         * @param sample The sample.
+         */
+        void add(uint32_t now, const BatterySample &sample);
+
+        /**
+         * @brief Reads the fuel gauge and adds the sample.
+         * @param now The time of the sample in seconds.
+         * @param battery The battery to read.
+         */
+        void update(uint32_t now, Battery &battery);
+
+        /**
+         * @brief Closes the buckets whose period has ended, without adding a sample.
+         * Call this before reading the buckets if no samples are added for a while, e.g. after standby.
+         * @param now The current time in seconds.
+         */
+        void flush(uint32_t now);
+
+        /**
+         * @brief Returns the number of closed buckets kept for a tier.
+         * @param tier The tier.
+         * @return The number of buckets.
+         */
+        uint16_t count(RollupTier tier);
+
+        /**
+         * @brief Reads a closed bucket.
+         * @param tier The tier.
+         * @param age 0 for the most recent bucket, count(tier) - 1 for the oldest one.
+         * @param bucket Receives the bucket.
+         * @return True if the bucket exists, false otherwise.
+         */
+        bool bucket(RollupTier tier, uint16_t age, RollupBucket &bucket);
+
+        /**
+         * @brief Returns the bucket of a tier that is still collecting samples.
+         * @param tier The tier.
+         * @return The open bucket, its count is 0 if it has no samples yet.
+         */
+        RollupBucket openBucket(RollupTier tier);
+
+        /**
+         * @brief Sets a function that is called whenever a bucket is closed, e.g. to send the hourly aggregates.
+         * @param callback The function, or nullptr to remove it.
+         */
+        void onBucketClosed(void (*callback)(RollupTier tier, const RollupBucket &bucket));
+
+        /**
+         * @brief Discards all buckets.
+         */
+        void reset();
+
+        /**
+         * @brief Returns the length of a tier's period.
+         * @param tier The tier.
+         * @return The period in seconds.
+         */
+        static uint32_t period(RollupTier tier);
+
+    protected:
+        /**
+         * A ring of buckets whose storage is owned by the derived class.
+         */
+        struct Ring {
+            RollupBucket *buckets = nullptr;
+            uint16_t capacity = 0;
+            uint16_t next = 0;
+            uint16_t count = 0;
+        };
+
+        /**
+         * Sets the storage of a tier's ring.
+         */
+        void setRing(RollupTier tier, RollupBucket *buckets, uint16_t capacity);
+
+    private:
+        /**
+         * Pushes the open bucket of a tier to its ring and merges it into the next tier.
+         */
+        void closeBucket(uint8_t tier);
+
+        Ring rings[ROLLUP_TIER_COUNT];
+        RollupBucket open[ROLLUP_TIER_COUNT];
+        void (*bucketClosedCallback)(RollupTier tier, const RollupBucket &bucket) = nullptr;
+};
+
+/**
+ * @brief A TelemetryRollup with rings of the given sizes.
+ * The defaults keep one minute of seconds, one hour of minutes, one day of hours and one week of days in about 13KB.
+ *
+ *     TelemetryRollup<> rollup;
+ *
+ *     void loop() {
+ *         rollup.update(rtcTime, battery);
+ *         RollupBucket hour;
+ *         if (rollup.bucket(RollupTier::hour, 0, hour)) {
+ *             Serial.println(hour[BatteryMetric::current].mean(hour.count));
+ *         }
+ *     }
+ */
+template <uint16_t Seconds = 60, uint16_t Minutes = 60, uint16_t Hours = 24, uint16_t Days = 7>
+class TelemetryRollup : public TelemetryRollupBase {
+    public:
+        TelemetryRollup() {
+            setRing(RollupTier::second, secondBuckets, Seconds);
+            setRing(RollupTier::minute, minuteBuckets, Minutes);
+            setRing(RollupTier::hour, hourBuckets, Hours);
+            setRing(RollupTier::day, dayBuckets, Days);
+        }
+
+        // The rings point into this object
+        TelemetryRollup(const TelemetryRollup &) = delete;
+        TelemetryRollup &operator=(const TelemetryRollup &) = delete;
+
+    private:
+        static_assert(Seconds > 0 && Minutes > 0 && Hours > 0 && Days > 0, "Every tier needs at least one bucket");
+        RollupBucket secondBuckets[Seconds];
+        RollupBucket minuteBuckets[Minutes];
+        RollupBucket hourBuckets[Hours];
+        RollupBucket dayBuckets[Days];
+};
+
+#endif
@@ -0,0 +1,137 @@
+#include "WakeScheduler.h"
+
+WakeScheduler::WakeScheduler() {}
+
+int16_t WakeScheduler::addJob(uint32_t period, uint32_t slack, void (*callback)(), uint32_t now) {
+    if (count == MAX_WAKE_JOBS || period == 0 || callback == nullptr) {
+        return -1;
+    }
+
+    WakeJob job;
+    job.id = nextFreeId();
+    job.deadline = now + period;
+    job.period = period;
+    job.slack = slack;
+    job.callback = callback;
+
+    jobs[count] = job;
+    siftUp(count++);
+    return job.id;
+}
+
+bool WakeScheduler::removeJob(uint8_t id) {
+    for (uint8_t index = 0; index < count; ++index) {
+        if (jobs[index].id != id) {
+            continue;
+        }
+
+        jobs[index] = jobs[--count];
+        if (index < count) {
+            siftUp(index);
+            siftDown(index);
+        }
+        return true;
+    }
+    return false;
+}
+
+uint8_t WakeScheduler::jobCount() {
+    return count;
+}
+
+uint32_t WakeScheduler::nextWakeup() {
+    return count > 0 ? jobs[0].deadline : UINT32_MAX;
+}
+
+uint8_t WakeScheduler::dispatch(uint32_t now) {
+    void (*callbacks[MAX_WAKE_JOBS])();
+    uint8_t dueJobs = 0;
+
+    // Due jobs are not necessarily at the top of the heap as they may run early within their slack
+    for (uint8_t index = 0; index < count; ++index) {
+        WakeJob &job = jobs[index];
+        if (job.deadline > now + job.slack) {
+            continue;
+        }
+
+        callbacks[dueJobs++] = job.callback;
+        if (job.deadline <= now) {
+            uint32_t missedPeriods = (now - job.deadline) / job.period;
+            job.deadline += (missedPeriods + 1) * job.period;
+        } else {
+            job.deadline += job.period;
+        }
+    }
+
+    // Rebuild the heap before running the callbacks, so they can add or remove jobs
+    for (int16_t index = count / 2 - 1; index >= 0; --index) {
+        siftDown(index);
+    }
+
+    for (uint8_t index = 0; index < dueJobs; ++index) {
+        callbacks[index]();
+    }
+    return dueJobs;
+}
+
+#if defined(ARDUINO_PORTENTA_C33) || defined(ARDUINO_PORTENTA_H7)
+bool WakeScheduler::enableWakeup(Board &board, uint32_t now) {
+    if (count == 0) {
+        return false;
+    }
+
+    // Wake up at least one second from now, the RTC alarm can't be set in the past
+    uint32_t duration = jobs[0].deadline > now ? jobs[0].deadline - now : 1;
+    return board.enableWakeupFromRTC(duration / 3600, (duration % 3600) / 60, duration % 60);
+}
+#endif
+
+uint8_t WakeScheduler::nextFreeId() {
+    // Ids wrap around, skip those still in use
+    while (true) {
+        uint8_t id = nextId++;
+        bool inUse = false;
+        for (uint8_t index = 0; index < count; ++index) {
+            inUse |= jobs[index].id == id;
+        }
+        if (!inUse) {
+            return id;
+        }
+    }
+}
+
+void WakeScheduler::siftUp(uint8_t index) {
+    while (index > 0) {
+        uint8_t parent = (index - 1) / 2;
+        if (jobs[parent].deadline <= jobs[index].deadline) {
+            return;
+        }
+        WakeJob job = jobs[parent];
+        jobs[parent] = jobs[index];
+        jobs[index] = job;
+        index = parent;
+    }
+}
+
+void WakeScheduler::siftDown(uint8_t index) {
+    while (true) {
+        uint8_t smallest = index;
+        uint8_t left = 2 * index + 1;
+        uint8_t right = left + 1;
+
+        if (left < count && jobs[left].deadline < jobs[smallest].deadline) {
+            smallest = left;
+        }
+        if (right < count && jobs[right].deadline < jobs[smallest].deadline) {
+            smallest = right;
+        }
+        if (smallest == index) {
+            return;
+        }
+
+        WakeJob job = jobs[smallest];
+        jobs[smallest] = jobs[index];
+        jobs[index] = job;
+        index = smallest;
+    }
+}
@@ -0,0 +1,116 @@
+#ifndef WAKE_SCHEDULER_H
+#define WAKE_SCHEDULER_H
+
+#include "Arduino.h"
+#include "Board.h"
+
+constexpr uint8_t MAX_WAKE_JOBS = 8; // Maximum number of jobs a WakeScheduler can hold
+
+/**
+ * @brief A periodic job run by the WakeScheduler.
+ */
+struct WakeJob {
+    /// @brief The identifier returned by WakeScheduler::addJob().
+    uint8_t id = 0;
+
+    /// @brief The time in seconds at which the job is due next.
+    uint32_t deadline = 0;
+
+    /// @brief The interval between two runs of the job in seconds.
+    uint32_t period = 0;
+
+    /// @brief How many seconds before its deadline the job may run if the device is awake anyway.
+    uint32_t slack = 0;
+
+    /// @brief The function to call when the job runs.
+    void (*callback)() = nullptr;
+};
+
+/**
+ * @brief Runs several periodic jobs with a single RTC wake-up alarm.
+ *
+ * The jobs are kept in a min-heap ordered by their deadline. The RTC alarm is always programmed for
+ * the earliest deadline. When the device wakes up, all due jobs run, together with every job whose
+ * deadline is close enough to run early within its slack. This coalesces the wake-ups of jobs
+ * whose periods don't line up exactly, e.g. a job every 30s with 5s slack and a job every 5 minutes.
+ *
+ * All times are in seconds from a clock of your choice, e.g. the Unix time of the RTC.
+ * The jobs are kept in RAM, so after waking up from standby they have to be added again.
+ */
+class WakeScheduler {
+    public:
+        /**
+         * @brief Constructs a new WakeScheduler object without any jobs.
+         */
+        WakeScheduler();
+
+        /**
+         * @brief Adds a periodic job. Its first deadline is one period after now.
+         * @param period The interval between two runs of the job in seconds. Must be greater than 0.
+         * @param slack How many seconds before its deadline the job may run to share a wake-up with another job.
+         * @param callback The function to call when the job runs.
+         * @param now The current time in seconds.
+         * @return The identifier of the job, or -1 if the scheduler is full or the parameters are invalid.
+         */
+        int16_t addJob(uint32_t period, uint32_t slack, void (*callback)(), uint32_t now);
+
+        /**
+         * @brief Removes a job.
+         * @param id The identifier returned by addJob().
+         * @return True if the job was removed, false if it doesn't exist.
+         */
+        bool removeJob(uint8_t id);
+
+        /**
+         * @brief Returns the number of scheduled jobs.
+         */
+        uint8_t jobCount();
+
+        /**
+         * @brief Returns the earliest deadline of all jobs.
+         * @return The time of the next wake-up in seconds, or UINT32_MAX if there are no jobs.
+         */
+        uint32_t nextWakeup();
+
+        /**
+         * @brief Runs all jobs that are due or may run early within their slack.
+         * The next deadline of each job that ran is advanced by its period, skipping missed periods.
+         * Call this after waking up.
+         * @param now The current time in seconds.
+         * @return The number of jobs that ran.
+         */
+        uint8_t dispatch(uint32_t now);
+
+        #if defined(ARDUINO_PORTENTA_C33) || defined(ARDUINO_PORTENTA_H7)
+        /**
+         * @brief Programs the RTC wake-up of the board for the earliest deadline.
+         * Afterwards put the board to sleep or standby as usual.
+         * @param board The board whose RTC wake-up is programmed.
+         * @param now The current time in seconds.
+         * @return True if the wake-up was programmed, false if there are no jobs or the RTC alarm couldn't be set.
+         */
+        bool enableWakeup(Board &board, uint32_t now);
+        #endif
+
+    private:
+        /**
+         * Returns an identifier that isn't used by any scheduled job.
+         */
+        uint8_t nextFreeId();
+
+        /**
+         * Restores the heap order after the element at the given index got an earlier deadline.
+         */
+        void siftUp(uint8_t index);
+
+        /**
+         * Restores the heap order after the element at the given index got a later deadline.
+         */
+        void siftDown(uint8_t index);
+
+        WakeJob jobs[MAX_WAKE_JOBS];
+        uint8_t count = 0;
+        uint8_t nextId = 0;
+};
+
+#endif
@@ -58,6 +58,63 @@ static inline uint8_t writeRegister16Bits(TwoWire *wire, uint8_t address, uint8_
     return (wire->endTransmission());
 }
 
+constexpr uint8_t MAX_BURST_WORDS = 8; // 17 bytes per transmission, fits in the smallest Wire buffer (32 bytes)
+
+/**
+ * Writes consecutive 16-bit registers in burst transmissions, relying on the register address auto-increment of the device.
+ * The data order is LSB(yte) first.
+ *
+ * @param wire The I2C wire object to use for communication.
+ * @param address The I2C address of the device.
+ * @param reg The first register to write to.
+ * @param data The 16-bit values to write.
+ * @param count The number of registers to write.
+ * @return The status of the first failed transmission (see writeRegister16Bits()), 0 on success.
+ */
+static inline uint8_t writeRegisters16Bits(TwoWire *wire, uint8_t address, uint8_t reg, const uint16_t *data, uint8_t count)
+{
+    for (uint8_t offset = 0; offset < count; offset += MAX_BURST_WORDS) {
+        uint8_t words = min(count - offset, static_cast<int>(MAX_BURST_WORDS));
+        wire->beginTransmission(address);
+        wire->write(reg + offset);
+        for (uint8_t index = 0; index < words; ++index) {
+            wire->write(data[offset + index] & 0x00FF);
+            wire->write((data[offset + index] & 0xFF00) >> 8);
+        }
+
+        uint8_t status = wire->endTransmission();
+        if (status != 0) {
+            return status;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Reads consecutive 16-bit registers in burst transmissions, relying on the register address auto-increment of the device.
+ * The data order is LSB(yte) first.
+ *
+ * @param wire The I2C wire object to use for communication.
+ * @param address The I2C address of the device.
+ * @param reg The first register to read.
+ * @param data Receives the 16-bit values.
+ * @param count The number of registers to read.
+ */
+static inline void readRegisters16Bits(TwoWire *wire, uint8_t address, uint8_t reg, uint16_t *data, uint8_t count)
+{
+    for (uint8_t offset = 0; offset < count; offset += MAX_BURST_WORDS) {
+        uint8_t words = min(count - offset, static_cast<int>(MAX_BURST_WORDS));
+        wire->beginTransmission(address);
+        wire->write(reg + offset);
+        wire->endTransmission(false);
+        wire->requestFrom(address, words * 2, true);
+        for (uint8_t index = 0; index < words; ++index) {
+            data[offset + index] = (uint16_t)wire->read(); // Read LSB
+            data[offset + index] |= (uint16_t)wire->read() << 8; // Read MSB
+        }
+    }
+}
+
 /**
  * @brief Reads a 16-bit register from a specified address using the given I2C wire object.
  * The data order is LSB(yte) first.